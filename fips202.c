@@ -374,6 +374,139 @@ static void keccak_squeezeblocks(uint8_t *h,
     }
 }
 
+/* The incremental functions keep the number of bytes of the current block in
+s_inc[25]: while absorbing, the bytes that have been xored into the state;
+while squeezing, the bytes of the current block that are left. */
+
+static void keccak_inc_init(uint64_t *s_inc)
+{
+    uint32_t i;
+
+    for (i = 0; i < 25; ++i) {
+        s_inc[i] = 0;
+    }
+    s_inc[25] = 0;
+}
+
+static void keccak_inc_absorb(uint64_t *s_inc,
+                              uint32_t r,
+                              const uint8_t *m,
+                              size_t mlen)
+{
+    size_t i;
+
+    /* Complete a block that was started before. */
+    while (mlen > 0 && s_inc[25] > 0) {
+        s_inc[s_inc[25] >> 3] ^= (uint64_t)*m << (8 * (s_inc[25] & 0x07));
+        m++;
+        mlen--;
+        if (++s_inc[25] == r) {
+            KeccakF1600_StatePermute(s_inc);
+            s_inc[25] = 0;
+        }
+    }
+    if (s_inc[25] > 0) {
+        return;
+    }
+    /* Whole blocks are absorbed a word at a time. */
+    while (mlen >= r) {
+        for (i = 0; i < r / 8; ++i) {
+            s_inc[i] ^= load64(m + 8 * i);
+        }
+        KeccakF1600_StatePermute(s_inc);
+        mlen -= r;
+        m += r;
+    }
+    for (i = 0; i < mlen; ++i) {
+        s_inc[i >> 3] ^= (uint64_t)m[i] << (8 * (i & 0x07));
+    }
+    s_inc[25] = mlen;
+}
+
+static void keccak_inc_finalize(uint64_t *s_inc, uint32_t r, uint8_t p)
+{
+    s_inc[s_inc[25] >> 3] ^= (uint64_t)p << (8 * (s_inc[25] & 0x07));
+    s_inc[(r - 1) >> 3] ^= (uint64_t)128 << (8 * ((r - 1) & 0x07));
+    s_inc[25] = 0;
+}
+
+static void keccak_inc_squeeze(uint8_t *h,
+                               size_t outlen,
+                               uint64_t *s_inc,
+                               uint32_t r)
+{
+    size_t i;
+
+    /* First use the bytes that are left of the current block. */
+    for (i = 0; i < outlen && i < s_inc[25]; ++i) {
+        h[i] = (uint8_t)(s_inc[(r - s_inc[25] + i) >> 3]
+                         >> (8 * ((r - s_inc[25] + i) & 0x07)));
+    }
+    h += i;
+    outlen -= i;
+    s_inc[25] -= i;
+
+    while (outlen > 0) {
+        KeccakF1600_StatePermute(s_inc);
+        for (i = 0; i < outlen && i < r; ++i) {
+            h[i] = (uint8_t)(s_inc[i >> 3] >> (8 * (i & 0x07)));
+        }
+        h += i;
+        outlen -= i;
+        s_inc[25] = r - i;
+    }
+}
+
+void shake128_inc_init(shake128incctx *state)
+{
+    keccak_inc_init(state->ctx);
+}
+
+void shake128_inc_absorb(shake128incctx *state, const uint8_t *in, size_t inlen)
+{
+    keccak_inc_absorb(state->ctx, SHAKE128_RATE, in, inlen);
+}
+
+void shake128_inc_finalize(shake128incctx *state)
+{
+    keccak_inc_finalize(state->ctx, SHAKE128_RATE, 0x1F);
+}
+
+void shake128_inc_squeeze(uint8_t *out, size_t outlen, shake128incctx *state)
+{
+    keccak_inc_squeeze(out, outlen, state->ctx, SHAKE128_RATE);
+}
+
+void shake128_inc_ctx_clone(shake128incctx *dest, const shake128incctx *src)
+{
+    memcpy(dest, src, sizeof(shake128incctx));
+}
+
+void shake256_inc_init(shake256incctx *state)
+{
+    keccak_inc_init(state->ctx);
+}
+
+void shake256_inc_absorb(shake256incctx *state, const uint8_t *in, size_t inlen)
+{
+    keccak_inc_absorb(state->ctx, SHAKE256_RATE, in, inlen);
+}
+
+void shake256_inc_finalize(shake256incctx *state)
+{
+    keccak_inc_finalize(state->ctx, SHAKE256_RATE, 0x1F);
+}
+
+void shake256_inc_squeeze(uint8_t *out, size_t outlen, shake256incctx *state)
+{
+    keccak_inc_squeeze(out, outlen, state->ctx, SHAKE256_RATE);
+}
+
+void shake256_inc_ctx_clone(shake256incctx *dest, const shake256incctx *src)
+{
+    memcpy(dest, src, sizeof(shake256incctx));
+}
+
 void shake128(uint8_t *out,
               uint64_t outlen,
               const uint8_t *in,
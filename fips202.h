@@ -4,8 +4,23 @@
 #define SHAKE128_RATE 168
 #define SHAKE256_RATE 136
 
+#include <stddef.h>
 #include <stdint.h>
 
+/* The incremental API absorbs any number of pieces of input before it is
+finalized, after which output can be squeezed in pieces. The last word of
+ctx counts the bytes of the current block, absorbed or not yet squeezed. */
+
+/* Structure for the incremental API */
+typedef struct {
+    uint64_t ctx[26];
+} shake128incctx;
+
+/* Structure for the incremental API */
+typedef struct {
+    uint64_t ctx[26];
+} shake256incctx;
+
 /* Evaluates SHAKE-128 on `inlen' bytes in `in', according to FIPS-202.
  * Writes the first `outlen` bytes of output to `out`.
  */
@@ -22,4 +37,38 @@ void shake256(uint8_t *out,
               const uint8_t *in,
               uint64_t inlen);
 
+/* ====== SHAKE128 incremental API ==== */
+
+/* Initializes the incremental API. */
+void shake128_inc_init(shake128incctx *state);
+
+/* Absorbs inlen bytes of input. */
+void shake128_inc_absorb(shake128incctx *state, const uint8_t *in, size_t inlen);
+
+/* Pads the input; afterwards, no more input can be absorbed. */
+void shake128_inc_finalize(shake128incctx *state);
+
+/* Squeezes the next outlen bytes of output. */
+void shake128_inc_squeeze(uint8_t *out, size_t outlen, shake128incctx *state);
+
+/* Copies the state, e.g. to finish a prefix that was absorbed once. */
+void shake128_inc_ctx_clone(shake128incctx *dest, const shake128incctx *src);
+
+/* ====== SHAKE256 incremental API ==== */
+
+/* Initializes the incremental API. */
+void shake256_inc_init(shake256incctx *state);
+
+/* Absorbs inlen bytes of input. */
+void shake256_inc_absorb(shake256incctx *state, const uint8_t *in, size_t inlen);
+
+/* Pads the input; afterwards, no more input can be absorbed. */
+void shake256_inc_finalize(shake256incctx *state);
+
+/* Squeezes the next outlen bytes of output. */
+void shake256_inc_squeeze(uint8_t *out, size_t outlen, shake256incctx *state);
+
+/* Copies the state, e.g. to finish a prefix that was absorbed once. */
+void shake256_inc_ctx_clone(shake256incctx *dest, const shake256incctx *src);
+
 #endif
@@ -1,4 +1,5 @@
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "hash_address.h"
@@ -11,6 +12,7 @@
 #define XMSS_HASH_PADDING_H 1
 #define XMSS_HASH_PADDING_HASH 2
 #define XMSS_HASH_PADDING_PRF 3
+#define XMSS_HASH_PADDING_BATCH 4
 
 #if PRECOMP
 #define PRF prf_precomp
@@ -18,21 +20,137 @@
 #define PRF prf
 #endif
 
-void addr_to_bytes(uint8_t *bytes, const uint32_t addr[8])
+#if HASH_STATS
+static _Thread_local uint64_t hash_stats_table[HASH_STATS_PHASES][HASH_STATS_TYPES];
+static _Thread_local uint32_t hash_stats_current;
+
+static const char *const hash_stats_type_names[HASH_STATS_TYPES] = {
+  "calls", "core_hash", "prf", "thash_f", "thash_h", "compress"
+};
+
+static const char *const hash_stats_phase_names[HASH_STATS_PHASES] = {
+  "other", "message", "grind", "wots", "ltree", "auth", "bds"
+};
+
+void hash_stats_inc(void)
 {
-  int i;
-  for (i = 0; i < 8; i++) {
-    ull_to_bytes(bytes + i * 4, 4, addr[i]);
+  hash_stats_table[hash_stats_current][HASH_STATS_CALLS]++;
+}
+
+void hash_stats_add(uint64_t calls)
+{
+  hash_stats_table[hash_stats_current][HASH_STATS_CALLS] += calls;
+}
+
+void hash_stats_count_type(uint32_t type, uint64_t calls)
+{
+  hash_stats_table[hash_stats_current][type] += calls;
+}
+
+uint64_t hash_stats_count(void)
+{
+  return hash_stats_get(HASH_STATS_CALLS, HASH_STATS_PHASES);
+}
+
+uint64_t hash_stats_get(uint32_t type, uint32_t phase)
+{
+  uint64_t sum = 0;
+  uint32_t i;
+
+  if (type >= HASH_STATS_TYPES || phase > HASH_STATS_PHASES) {
+    return 0;
+  }
+  if (phase < HASH_STATS_PHASES) {
+    return hash_stats_table[phase][type];
+  }
+  for (i = 0; i < HASH_STATS_PHASES; i++) {
+    sum += hash_stats_table[i][type];
+  }
+  return sum;
+}
+
+uint32_t hash_stats_enter(uint32_t phase)
+{
+  uint32_t prev = hash_stats_current;
+
+  if (prev == HASH_STATS_OTHER) {
+    hash_stats_current = phase;
+  }
+  return prev;
+}
+
+void hash_stats_leave(uint32_t prev)
+{
+  hash_stats_current = prev;
+}
+
+const char *hash_stats_type_name(uint32_t type)
+{
+  return type < HASH_STATS_TYPES ? hash_stats_type_names[type] : NULL;
+}
+
+const char *hash_stats_phase_name(uint32_t phase)
+{
+  return phase < HASH_STATS_PHASES ? hash_stats_phase_names[phase] : NULL;
+}
+
+void hash_stats_reset(void)
+{
+  memset(hash_stats_table, 0, sizeof(hash_stats_table));
+  hash_stats_current = HASH_STATS_OTHER;
+}
+
+/*
+* Returns the compression function calls, or Keccak permutations, that finish
+* a hash over inlen more bytes once pending bytes are already absorbed. The
+* SHA-2 padding takes 9 (SHA-256) or 17 (SHA-512) bytes, and SHAKE squeezes
+* at most n bytes, which never needs a second permutation.
+*/
+static uint64_t hash_stats_final_blocks(uint32_t func,
+                                        uint32_t n,
+                                        uint64_t pending,
+                                        uint64_t inlen)
+{
+  if (func == XMSS_SHAKE) {
+    return (pending + inlen) / (n == 32 ? SHAKE128_RATE : SHAKE256_RATE) + 1;
   }
+  if (n == 32) {
+    return (inlen + 9 + 63) / 64;
+  }
+  return (inlen + 17 + 127) / 128;
 }
 
+/* Returns the bytes SHAKE has absorbed into state short of a permutation. */
+static uint64_t hash_stats_pending(uint32_t func, uint32_t n,
+                                   const hash_state *state)
+{
+  if (func != XMSS_SHAKE) {
+    return 0;
+  }
+  return n == 32 ? state->shake128.ctx[25] : state->shake256.ctx[25];
+}
+#endif
+
 static int core_hash(const xmss_params *params,
                      uint8_t *out,
                      const uint8_t *in,
                      uint64_t inlen)
 {
+  HASH_STATS_INC();
+  HASH_STATS_COUNT(HASH_STATS_CORE_HASH, 1);
+  HASH_STATS_COUNT(HASH_STATS_COMPRESS,
+                   hash_stats_final_blocks(params->func, params->n, 0, inlen));
   if (params->n == 32 && params->func == XMSS_SHA2) {
-    SHA256(in, inlen, out);
+    params->backend->hash(out, in, inlen);
+  }
+  else if (params->n == 32 && params->func == XMSS_SHAKE) {
+    shake128(out, 32, in, inlen);
+  }
+  else if (params->n == 64 && params->func == XMSS_SHA2) {
+    sha512(out, in, inlen);
+  }
+  else if (params->n == 64 && params->func == XMSS_SHAKE) {
+    shake256(out, 64, in, inlen);
   }
   else {
     return -1;
@@ -40,38 +158,171 @@ static int core_hash(const xmss_params *params,
   return 0;
 }
 
+/*
+* Absorbs blocks blocks of 2n bytes of in, which is one SHA-256 block for
+* n = 32 and one SHA-512 block for n = 64. SHAKE, whose blocks are larger,
+* only xors them into its state until a whole block of its own is complete.
+*/
+static void state_blocks(uint32_t func,
+                         uint32_t n,
+                         const xmss_hash_backend *backend,
+                         hash_state *state,
+                         const uint8_t *in,
+                         uint64_t blocks)
+{
+  HASH_STATS_COUNT(HASH_STATS_COMPRESS, func != XMSS_SHAKE ? blocks :
+                   (hash_stats_pending(func, n, state) + 2 * n * blocks) /
+                   (n == 32 ? SHAKE128_RATE : SHAKE256_RATE));
+  if (func == XMSS_SHAKE && n == 32) {
+    shake128_inc_absorb(&state->shake128, in, 2 * n * blocks);
+  }
+  else if (func == XMSS_SHAKE) {
+    shake256_inc_absorb(&state->shake256, in, 2 * n * blocks);
+  }
+  else if (n == 32) {
+    backend->inc_blocks(&state->sha256, in, blocks);
+  }
+  else {
+    sha512_inc_blocks(&state->sha512, in, blocks);
+  }
+}
+
+/* Starts a hash by absorbing blocks blocks of in. */
+static void state_init(uint32_t func,
+                       uint32_t n,
+                       const xmss_hash_backend *backend,
+                       hash_state *state,
+                       const uint8_t *in,
+                       uint64_t blocks)
+{
+  if (func == XMSS_SHAKE && n == 32) {
+    shake128_inc_init(&state->shake128);
+  }
+  else if (func == XMSS_SHAKE) {
+    shake256_inc_init(&state->shake256);
+  }
+  else if (n == 32) {
+    sha256_inc_init(&state->sha256);
+  }
+  else {
+    sha512_inc_init(&state->sha512);
+  }
+  state_blocks(func, n, backend, state, in, blocks);
+}
+
+/*
+* Finishes a copy of state over the last inlen bytes, into n bytes of out.
+* The state itself is left as it is.
+*/
+static void state_final(uint32_t func,
+                        uint32_t n,
+                        const xmss_hash_backend *backend,
+                        uint8_t *out,
+                        const hash_state *state,
+                        const uint8_t *in,
+                        uint64_t inlen)
+{
+  hash_state s = *state;
+
+  HASH_STATS_COUNT(HASH_STATS_COMPRESS,
+                   hash_stats_final_blocks(func, n,
+                                           hash_stats_pending(func, n, state),
+                                           inlen));
+  if (func == XMSS_SHAKE && n == 32) {
+    shake128_inc_absorb(&s.shake128, in, inlen);
+    shake128_inc_finalize(&s.shake128);
+    shake128_inc_squeeze(out, 32, &s.shake128);
+  }
+  else if (func == XMSS_SHAKE) {
+    shake256_inc_absorb(&s.shake256, in, inlen);
+    shake256_inc_finalize(&s.shake256);
+    shake256_inc_squeeze(out, 64, &s.shake256);
+  }
+  else if (n == 32) {
+    backend->inc_finalize(out, &s.sha256, in, inlen);
+  }
+  else {
+    sha512_inc_finalize(out, &s.sha512, in, inlen);
+  }
+}
+
+/*
+* Finishes count hashes over inputs of inlen bytes each, all starting from
+* state, or from scratch if it is NULL, with the multi-buffer functions of the
+* backend.
+*/
+static void state_final_multi(const xmss_params *params,
+                              uint8_t **out,
+                              const hash_state *state,
+                              const uint8_t **in,
+                              uint64_t inlen,
+                              uint32_t count)
+{
+  const xmss_hash_backend *backend = params->backend;
+
+  HASH_STATS_ADD(count);
+  HASH_STATS_COUNT(HASH_STATS_COMPRESS, count *
+                   hash_stats_final_blocks(params->func, params->n,
+                                           state == NULL ? 0 :
+                                           hash_stats_pending(params->func,
+                                                              params->n, state),
+                                           inlen));
+  if (params->func == XMSS_SHAKE && params->n == 32) {
+    backend->shake128_multi(out, 32, state == NULL ? NULL : &state->shake128,
+                            in, inlen, count);
+  }
+  else if (params->func == XMSS_SHAKE) {
+    backend->shake256_multi(out, 64, state == NULL ? NULL : &state->shake256,
+                            in, inlen, count);
+  }
+  else if (params->n == 32 && state == NULL) {
+    backend->hash_multi(out, in, inlen, count);
+  }
+  else if (params->n == 32) {
+    backend->prf_multi(out, &state->sha256, in, inlen, count);
+  }
+  else {
+    backend->sha512_multi(out, state == NULL ? NULL : &state->sha512,
+                          in, inlen, count);
+  }
+}
+
 #if PRECOMP
 /*
 * Computes PRF(key, in), for a key of params->n bytes, and a 32-byte input.
+* The midstate after the key block is cached per thread, and recomputed
+* whenever a different key is used.
 */
 int prf_precomp(const xmss_params *params,
                 uint8_t *out,
                 const uint8_t in[32],
                 const uint8_t *key)
 {
-  static uint8_t buf[2 * 32 + 32];
-  static int init = 1;
-  static sha256ctx state1, state2;
+  static _Thread_local uint8_t buf[2 * XMSS_MAX_N];
+  static _Thread_local int init = 1;
+  static _Thread_local uint32_t func, n;
+  static _Thread_local hash_state state;
 
-  if (init) {
+  if (params->n != 32 && params->n != 64) {
+    return -1;
+  }
+  /* All backends share the layout of the midstate, so it is kept when the
+  backend changes. */
+  if (init || func != params->func || n != params->n ||
+      memcmp(buf + params->n, key, params->n)) {
     init = 0;
+    func = params->func;
+    n = params->n;
 
-    sha256_inc_init(&state1);
-    sha256_inc_init(&state2);
-
-    ull_to_bytes(buf, params->n, XMSS_HASH_PADDING_PRF);
-    memcpy(buf + params->n, key, params->n);
-    memcpy(buf + 2 * params->n, in, 32);
+    ull_to_bytes(buf, n, XMSS_HASH_PADDING_PRF);
+    memcpy(buf + n, key, n);
 
-    sha256_inc_blocks(&state1, buf, 1);
-  }
-  else {
-    memcpy(buf + 2 * params->n, in, 32);
+    state_init(func, n, params->backend, &state, buf, 1);
   }
 
-  memcpy(state2.ctx, state1.ctx, PQC_SHA256CTX_BYTES);
-  sha256_inc_finalize(out, &state1, buf + 2 * params->n, 32);
-  memcpy(state1.ctx, state2.ctx, PQC_SHA256CTX_BYTES);
+  HASH_STATS_INC();
+  HASH_STATS_COUNT(HASH_STATS_PRF, 1);
+  state_final(func, n, params->backend, out, &state, in, 32);
   return 1;
 }
 #endif
@@ -81,14 +332,162 @@ int prf(const xmss_params *params,
         const uint8_t in[32],
         const uint8_t *key)
 {
-  uint8_t buf[2 * 32 + 32];
+  uint8_t buf[2 * params->n + 32];
   ull_to_bytes(buf, params->n, XMSS_HASH_PADDING_PRF);
   memcpy(buf + params->n, key, params->n);
   memcpy(buf + 2 * params->n, in, 32);
 
+  HASH_STATS_COUNT(HASH_STATS_PRF, 1);
   return core_hash(params, out, buf, 2 * params->n + 32);
 }
 
+/*
+* Computes PRF(key, in[i]) for count 32-byte inputs at once. The key block is
+* absorbed once, and all inputs are finished from its midstate.
+*/
+int prf_multi(const xmss_params *params,
+              uint8_t **out,
+              const uint8_t **in,
+              const uint8_t *key,
+              uint32_t count)
+{
+  uint8_t buf[2 * XMSS_MAX_N];
+  hash_state state;
+
+  if (params->n != 32 && params->n != 64) {
+    return -1;
+  }
+  ull_to_bytes(buf, params->n, XMSS_HASH_PADDING_PRF);
+  memcpy(buf + params->n, key, params->n);
+  state_init(params->func, params->n, params->backend, &state, buf, 1);
+
+  HASH_STATS_COUNT(HASH_STATS_PRF, count);
+  state_final_multi(params, out, &state, in, 32, count);
+  return 0;
+}
+
+struct prf_cache_entry {
+  uint8_t addr[32];
+  uint32_t priority;  /* 0 for an empty entry */
+  uint8_t out[XMSS_MAX_N];
+};
+
+struct prf_cache {
+  uint8_t pub_seed[XMSS_MAX_N];
+  uint32_t n;
+  uint32_t entries;
+  struct prf_cache_entry *table;
+};
+
+prf_cache *prf_cache_new(const xmss_params *params,
+                         const uint8_t *pub_seed,
+                         uint32_t entries)
+{
+  prf_cache *cache;
+
+  if (entries == 0 || (cache = malloc(sizeof(prf_cache))) == NULL) {
+    return NULL;
+  }
+  cache->table = calloc(entries, sizeof(struct prf_cache_entry));
+  if (cache->table == NULL) {
+    free(cache);
+    return NULL;
+  }
+  memcpy(cache->pub_seed, pub_seed, params->n);
+  cache->n = params->n;
+  cache->entries = entries;
+  return cache;
+}
+
+void prf_cache_free(prf_cache *cache)
+{
+  if (cache != NULL) {
+    free(cache->table);
+    free(cache);
+  }
+}
+
+/*
+* Returns the entry that addr maps to. The table is direct-mapped; the slot is
+* an FNV-1a hash of the address.
+*/
+static struct prf_cache_entry *prf_cache_slot(const prf_cache *cache,
+                                              const uint8_t *addr)
+{
+  uint32_t h = 2166136261u;
+  int i;
+
+  for (i = 0; i < 32; i++) {
+    h = (h ^ addr[i]) * 16777619u;
+  }
+  return &cache->table[h % cache->entries];
+}
+
+/*
+* Every signature under a key hashes the upper nodes of its hash trees again,
+* while the WOTS chains and L-trees of a leaf, whose addresses contain the
+* leaf index, only repeat when that leaf is verified again. Only hash tree
+* nodes are cached, ranked by their height; 0 means the address is not cached.
+*/
+static uint32_t prf_cache_priority(const uint8_t *addr)
+{
+  /* Words 3 and 5 of the address, stored big-endian, are the type and the
+  tree height, both of which are small. */
+  if (addr[15] == XMSS_ADDR_TYPE_HASHTREE) {
+    return 1 + addr[23];
+  }
+  return 0;
+}
+
+static const uint8_t *prf_cache_find(const prf_cache *cache,
+                                     const uint8_t *addr)
+{
+  const struct prf_cache_entry *e = prf_cache_slot(cache, addr);
+
+  if (e->priority != 0 && !memcmp(e->addr, addr, 32)) {
+    return e->out;
+  }
+  return NULL;
+}
+
+static void prf_cache_insert(prf_cache *cache,
+                             const uint8_t *addr,
+                             const uint8_t *out,
+                             uint32_t priority)
+{
+  struct prf_cache_entry *e = prf_cache_slot(cache, addr);
+
+  if (priority >= e->priority) {
+    memcpy(e->addr, addr, 32);
+    memcpy(e->out, out, cache->n);
+    e->priority = priority;
+  }
+}
+
+/* Computes PRF(pub_seed, addr) for thash_h, through the cache of params if
+it holds outputs under pub_seed. */
+static void prf_keyed(const xmss_params *params,
+                      uint8_t *out,
+                      const uint8_t *addr,
+                      const uint8_t *pub_seed)
+{
+  prf_cache *cache = params->prf_cache;
+  uint32_t priority = prf_cache_priority(addr);
+  const uint8_t *hit;
+
+  if (cache == NULL || priority == 0 ||
+      memcmp(cache->pub_seed, pub_seed, params->n)) {
+    PRF(params, out, addr, pub_seed);
+    return;
+  }
+  if ((hit = prf_cache_find(cache, addr)) != NULL) {
+    memcpy(out, hit, params->n);
+    return;
+  }
+  PRF(params, out, addr, pub_seed);
+  prf_cache_insert(cache, addr, out, priority);
+}
+
 /*
 * Computes the message hash using R, the public root, the index of the leaf
 * node, and the message. Notably, it requires m_with_prefix to have 4*n bytes
@@ -103,6 +502,8 @@ int hash_message(const xmss_params *params,
                  uint8_t *m_with_prefix,
                  uint64_t mlen)
 {
+  int ret;
+
   /* We're creating a hash using input of the form:
   toByte(X, 32) || R || root || index || M */
   ull_to_bytes(m_with_prefix, params->n, XMSS_HASH_PADDING_HASH);
@@ -110,7 +511,152 @@ int hash_message(const xmss_params *params,
   memcpy(m_with_prefix + 2 * params->n, root, params->n);
   ull_to_bytes(m_with_prefix + 3 * params->n, params->n, idx);
 
-  return core_hash(params, out, m_with_prefix, mlen + 4 * params->n);
+  HASH_STATS_ENTER(HASH_STATS_MESSAGE);
+  ret = core_hash(params, out, m_with_prefix, mlen + 4 * params->n);
+  HASH_STATS_LEAVE();
+  return ret;
+}
+
+/*
+* Starts a message hash whose message is passed in pieces, by absorbing the
+* prefix toByte(X, n) || R || root || index. The prefix fills exactly two
+* SHA-256 (or SHA-512) blocks, so the message needs no space in front of it.
+* With SHAKE, the message is absorbed right behind the prefix.
+*/
+int hash_message_init(const xmss_params *params,
+                      hash_message_ctx *ctx,
+                      const uint8_t *R,
+                      const uint8_t *root,
+                      uint64_t idx)
+{
+  uint8_t prefix[4 * XMSS_MAX_N];
+
+  if (params->n != 32 && params->n != 64) {
+    return -1;
+  }
+  ull_to_bytes(prefix, params->n, XMSS_HASH_PADDING_HASH);
+  memcpy(prefix + params->n, R, params->n);
+  memcpy(prefix + 2 * params->n, root, params->n);
+  ull_to_bytes(prefix + 3 * params->n, params->n, idx);
+
+  ctx->func = params->func;
+  ctx->n = params->n;
+  ctx->backend = params->backend;
+  HASH_STATS_ENTER(HASH_STATS_MESSAGE);
+  state_init(ctx->func, ctx->n, ctx->backend, &ctx->state, prefix, 2);
+  HASH_STATS_LEAVE();
+  ctx->taillen = 0;
+  return 0;
+}
+
+/*
+* Absorbs the next piece of the message. Whole blocks are hashed where they
+* are, but a block is only absorbed once at least 8 more bytes are known to
+* follow it. This keeps the last 8 bytes of the message, which hold the
+* counter with COUNTER, in the tail until the hash is finalized.
+*/
+void hash_message_update(hash_message_ctx *ctx,
+                         const uint8_t *m,
+                         uint64_t mlen)
+{
+  uint64_t block = 2 * ctx->n;
+  uint64_t blocks, take;
+  HASH_STATS_ENTER(HASH_STATS_MESSAGE);
+
+  while (mlen > 0) {
+    if (ctx->taillen >= block && ctx->taillen - block + mlen >= 8) {
+      state_blocks(ctx->func, ctx->n, ctx->backend, &ctx->state, ctx->tail, 1);
+      ctx->taillen -= block;
+      memmove(ctx->tail, ctx->tail + block, ctx->taillen);
+    }
+    else if (ctx->taillen == 0 && mlen >= block + 8) {
+      blocks = (mlen - 8) / block;
+      state_blocks(ctx->func, ctx->n, ctx->backend, &ctx->state, m, blocks);
+      m += blocks * block;
+      mlen -= blocks * block;
+    }
+    else {
+      /* Fill the tail up to a whole block; beyond that only the final
+      bytes are ever buffered, which always fit. */
+      take = ctx->taillen < block ? block - ctx->taillen : mlen;
+      if (take > mlen) {
+        take = mlen;
+      }
+      memcpy(ctx->tail + ctx->taillen, m, take);
+      ctx->taillen += take;
+      m += take;
+      mlen -= take;
+    }
+  }
+  HASH_STATS_LEAVE();
+}
+
+/*
+* Computes the message hash of everything absorbed so far. The context is
+* left as it is, and can be finalized again.
+*/
+void hash_message_final(uint8_t *out, const hash_message_ctx *ctx)
+{
+  HASH_STATS_ENTER(HASH_STATS_MESSAGE);
+  HASH_STATS_INC();
+  state_final(ctx->func, ctx->n, ctx->backend, out, &ctx->state, ctx->tail,
+              ctx->taillen);
+  HASH_STATS_LEAVE();
+}
+
+/*
+* Computes the message hash with the given counter in place of the last 8
+* bytes of the message, which is how the COUNTER variant grinds for a better
+* hash. Only the tail is hashed again for every counter value. Returns -1 if
+* the message is shorter than 8 bytes.
+*/
+int hash_message_final_counter(uint8_t *out,
+                               hash_message_ctx *ctx,
+                               uint64_t counter)
+{
+  if (ctx->taillen < 8) {
+    return -1;
+  }
+  memcpy(ctx->tail + ctx->taillen - 8, &counter, 8);
+  hash_message_final(out, ctx);
+  return 0;
+}
+
+/*
+* Computes the leaf of the pos-th message in a Merkle batch that is signed
+* with index idx. The 4n-byte prefix fills exactly two SHA-256 (or SHA-512)
+* blocks, so the message can be hashed where it is, without copying it behind
+* the prefix.
+*/
+int hash_batch_message(const xmss_params *params,
+                       uint8_t *out,
+                       const uint8_t *pub_seed,
+                       uint64_t idx,
+                       uint32_t pos,
+                       const uint8_t *m,
+                       uint64_t mlen)
+{
+  /* toByte(X, n) || PUB_SEED || toByte(idx, n) || toByte(pos, n) || M */
+  uint8_t buf[4 * XMSS_MAX_N];
+  hash_state state;
+  uint64_t blocks = mlen / (2 * params->n);
+
+  if (params->n != 32 && params->n != 64) {
+    return -1;
+  }
+  ull_to_bytes(buf, params->n, XMSS_HASH_PADDING_BATCH);
+  memcpy(buf + params->n, pub_seed, params->n);
+  ull_to_bytes(buf + 2 * params->n, params->n, idx);
+  ull_to_bytes(buf + 3 * params->n, params->n, pos);
+
+  HASH_STATS_ENTER(HASH_STATS_MESSAGE);
+  HASH_STATS_INC();
+  state_init(params->func, params->n, params->backend, &state, buf, 2);
+  state_blocks(params->func, params->n, params->backend, &state, m, blocks);
+  state_final(params->func, params->n, params->backend, out, &state,
+              m + 2 * params->n * blocks, mlen - 2 * params->n * blocks);
+  HASH_STATS_LEAVE();
+  return 0;
 }
 
 /**
@@ -124,28 +670,22 @@ int thash_h(const xmss_params *params,
 {
   uint8_t buf[4 * params->n];
   uint8_t bitmask[2 * params->n];
-  uint8_t addr_as_bytes[32];
   uint32_t i;
 
+  HASH_STATS_COUNT(HASH_STATS_THASH_H, 1);
   /* Set the function padding. */
   ull_to_bytes(buf, params->n, XMSS_HASH_PADDING_H);
 
   /* Generate the n-byte key. */
   set_key_and_mask(addr, 0);
-  addr_to_bytes(addr_as_bytes, addr);
-
-  PRF(params, buf + params->n, addr_as_bytes, pub_seed);
+  prf_keyed(params, buf + params->n, (const uint8_t *)addr, pub_seed);
 
   /* Generate the 2n-byte mask. */
   set_key_and_mask(addr, 1);
-  addr_to_bytes(addr_as_bytes, addr);
-
-  PRF(params, bitmask, addr_as_bytes, pub_seed);
+  prf_keyed(params, bitmask, (const uint8_t *)addr, pub_seed);
 
   set_key_and_mask(addr, 2);
-  addr_to_bytes(addr_as_bytes, addr);
-
-  PRF(params, bitmask + params->n, addr_as_bytes, pub_seed);
+  prf_keyed(params, bitmask + params->n, (const uint8_t *)addr, pub_seed);
 
   for (i = 0; i < 2 * params->n; i++) {
     buf[2 * params->n + i] = in[i] ^ bitmask[i];
@@ -161,26 +701,71 @@ int thash_f(const xmss_params *params,
 {
   uint8_t buf[3 * params->n];
   uint8_t bitmask[params->n];
-  uint8_t addr_as_bytes[32];
   uint32_t i;
 
+  HASH_STATS_COUNT(HASH_STATS_THASH_F, 1);
   /* Set the function padding. */
   ull_to_bytes(buf, params->n, XMSS_HASH_PADDING_F);
 
   /* Generate the n-byte key. */
   set_key_and_mask(addr, 0);
-  addr_to_bytes(addr_as_bytes, addr);
-
-  PRF(params, buf + params->n, addr_as_bytes, pub_seed);
+  PRF(params, buf + params->n, (const uint8_t *)addr, pub_seed);
 
   /* Generate the n-byte mask. */
   set_key_and_mask(addr, 1);
-  addr_to_bytes(addr_as_bytes, addr);
-
-  PRF(params, bitmask, addr_as_bytes, pub_seed);
+  PRF(params, bitmask, (const uint8_t *)addr, pub_seed);
 
   for (i = 0; i < params->n; i++) {
     buf[2 * params->n + i] = in[i] ^ bitmask[i];
   }
   return core_hash(params, out, buf, 3 * params->n);
 }
+
+/*
+* Computes thash_f for count inputs at once. The keys, the masks and the final
+* hashes are each computed in one call to the multi-buffer functions, which
+* hash as many inputs in parallel as the backend has lanes.
+*/
+int thash_f_multi(const xmss_params *params,
+                  uint8_t **out,
+                  const uint8_t **in,
+                  const uint8_t *pub_seed,
+                  uint32_t (*addrs)[8],
+                  uint32_t count)
+{
+  uint8_t buf[count][3 * params->n];
+  uint8_t bitmask[count][params->n];
+  uint8_t *key_out[count], *mask_out[count];
+  const uint8_t *addr_in[count], *buf_in[count];
+  uint32_t i, j;
+
+  if (params->n != 32 && params->n != 64) {
+    return -1;
+  }
+  HASH_STATS_COUNT(HASH_STATS_THASH_F, count);
+
+  /* Generate the n-byte keys. */
+  for (i = 0; i < count; i++) {
+    ull_to_bytes(buf[i], params->n, XMSS_HASH_PADDING_F);
+    set_key_and_mask(addrs[i], 0);
+    key_out[i] = buf[i] + params->n;
+    addr_in[i] = (const uint8_t *)addrs[i];
+  }
+  prf_multi(params, key_out, addr_in, pub_seed, count);
+
+  /* Generate the n-byte masks. The addresses are read where they are. */
+  for (i = 0; i < count; i++) {
+    set_key_and_mask(addrs[i], 1);
+    mask_out[i] = bitmask[i];
+  }
+  prf_multi(params, mask_out, addr_in, pub_seed, count);
+
+  for (i = 0; i < count; i++) {
+    for (j = 0; j < params->n; j++) {
+      buf[i][2 * params->n + j] = in[i][j] ^ bitmask[i][j];
+    }
+    buf_in[i] = buf[i];
+  }
+  state_final_multi(params, out, NULL, buf_in, 3 * params->n, count);
+  return 0;
+}
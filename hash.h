@@ -4,17 +4,127 @@
 #include <stdint.h>
 #include "params.h"
 #include "sha2.h"
+#include "hash_backend.h"
+#include "fips202.h"
 
 #define SHA256(in,inlen,out) sha256(out,in,inlen)
 
-void addr_to_bytes(uint8_t *bytes,
-                   const uint32_t addr[8]);
+/* The state of a hash after its first input blocks, for any function: SHA-256
+and SHAKE128 for n = 32, SHA-512 and SHAKE256 for n = 64. */
+typedef union {
+  sha256ctx sha256;
+  sha512ctx sha512;
+  shake128incctx shake128;
+  shake256incctx shake256;
+} hash_state;
+
+/* A message hash that is computed over a message passed in pieces. The last
+bytes of the message are held back in tail until the hash is finalized, so
+that COUNTER can put its value into the last 8 of them. */
+typedef struct {
+  uint32_t func;
+  uint32_t n;
+  const xmss_hash_backend *backend;
+  hash_state state;
+  uint8_t tail[2 * XMSS_MAX_N + 8];
+  uint64_t taillen;
+} hash_message_ctx;
+
+/* The kinds of calls that are counted per thread. HASH_STATS_CALLS counts
+every hash function call, as hash_stats_count does; HASH_STATS_COMPRESS
+counts SHA-2 compression function calls or Keccak permutations. */
+#define HASH_STATS_CALLS 0
+#define HASH_STATS_CORE_HASH 1
+#define HASH_STATS_PRF 2
+#define HASH_STATS_THASH_F 3
+#define HASH_STATS_THASH_H 4
+#define HASH_STATS_COMPRESS 5
+#define HASH_STATS_TYPES 6
+
+/* The phases calls are attributed to. A phase that is entered while another
+one is active is part of the outer one, so that for instance the leaves BDS
+computes count as BDS rather than as WOTS and L-tree. */
+#define HASH_STATS_OTHER 0
+#define HASH_STATS_MESSAGE 1
+#define HASH_STATS_GRIND 2
+#define HASH_STATS_WOTS 3
+#define HASH_STATS_LTREE 4
+#define HASH_STATS_AUTH 5
+#define HASH_STATS_BDS 6
+#define HASH_STATS_PHASES 7
+
+#if HASH_STATS
+#define HASH_STATS_INC() hash_stats_inc()
+#define HASH_STATS_ADD(calls) hash_stats_add(calls)
+#define HASH_STATS_COUNT(type, calls) hash_stats_count_type(type, calls)
+#define HASH_STATS_ENTER(phase) uint32_t hash_stats_prev = hash_stats_enter(phase)
+#define HASH_STATS_LEAVE() hash_stats_leave(hash_stats_prev)
+
+/* Counts one hash function call of the calling thread. */
+void hash_stats_inc(void);
+
+/* Counts the given number of hash function calls of the calling thread. */
+void hash_stats_add(uint64_t calls);
+
+/* Counts calls of the given kind in the current phase of the thread. */
+void hash_stats_count_type(uint32_t type, uint64_t calls);
+
+/* Returns the number of hash function calls made by the calling thread. */
+uint64_t hash_stats_count(void);
+
+/**
+ * Returns the calls of the given kind that the calling thread made in phase,
+ * or in all phases if phase is HASH_STATS_PHASES.
+ */
+uint64_t hash_stats_get(uint32_t type, uint32_t phase);
+
+/* Makes phase the current one, unless another phase is active, and returns
+the phase to pass to hash_stats_leave. */
+uint32_t hash_stats_enter(uint32_t phase);
+
+void hash_stats_leave(uint32_t prev);
+
+/* Return short names of kinds of calls and of phases, for reports. */
+const char *hash_stats_type_name(uint32_t type);
+const char *hash_stats_phase_name(uint32_t phase);
+
+/* Resets the hash function call counters of the calling thread. */
+void hash_stats_reset(void);
+#else
+#define HASH_STATS_INC()
+#define HASH_STATS_ADD(calls)
+#define HASH_STATS_COUNT(type, calls)
+#define HASH_STATS_ENTER(phase)
+#define HASH_STATS_LEAVE()
+#endif
+
+typedef struct prf_cache prf_cache;
+
+/**
+ * Creates a cache of up to entries outputs of PRF(pub_seed, addr), for the
+ * keys and bitmasks of the hash tree nodes in thash_h. It is used for params
+ * whose prf_cache points to it, and is not thread-safe. Entries of higher
+ * nodes, which more signatures share, are never replaced by entries of lower
+ * ones. Returns NULL if entries is 0 or on failure.
+ */
+prf_cache *prf_cache_new(const xmss_params *params,
+                         const uint8_t *pub_seed,
+                         uint32_t entries);
+
+void prf_cache_free(prf_cache *cache);
 
 int prf(const xmss_params *params,
         uint8_t *out,
         const uint8_t in[32],
         const uint8_t *key);
 
+/* Computes PRF(key, in[i]) for count 32-byte inputs. */
+int prf_multi(const xmss_params *params,
+              uint8_t **out,
+              const uint8_t **in,
+              const uint8_t *key,
+              uint32_t count);
+
 int prf2(const xmss_params *params,
          uint8_t *out,
          const uint8_t in[32],
@@ -40,6 +150,15 @@ int thash_f(const xmss_params *params,
             const uint8_t *pub_seed,
             uint32_t addr[8]);
 
+/* Computes thash_f over count independent inputs, the i-th one with address
+addrs[i], using the multi-buffer functions of the hash backend. */
+int thash_f_multi(const xmss_params *params,
+                  uint8_t **out,
+                  const uint8_t **in,
+                  const uint8_t *pub_seed,
+                  uint32_t (*addrs)[8],
+                  uint32_t count);
+
 int hash_message(const xmss_params *params,
                  uint8_t *out,
                  const uint8_t *R,
@@ -48,4 +167,28 @@ int hash_message(const xmss_params *params,
                  uint8_t *m_with_prefix,
                  uint64_t mlen);
 
+int hash_message_init(const xmss_params *params,
+                      hash_message_ctx *ctx,
+                      const uint8_t *R,
+                      const uint8_t *root,
+                      uint64_t idx);
+
+void hash_message_update(hash_message_ctx *ctx,
+                         const uint8_t *m,
+                         uint64_t mlen);
+
+void hash_message_final(uint8_t *out, const hash_message_ctx *ctx);
+
+int hash_message_final_counter(uint8_t *out,
+                               hash_message_ctx *ctx,
+                               uint64_t counter);
+
+int hash_batch_message(const xmss_params *params,
+                       uint8_t *out,
+                       const uint8_t *pub_seed,
+                       uint64_t idx,
+                       uint32_t pos,
+                       const uint8_t *m,
+                       uint64_t mlen);
+
 #endif
@@ -1,24 +1,37 @@
 #include <stdint.h>
 
+#include "hash_address.h"
+
+/* Writes word i of the address in its big-endian byte form. */
+static void set_addr_word(uint32_t addr[8], int i, uint32_t word)
+{
+    uint8_t *bytes = (uint8_t *)addr + 4 * i;
+
+    bytes[0] = (uint8_t)(word >> 24);
+    bytes[1] = (uint8_t)(word >> 16);
+    bytes[2] = (uint8_t)(word >> 8);
+    bytes[3] = (uint8_t)word;
+}
+
 void set_layer_addr(uint32_t addr[8], uint32_t layer)
 {
-    addr[0] = layer;
+    set_addr_word(addr, 0, layer);
 }
 
 void set_tree_addr(uint32_t addr[8], uint64_t tree)
 {
-    addr[1] = (uint32_t) (tree >> 32);
-    addr[2] = (uint32_t) tree;
+    set_addr_word(addr, 1, (uint32_t) (tree >> 32));
+    set_addr_word(addr, 2, (uint32_t) tree);
 }
 
 void set_type(uint32_t addr[8], uint32_t type)
 {
-    addr[3] = type;
+    set_addr_word(addr, 3, type);
 }
 
 void set_key_and_mask(uint32_t addr[8], uint32_t key_and_mask)
 {
-    addr[7] = key_and_mask;
+    set_addr_word(addr, 7, key_and_mask);
 }
 
 void copy_subtree_addr(uint32_t out[8], const uint32_t in[8])
@@ -32,34 +45,34 @@ void copy_subtree_addr(uint32_t out[8], const uint32_t in[8])
 
 void set_ots_addr(uint32_t addr[8], uint32_t ots)
 {
-    addr[4] = ots;
+    set_addr_word(addr, 4, ots);
 }
 
 void set_chain_addr(uint32_t addr[8], uint32_t chain)
 {
-    addr[5] = chain;
+    set_addr_word(addr, 5, chain);
 }
 
 void set_hash_addr(uint32_t addr[8], uint32_t hash)
 {
-    addr[6] = hash;
+    set_addr_word(addr, 6, hash);
 }
 
 /* This function is used for L-tree addresses. */
 
 void set_ltree_addr(uint32_t addr[8], uint32_t ltree)
 {
-    addr[4] = ltree;
+    set_addr_word(addr, 4, ltree);
 }
 
 /* These functions are used for hash tree addresses. */
 
 void set_tree_height(uint32_t addr[8], uint32_t tree_height)
 {
-    addr[5] = tree_height;
+    set_addr_word(addr, 5, tree_height);
 }
 
 void set_tree_index(uint32_t addr[8], uint32_t tree_index)
 {
-    addr[6] = tree_index;
+    set_addr_word(addr, 6, tree_index);
 }
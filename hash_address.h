@@ -6,6 +6,11 @@
 #define XMSS_ADDR_TYPE_OTS 0
 #define XMSS_ADDR_TYPE_LTREE 1
 #define XMSS_ADDR_TYPE_HASHTREE 2
+#define XMSS_ADDR_TYPE_BATCH 3
+
+/* An address is kept in the byte form in which it is hashed: every word is
+stored big-endian, so (const uint8_t *)addr can be passed to the PRF as it
+is, and the setters below only write the word they change. */
 
 void set_layer_addr(uint32_t addr[8], uint32_t layer);
 
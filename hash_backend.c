@@ -0,0 +1,543 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "hash_backend.h"
+#include "params.h"
+#include "sha2.h"
+
+/* The widest lane compression functions of any backend. */
+#define SHA256_MAX_LANES 16
+#define SHA512_MAX_LANES 8
+/* The widest lane permutation of any backend. */
+#define KECCAK_MAX_LANES 8
+
+static const uint32_t sha256_iv[8] = {
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+  0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static const uint64_t sha512_iv[8] = {
+  0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL,
+  0xa54ff53a5f1d36f1ULL, 0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+  0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+static uint32_t load_bigendian_32(const uint8_t *x)
+{
+  return (uint32_t)(x[3]) | (((uint32_t)(x[2])) << 8) |
+    (((uint32_t)(x[1])) << 16) | (((uint32_t)(x[0])) << 24);
+}
+
+static void store_bigendian_32(uint8_t *x, uint32_t u)
+{
+  x[0] = (uint8_t)(u >> 24);
+  x[1] = (uint8_t)(u >> 16);
+  x[2] = (uint8_t)(u >> 8);
+  x[3] = (uint8_t)u;
+}
+
+static uint64_t load_bigendian_64(const uint8_t *x)
+{
+  return ((uint64_t)load_bigendian_32(x) << 32) | load_bigendian_32(x + 4);
+}
+
+static void store_bigendian_64(uint8_t *x, uint64_t u)
+{
+  store_bigendian_32(x, (uint32_t)(u >> 32));
+  store_bigendian_32(x + 4, (uint32_t)u);
+}
+
+static uint64_t load_littleendian_64(const uint8_t *x)
+{
+  uint64_t r = 0;
+  int i;
+
+  for (i = 7; i >= 0; i--) {
+    r = (r << 8) | x[i];
+  }
+  return r;
+}
+
+static void store_littleendian_64(uint8_t *x, uint64_t u)
+{
+  int i;
+
+  for (i = 0; i < 8; i++) {
+    x[i] = (uint8_t)(u >> (8 * i));
+  }
+}
+
+/* Writes the padding of a message of bytes bytes, of which the last inlen
+(less than 64) are in in, and returns the number of blocks it fills. */
+static size_t sha256_pad(uint8_t padded[128],
+                         const uint8_t *in,
+                         size_t inlen,
+                         uint64_t bytes)
+{
+  size_t blocks = inlen < 56 ? 1 : 2;
+
+  memcpy(padded, in, inlen);
+  padded[inlen] = 0x80;
+  memset(padded + inlen + 1, 0, 64 * blocks - 8 - inlen - 1);
+  store_bigendian_64(padded + 64 * blocks - 8, bytes << 3);
+  return blocks;
+}
+
+void sha256_backend_blocks(sha256_compress_fn compress,
+                           sha256ctx *state,
+                           const uint8_t *in,
+                           size_t inblocks)
+{
+  uint32_t words[8];
+  int i;
+
+  for (i = 0; i < 8; i++) {
+    words[i] = load_bigendian_32(state->ctx + 4 * i);
+  }
+  compress(words, in, inblocks);
+  for (i = 0; i < 8; i++) {
+    store_bigendian_32(state->ctx + 4 * i, words[i]);
+  }
+  store_bigendian_64(state->ctx + 32,
+                     load_bigendian_64(state->ctx + 32) + 64 * inblocks);
+}
+
+void sha256_backend_finalize(sha256_compress_fn compress,
+                             uint8_t *out,
+                             sha256ctx *state,
+                             const uint8_t *in,
+                             size_t inlen)
+{
+  uint64_t bytes = load_bigendian_64(state->ctx + 32) + inlen;
+  uint8_t padded[128];
+  uint32_t words[8];
+  int i;
+
+  for (i = 0; i < 8; i++) {
+    words[i] = load_bigendian_32(state->ctx + 4 * i);
+  }
+  compress(words, in, inlen / 64);
+  in += inlen & ~(size_t)63;
+  compress(words, padded, sha256_pad(padded, in, inlen & 63, bytes));
+  for (i = 0; i < 8; i++) {
+    store_bigendian_32(state->ctx + 4 * i, words[i]);
+    store_bigendian_32(out + 4 * i, words[i]);
+  }
+}
+
+void sha256_backend_multi(sha256_compress_lanes_fn compress,
+                          uint32_t lanes,
+                          uint8_t **out,
+                          const sha256ctx *state,
+                          const uint8_t **in,
+                          size_t inlen,
+                          uint32_t count)
+{
+  uint32_t words[8 * SHA256_MAX_LANES];
+  uint8_t padded[SHA256_MAX_LANES][128];
+  const uint8_t *blocks[SHA256_MAX_LANES];
+  uint64_t bytes = (state == NULL ? 0 : load_bigendian_64(state->ctx + 32))
+                   + inlen;
+  uint32_t init[8];
+  uint32_t group, used, i, j;
+  size_t b, padblocks = 0;
+
+  for (i = 0; i < 8; i++) {
+    init[i] = state == NULL ? sha256_iv[i] : load_bigendian_32(state->ctx + 4 * i);
+  }
+
+  for (group = 0; group < count; group += lanes) {
+    used = count - group < lanes ? count - group : lanes;
+
+    for (i = 0; i < 8; i++) {
+      for (j = 0; j < lanes; j++) {
+        words[i * lanes + j] = init[i];
+      }
+    }
+    /* Unused lanes repeat the first input; their results are dropped. */
+    for (b = 0; b < inlen / 64; b++) {
+      for (j = 0; j < lanes; j++) {
+        blocks[j] = in[group + (j < used ? j : 0)] + 64 * b;
+      }
+      compress(words, blocks);
+    }
+    for (j = 0; j < used; j++) {
+      padblocks = sha256_pad(padded[j], in[group + j] + (inlen & ~(size_t)63),
+                             inlen & 63, bytes);
+    }
+    for (b = 0; b < padblocks; b++) {
+      for (j = 0; j < lanes; j++) {
+        blocks[j] = padded[j < used ? j : 0] + 64 * b;
+      }
+      compress(words, blocks);
+    }
+
+    for (j = 0; j < used; j++) {
+      for (i = 0; i < 8; i++) {
+        store_bigendian_32(out[group + j] + 4 * i, words[i * lanes + j]);
+      }
+    }
+  }
+}
+
+/* Writes the SHA-512 padding of a message of bytes bytes, of which the last
+inlen (less than 128) are in in, and returns the number of blocks it fills. */
+static size_t sha512_pad(uint8_t padded[256],
+                         const uint8_t *in,
+                         size_t inlen,
+                         uint64_t bytes)
+{
+  size_t blocks = inlen < 112 ? 1 : 2;
+
+  memcpy(padded, in, inlen);
+  padded[inlen] = 0x80;
+  memset(padded + inlen + 1, 0, 128 * blocks - 8 - inlen - 1);
+  padded[128 * blocks - 9] = (uint8_t)(bytes >> 61);
+  store_bigendian_64(padded + 128 * blocks - 8, bytes << 3);
+  return blocks;
+}
+
+void sha512_backend_multi(sha512_compress_lanes_fn compress,
+                          uint32_t lanes,
+                          uint8_t **out,
+                          const sha512ctx *state,
+                          const uint8_t **in,
+                          size_t inlen,
+                          uint32_t count)
+{
+  uint64_t words[8 * SHA512_MAX_LANES];
+  uint8_t padded[SHA512_MAX_LANES][256];
+  const uint8_t *blocks[SHA512_MAX_LANES];
+  uint64_t bytes = (state == NULL ? 0 : load_bigendian_64(state->ctx + 64))
+                   + inlen;
+  uint64_t init[8];
+  uint32_t group, used, i, j;
+  size_t b, padblocks = 0;
+
+  for (i = 0; i < 8; i++) {
+    init[i] = state == NULL ? sha512_iv[i] : load_bigendian_64(state->ctx + 8 * i);
+  }
+
+  for (group = 0; group < count; group += lanes) {
+    used = count - group < lanes ? count - group : lanes;
+
+    for (i = 0; i < 8; i++) {
+      for (j = 0; j < lanes; j++) {
+        words[i * lanes + j] = init[i];
+      }
+    }
+    /* Unused lanes repeat the first input; their results are dropped. */
+    for (b = 0; b < inlen / 128; b++) {
+      for (j = 0; j < lanes; j++) {
+        blocks[j] = in[group + (j < used ? j : 0)] + 128 * b;
+      }
+      compress(words, blocks);
+    }
+    for (j = 0; j < used; j++) {
+      padblocks = sha512_pad(padded[j], in[group + j] + (inlen & ~(size_t)127),
+                             inlen & 127, bytes);
+    }
+    for (b = 0; b < padblocks; b++) {
+      for (j = 0; j < lanes; j++) {
+        blocks[j] = padded[j < used ? j : 0] + 128 * b;
+      }
+      compress(words, blocks);
+    }
+
+    for (j = 0; j < used; j++) {
+      for (i = 0; i < 8; i++) {
+        store_bigendian_64(out[group + j] + 8 * i, words[i * lanes + j]);
+      }
+    }
+  }
+}
+
+void sha512_portable_multi(uint8_t **out,
+                           const sha512ctx *state,
+                           const uint8_t **in,
+                           size_t inlen,
+                           uint32_t count)
+{
+  sha512ctx s;
+  uint32_t i;
+
+  for (i = 0; i < count; i++) {
+    if (state == NULL) {
+      sha512_inc_init(&s);
+    }
+    else {
+      sha512_inc_clone_state(&s, state);
+    }
+    sha512_inc_finalize(out[i], &s, in[i], inlen);
+  }
+}
+
+/* Finishes count SHAKE hashes of the given rate, from the words of an
+incremental state, or from scratch if it is NULL. */
+static void keccak_backend_multi(keccak_permute_lanes_fn permute,
+                                 uint32_t lanes,
+                                 uint32_t rate,
+                                 uint8_t **out,
+                                 size_t outlen,
+                                 const uint64_t *state,
+                                 const uint8_t **in,
+                                 size_t inlen,
+                                 uint32_t count)
+{
+  uint64_t words[25 * KECCAK_MAX_LANES];
+  uint64_t start = state == NULL ? 0 : state[25];
+  uint64_t pos;
+  uint32_t group, used, i, j;
+  size_t k;
+
+  for (group = 0; group < count; group += lanes) {
+    used = count - group < lanes ? count - group : lanes;
+
+    for (i = 0; i < 25; i++) {
+      for (j = 0; j < lanes; j++) {
+        words[i * lanes + j] = state == NULL ? 0 : state[i];
+      }
+    }
+    /* All lanes start at the same position and absorb as many bytes, so
+    their blocks end together. Unused lanes absorb nothing. Whole words are
+    absorbed at once where the position allows it. */
+    pos = start;
+    for (k = 0; k < inlen; ) {
+      if ((pos & 7) == 0 && inlen - k >= 8) {
+        for (j = 0; j < used; j++) {
+          words[(pos >> 3) * lanes + j] ^= load_littleendian_64(in[group + j] + k);
+        }
+        pos += 8;
+        k += 8;
+      }
+      else {
+        for (j = 0; j < used; j++) {
+          words[(pos >> 3) * lanes + j] ^= (uint64_t)in[group + j][k] << (8 * (pos & 7));
+        }
+        pos++;
+        k++;
+      }
+      if (pos == rate) {
+        permute(words);
+        pos = 0;
+      }
+    }
+    for (j = 0; j < lanes; j++) {
+      words[(pos >> 3) * lanes + j] ^= (uint64_t)0x1F << (8 * (pos & 7));
+      words[((rate - 1) >> 3) * lanes + j] ^= (uint64_t)128 << (8 * ((rate - 1) & 7));
+    }
+
+    for (k = 0; k < outlen; ) {
+      pos = k % rate;
+      if (pos == 0) {
+        permute(words);
+      }
+      if ((pos & 7) == 0 && outlen - k >= 8) {
+        for (j = 0; j < used; j++) {
+          store_littleendian_64(out[group + j] + k, words[(pos >> 3) * lanes + j]);
+        }
+        k += 8;
+      }
+      else {
+        for (j = 0; j < used; j++) {
+          out[group + j][k] = (uint8_t)(words[(pos >> 3) * lanes + j] >> (8 * (pos & 7)));
+        }
+        k++;
+      }
+    }
+  }
+}
+
+void shake128_backend_multi(keccak_permute_lanes_fn permute,
+                            uint32_t lanes,
+                            uint8_t **out,
+                            size_t outlen,
+                            const shake128incctx *state,
+                            const uint8_t **in,
+                            size_t inlen,
+                            uint32_t count)
+{
+  keccak_backend_multi(permute, lanes, SHAKE128_RATE, out, outlen,
+                       state == NULL ? NULL : state->ctx, in, inlen, count);
+}
+
+void shake256_backend_multi(keccak_permute_lanes_fn permute,
+                            uint32_t lanes,
+                            uint8_t **out,
+                            size_t outlen,
+                            const shake256incctx *state,
+                            const uint8_t **in,
+                            size_t inlen,
+                            uint32_t count)
+{
+  keccak_backend_multi(permute, lanes, SHAKE256_RATE, out, outlen,
+                       state == NULL ? NULL : state->ctx, in, inlen, count);
+}
+
+void shake128_portable_multi(uint8_t **out,
+                             size_t outlen,
+                             const shake128incctx *state,
+                             const uint8_t **in,
+                             size_t inlen,
+                             uint32_t count)
+{
+  shake128incctx s;
+  uint32_t i;
+
+  for (i = 0; i < count; i++) {
+    if (state == NULL) {
+      shake128_inc_init(&s);
+    }
+    else {
+      shake128_inc_ctx_clone(&s, state);
+    }
+    shake128_inc_absorb(&s, in[i], inlen);
+    shake128_inc_finalize(&s);
+    shake128_inc_squeeze(out[i], outlen, &s);
+  }
+}
+
+void shake256_portable_multi(uint8_t **out,
+                             size_t outlen,
+                             const shake256incctx *state,
+                             const uint8_t **in,
+                             size_t inlen,
+                             uint32_t count)
+{
+  shake256incctx s;
+  uint32_t i;
+
+  for (i = 0; i < count; i++) {
+    if (state == NULL) {
+      shake256_inc_init(&s);
+    }
+    else {
+      shake256_inc_ctx_clone(&s, state);
+    }
+    shake256_inc_absorb(&s, in[i], inlen);
+    shake256_inc_finalize(&s);
+    shake256_inc_squeeze(out[i], outlen, &s);
+  }
+}
+
+/* The portable backend is the reference implementation in sha2.c. */
+
+static int portable_supported(void)
+{
+  return 1;
+}
+
+static void portable_hash_multi(uint8_t **out,
+                                const uint8_t **in,
+                                size_t inlen,
+                                uint32_t count)
+{
+  uint32_t i;
+
+  for (i = 0; i < count; i++) {
+    sha256(out[i], in[i], inlen);
+  }
+}
+
+static void portable_prf_multi(uint8_t **out,
+                               const sha256ctx *state,
+                               const uint8_t **in,
+                               size_t inlen,
+                               uint32_t count)
+{
+  sha256ctx s;
+  uint32_t i;
+
+  for (i = 0; i < count; i++) {
+    sha256_inc_clone_state(&s, state);
+    sha256_inc_finalize(out[i], &s, in[i], inlen);
+  }
+}
+
+const xmss_hash_backend xmss_hash_portable = {
+  "portable", 1, portable_supported, sha256, portable_hash_multi,
+  sha256_inc_blocks, sha256_inc_finalize, portable_prf_multi,
+  1, shake128_portable_multi, shake256_portable_multi,
+  1, sha512_portable_multi
+};
+
+/* All built-in backends, the fastest first. */
+static const xmss_hash_backend *const backends[] = {
+#if XMSS_HASH_X86
+  &xmss_hash_shani,
+  &xmss_hash_avx512,
+  &xmss_hash_avx2,
+#endif
+#ifdef XMSS_HASH_LIBCRYPTO
+  &xmss_hash_libcrypto,
+#endif
+  &xmss_hash_portable
+};
+
+const xmss_hash_backend *xmss_hash_backend_get(uint32_t i)
+{
+  uint32_t k;
+
+  for (k = 0; k < sizeof(backends) / sizeof(backends[0]); k++) {
+    if (backends[k]->supported() && i-- == 0) {
+      return backends[k];
+    }
+  }
+  return NULL;
+}
+
+const xmss_hash_backend *xmss_hash_backend_find(const char *name)
+{
+  const xmss_hash_backend *b;
+  uint32_t i;
+
+  for (i = 0; (b = xmss_hash_backend_get(i)) != NULL; i++) {
+    if (!strcmp(b->name, name)) {
+      return b;
+    }
+  }
+  return NULL;
+}
+
+static pthread_once_t default_once = PTHREAD_ONCE_INIT;
+static const xmss_hash_backend *default_backend;
+static const xmss_hash_backend *default_shake_backend;
+static const xmss_hash_backend *default_sha512_backend;
+
+static void default_init(void)
+{
+  const char *name = getenv("XMSS_HASH_BACKEND");
+  const xmss_hash_backend *b;
+  uint32_t i;
+
+  if (name != NULL) {
+    default_backend = xmss_hash_backend_find(name);
+    default_shake_backend = default_backend;
+    default_sha512_backend = default_backend;
+  }
+  if (default_backend == NULL) {
+    default_backend = xmss_hash_backend_get(0);
+    /* For SHAKE and SHA-512, prefer the most lanes. */
+    default_shake_backend = default_backend;
+    default_sha512_backend = default_backend;
+    for (i = 0; (b = xmss_hash_backend_get(i)) != NULL; i++) {
+      if (b->keccak_lanes > default_shake_backend->keccak_lanes) {
+        default_shake_backend = b;
+      }
+      if (b->sha512_lanes > default_sha512_backend->sha512_lanes) {
+        default_sha512_backend = b;
+      }
+    }
+  }
+}
+
+const xmss_hash_backend *xmss_hash_backend_default(uint32_t func, uint32_t n)
+{
+  pthread_once(&default_once, default_init);
+  if (func == XMSS_SHAKE) {
+    return default_shake_backend;
+  }
+  return n == 64 ? default_sha512_backend : default_backend;
+}
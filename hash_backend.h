@@ -0,0 +1,242 @@
+#ifndef XMSS_HASH_BACKEND_H
+#define XMSS_HASH_BACKEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sha2.h"
+#include "fips202.h"
+
+/* The SIMD backends select their instruction set per function with target
+attributes, so they are built without any special compiler flags. Whether
+they can run is checked on the host when a backend is chosen. */
+#if defined(__x86_64__) && defined(__GNUC__)
+#define XMSS_HASH_X86 1
+#else
+#define XMSS_HASH_X86 0
+#endif
+
+/* A hash backend implements the hash functions of the hashing layer. All
+backends keep
+incremental states in the layout of sha256ctx (sha512ctx, shake128incctx),
+so a midstate computed by one backend can be finished by any other, and they
+all produce the same output.
+
+    hash         hashes a single input
+    hash_multi   hashes count inputs of inlen bytes each
+    inc_blocks   absorbs whole 64-byte blocks into a midstate
+    inc_finalize absorbs the remaining bytes and pads
+    prf_multi    finishes count hashes that all start from the same keyed
+                 midstate, over inputs of inlen bytes each
+
+and for the SHAKE parameter sets and those with n = 64
+
+    shake128_multi  finishes count SHAKE128 hashes of outlen bytes, all
+                    starting from state (or from scratch if it is NULL)
+    shake256_multi  the same for SHAKE256
+    sha512_multi    finishes count SHA-512 hashes over inputs of inlen bytes
+                    each, all starting from state (or from the initial value
+                    if it is NULL)
+
+Single SHA-512 and SHAKE hashes are computed by sha2.c and fips202.c. The
+multi-buffer functions take any count; backends that hash several inputs at
+once do so in groups of lanes (SHA-256), keccak_lanes (Keccak) or
+sha512_lanes (SHA-512) inputs. */
+typedef struct xmss_hash_backend {
+  const char *name;
+  uint32_t lanes;
+  int (*supported)(void);
+  void (*hash)(uint8_t *out, const uint8_t *in, size_t inlen);
+  void (*hash_multi)(uint8_t **out, const uint8_t **in, size_t inlen,
+                     uint32_t count);
+  void (*inc_blocks)(sha256ctx *state, const uint8_t *in, size_t inblocks);
+  void (*inc_finalize)(uint8_t *out, sha256ctx *state, const uint8_t *in,
+                       size_t inlen);
+  void (*prf_multi)(uint8_t **out, const sha256ctx *state, const uint8_t **in,
+                    size_t inlen, uint32_t count);
+  uint32_t keccak_lanes;
+  void (*shake128_multi)(uint8_t **out, size_t outlen,
+                         const shake128incctx *state, const uint8_t **in,
+                         size_t inlen, uint32_t count);
+  void (*shake256_multi)(uint8_t **out, size_t outlen,
+                         const shake256incctx *state, const uint8_t **in,
+                         size_t inlen, uint32_t count);
+  uint32_t sha512_lanes;
+  void (*sha512_multi)(uint8_t **out, const sha512ctx *state,
+                       const uint8_t **in, size_t inlen, uint32_t count);
+} xmss_hash_backend;
+
+extern const xmss_hash_backend xmss_hash_portable;
+#if XMSS_HASH_X86
+extern const xmss_hash_backend xmss_hash_shani;
+extern const xmss_hash_backend xmss_hash_avx2;
+extern const xmss_hash_backend xmss_hash_avx512;
+#endif
+#ifdef XMSS_HASH_LIBCRYPTO
+extern const xmss_hash_backend xmss_hash_libcrypto;
+#endif
+
+/**
+ * Returns the i-th backend that is built in and supported by the host, or
+ * NULL after the last one.
+ */
+const xmss_hash_backend *xmss_hash_backend_get(uint32_t i);
+
+/**
+ * Returns the backend with the given name, or NULL if it is not built in or
+ * not supported by the host.
+ */
+const xmss_hash_backend *xmss_hash_backend_find(const char *name);
+
+/**
+ * Returns the backend that new parameter sets of the hash function func and
+ * output length n use: the one named in the environment variable
+ * XMSS_HASH_BACKEND if it is supported, and otherwise the fastest one the
+ * host supports for func and n.
+ */
+const xmss_hash_backend *xmss_hash_backend_default(uint32_t func, uint32_t n);
+
+/* Helpers for implementing backends. A compression function works on the
+state as eight words, and absorbs inblocks 64-byte blocks. A lane compression
+function absorbs one block into each of lanes states, kept word by word:
+state[i * lanes + j] is word i of lane j. */
+typedef void (*sha256_compress_fn)(uint32_t state[8],
+                                   const uint8_t *in,
+                                   size_t inblocks);
+
+typedef void (*sha256_compress_lanes_fn)(uint32_t *state,
+                                         const uint8_t **in);
+
+void sha256_backend_blocks(sha256_compress_fn compress,
+                           sha256ctx *state,
+                           const uint8_t *in,
+                           size_t inblocks);
+
+void sha256_backend_finalize(sha256_compress_fn compress,
+                             uint8_t *out,
+                             sha256ctx *state,
+                             const uint8_t *in,
+                             size_t inlen);
+
+/**
+ * Finishes count hashes over inputs of inlen bytes each, all starting from
+ * state, or from the initial value if state is NULL, lanes at a time.
+ */
+void sha256_backend_multi(sha256_compress_lanes_fn compress,
+                          uint32_t lanes,
+                          uint8_t **out,
+                          const sha256ctx *state,
+                          const uint8_t **in,
+                          size_t inlen,
+                          uint32_t count);
+
+/* A SHA-512 lane compression function works like a SHA-256 one, on 64-bit
+words and 128-byte blocks. */
+typedef void (*sha512_compress_lanes_fn)(uint64_t *state,
+                                         const uint8_t **in);
+
+/**
+ * Finishes count SHA-512 hashes over inputs of inlen bytes each, all starting
+ * from state, or from the initial value if state is NULL, lanes at a time.
+ */
+void sha512_backend_multi(sha512_compress_lanes_fn compress,
+                          uint32_t lanes,
+                          uint8_t **out,
+                          const sha512ctx *state,
+                          const uint8_t **in,
+                          size_t inlen,
+                          uint32_t count);
+
+/* SHA-512 one input at a time, for the backends without SHA-512 lanes. */
+void sha512_portable_multi(uint8_t **out,
+                           const sha512ctx *state,
+                           const uint8_t **in,
+                           size_t inlen,
+                           uint32_t count);
+
+/* A lane permutation applies Keccak-f[1600] to lanes states, kept word by
+word: state[i * lanes + j] is word i of lane j. */
+typedef void (*keccak_permute_lanes_fn)(uint64_t *state);
+
+/**
+ * Finishes count SHAKE128 hashes of outlen bytes over inputs of inlen bytes
+ * each, all starting from state, or from scratch if it is NULL, lanes at a
+ * time.
+ */
+void shake128_backend_multi(keccak_permute_lanes_fn permute,
+                            uint32_t lanes,
+                            uint8_t **out,
+                            size_t outlen,
+                            const shake128incctx *state,
+                            const uint8_t **in,
+                            size_t inlen,
+                            uint32_t count);
+
+/* The same for SHAKE256. */
+void shake256_backend_multi(keccak_permute_lanes_fn permute,
+                            uint32_t lanes,
+                            uint8_t **out,
+                            size_t outlen,
+                            const shake256incctx *state,
+                            const uint8_t **in,
+                            size_t inlen,
+                            uint32_t count);
+
+/* SHAKE128 and SHAKE256 one input at a time, for the backends without
+Keccak lanes. */
+void shake128_portable_multi(uint8_t **out,
+                             size_t outlen,
+                             const shake128incctx *state,
+                             const uint8_t **in,
+                             size_t inlen,
+                             uint32_t count);
+
+void shake256_portable_multi(uint8_t **out,
+                             size_t outlen,
+                             const shake256incctx *state,
+                             const uint8_t **in,
+                             size_t inlen,
+                             uint32_t count);
+
+#if XMSS_HASH_X86
+void shake128_avx2_multi(uint8_t **out,
+                         size_t outlen,
+                         const shake128incctx *state,
+                         const uint8_t **in,
+                         size_t inlen,
+                         uint32_t count);
+
+void shake128_avx512_multi(uint8_t **out,
+                           size_t outlen,
+                           const shake128incctx *state,
+                           const uint8_t **in,
+                           size_t inlen,
+                           uint32_t count);
+
+void shake256_avx2_multi(uint8_t **out,
+                         size_t outlen,
+                         const shake256incctx *state,
+                         const uint8_t **in,
+                         size_t inlen,
+                         uint32_t count);
+
+void shake256_avx512_multi(uint8_t **out,
+                           size_t outlen,
+                           const shake256incctx *state,
+                           const uint8_t **in,
+                           size_t inlen,
+                           uint32_t count);
+
+void sha512_avx2_multi(uint8_t **out,
+                       const sha512ctx *state,
+                       const uint8_t **in,
+                       size_t inlen,
+                       uint32_t count);
+
+void sha512_avx512_multi(uint8_t **out,
+                         const sha512ctx *state,
+                         const uint8_t **in,
+                         size_t inlen,
+                         uint32_t count);
+#endif
+
+#endif
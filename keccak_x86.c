@@ -0,0 +1,181 @@
+/* Keccak-f[1600] on several independent states at once for x86-64: 4 lanes
+* with AVX2 and 8 lanes with AVX-512. The states are kept word by word, so
+* that every word of all lanes is one vector register. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hash_backend.h"
+#include "fips202.h"
+
+#if XMSS_HASH_X86
+
+#include <immintrin.h>
+
+#define NROUNDS 24
+
+static const uint64_t KeccakF_RoundConstants[NROUNDS] = {
+  0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL,
+  0x8000000080008000ULL, 0x000000000000808bULL, 0x0000000080000001ULL,
+  0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008aULL,
+  0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+  0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL,
+  0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
+  0x000000000000800aULL, 0x800000008000000aULL, 0x8000000080008081ULL,
+  0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+/* One round on the words A[x + 5y] of all lanes, with B, C and D as
+* temporaries. It is written in terms of XOR(x, y), XOR3(x, y, z), ROL(x, c)
+* and CHI(x, y, z) = x ^ (~y & z), which each instruction set defines. */
+#define KECCAK_ROUND(A, B, C, D, rc) \
+  /* theta */                                                            \
+  C[0] = XOR(XOR3(A[0], A[5], A[10]), XOR(A[15], A[20]));                \
+  C[1] = XOR(XOR3(A[1], A[6], A[11]), XOR(A[16], A[21]));                \
+  C[2] = XOR(XOR3(A[2], A[7], A[12]), XOR(A[17], A[22]));                \
+  C[3] = XOR(XOR3(A[3], A[8], A[13]), XOR(A[18], A[23]));                \
+  C[4] = XOR(XOR3(A[4], A[9], A[14]), XOR(A[19], A[24]));                \
+  D = XOR(C[4], ROL(C[1], 1));                                           \
+  A[0] = XOR(A[0], D); A[5] = XOR(A[5], D); A[10] = XOR(A[10], D);       \
+  A[15] = XOR(A[15], D); A[20] = XOR(A[20], D);                          \
+  D = XOR(C[0], ROL(C[2], 1));                                           \
+  A[1] = XOR(A[1], D); A[6] = XOR(A[6], D); A[11] = XOR(A[11], D);       \
+  A[16] = XOR(A[16], D); A[21] = XOR(A[21], D);                          \
+  D = XOR(C[1], ROL(C[3], 1));                                           \
+  A[2] = XOR(A[2], D); A[7] = XOR(A[7], D); A[12] = XOR(A[12], D);       \
+  A[17] = XOR(A[17], D); A[22] = XOR(A[22], D);                          \
+  D = XOR(C[2], ROL(C[4], 1));                                           \
+  A[3] = XOR(A[3], D); A[8] = XOR(A[8], D); A[13] = XOR(A[13], D);       \
+  A[18] = XOR(A[18], D); A[23] = XOR(A[23], D);                          \
+  D = XOR(C[3], ROL(C[0], 1));                                           \
+  A[4] = XOR(A[4], D); A[9] = XOR(A[9], D); A[14] = XOR(A[14], D);       \
+  A[19] = XOR(A[19], D); A[24] = XOR(A[24], D);                          \
+  /* rho and pi */                                                       \
+  B[0] = A[0]; B[10] = ROL(A[1], 1); B[20] = ROL(A[2], 62);              \
+  B[5] = ROL(A[3], 28); B[15] = ROL(A[4], 27);                           \
+  B[16] = ROL(A[5], 36); B[1] = ROL(A[6], 44); B[11] = ROL(A[7], 6);     \
+  B[21] = ROL(A[8], 55); B[6] = ROL(A[9], 20);                           \
+  B[7] = ROL(A[10], 3); B[17] = ROL(A[11], 10); B[2] = ROL(A[12], 43);   \
+  B[12] = ROL(A[13], 25); B[22] = ROL(A[14], 39);                        \
+  B[23] = ROL(A[15], 41); B[8] = ROL(A[16], 45); B[18] = ROL(A[17], 15); \
+  B[3] = ROL(A[18], 21); B[13] = ROL(A[19], 8);                          \
+  B[14] = ROL(A[20], 18); B[24] = ROL(A[21], 2); B[9] = ROL(A[22], 61);  \
+  B[19] = ROL(A[23], 56); B[4] = ROL(A[24], 14);                         \
+  /* chi and iota */                                                     \
+  A[0] = CHI(B[0], B[1], B[2]); A[1] = CHI(B[1], B[2], B[3]);            \
+  A[2] = CHI(B[2], B[3], B[4]); A[3] = CHI(B[3], B[4], B[0]);            \
+  A[4] = CHI(B[4], B[0], B[1]);                                          \
+  A[5] = CHI(B[5], B[6], B[7]); A[6] = CHI(B[6], B[7], B[8]);            \
+  A[7] = CHI(B[7], B[8], B[9]); A[8] = CHI(B[8], B[9], B[5]);            \
+  A[9] = CHI(B[9], B[5], B[6]);                                          \
+  A[10] = CHI(B[10], B[11], B[12]); A[11] = CHI(B[11], B[12], B[13]);    \
+  A[12] = CHI(B[12], B[13], B[14]); A[13] = CHI(B[13], B[14], B[10]);    \
+  A[14] = CHI(B[14], B[10], B[11]);                                      \
+  A[15] = CHI(B[15], B[16], B[17]); A[16] = CHI(B[16], B[17], B[18]);    \
+  A[17] = CHI(B[17], B[18], B[19]); A[18] = CHI(B[18], B[19], B[15]);    \
+  A[19] = CHI(B[19], B[15], B[16]);                                      \
+  A[20] = CHI(B[20], B[21], B[22]); A[21] = CHI(B[21], B[22], B[23]);    \
+  A[22] = CHI(B[22], B[23], B[24]); A[23] = CHI(B[23], B[24], B[20]);    \
+  A[24] = CHI(B[24], B[20], B[21]);                                      \
+  A[0] = XOR(A[0], rc)
+
+/* ====== AVX2, 4 lanes ==== */
+
+#define XOR(x, y) _mm256_xor_si256(x, y)
+#define XOR3(x, y, z) XOR(XOR(x, y), z)
+#define ROL(x, c) _mm256_or_si256(_mm256_slli_epi64(x, c), _mm256_srli_epi64(x, 64 - (c)))
+#define CHI(x, y, z) XOR(x, _mm256_andnot_si256(y, z))
+
+__attribute__((target("avx2")))
+static void keccak_permute_avx2(uint64_t *state)
+{
+  __m256i A[25], B[25], C[5], D;
+  int i;
+
+  for (i = 0; i < 25; i++) {
+    A[i] = _mm256_loadu_si256((const __m256i *)(state + 4 * i));
+  }
+  for (i = 0; i < NROUNDS; i++) {
+    KECCAK_ROUND(A, B, C, D, _mm256_set1_epi64x((long long)KeccakF_RoundConstants[i]));
+  }
+  for (i = 0; i < 25; i++) {
+    _mm256_storeu_si256((__m256i *)(state + 4 * i), A[i]);
+  }
+}
+
+#undef XOR
+#undef XOR3
+#undef ROL
+#undef CHI
+
+void shake128_avx2_multi(uint8_t **out,
+                         size_t outlen,
+                         const shake128incctx *state,
+                         const uint8_t **in,
+                         size_t inlen,
+                         uint32_t count)
+{
+  shake128_backend_multi(keccak_permute_avx2, 4, out, outlen, state, in, inlen, count);
+}
+
+void shake256_avx2_multi(uint8_t **out,
+                         size_t outlen,
+                         const shake256incctx *state,
+                         const uint8_t **in,
+                         size_t inlen,
+                         uint32_t count)
+{
+  shake256_backend_multi(keccak_permute_avx2, 4, out, outlen, state, in, inlen, count);
+}
+
+/* ====== AVX-512, 8 lanes ==== */
+
+/* 0x96 and 0xD2 are the truth tables of x ^ y ^ z and x ^ (~y & z). */
+#define XOR(x, y) _mm512_xor_si512(x, y)
+#define XOR3(x, y, z) _mm512_ternarylogic_epi64(x, y, z, 0x96)
+#define ROL(x, c) _mm512_rol_epi64(x, c)
+#define CHI(x, y, z) _mm512_ternarylogic_epi64(x, y, z, 0xD2)
+
+__attribute__((target("avx512f")))
+static void keccak_permute_avx512(uint64_t *state)
+{
+  __m512i A[25], B[25], C[5], D;
+  int i;
+
+  for (i = 0; i < 25; i++) {
+    A[i] = _mm512_loadu_si512((const void *)(state + 8 * i));
+  }
+  for (i = 0; i < NROUNDS; i++) {
+    KECCAK_ROUND(A, B, C, D, _mm512_set1_epi64((long long)KeccakF_RoundConstants[i]));
+  }
+  for (i = 0; i < 25; i++) {
+    _mm512_storeu_si512((void *)(state + 8 * i), A[i]);
+  }
+}
+
+#undef XOR
+#undef XOR3
+#undef ROL
+#undef CHI
+
+void shake128_avx512_multi(uint8_t **out,
+                           size_t outlen,
+                           const shake128incctx *state,
+                           const uint8_t **in,
+                           size_t inlen,
+                           uint32_t count)
+{
+  shake128_backend_multi(keccak_permute_avx512, 8, out, outlen, state, in, inlen, count);
+}
+
+void shake256_avx512_multi(uint8_t **out,
+                           size_t outlen,
+                           const shake256incctx *state,
+                           const uint8_t **in,
+                           size_t inlen,
+                           uint32_t count)
+{
+  shake256_backend_multi(keccak_permute_avx512, 8, out, outlen, state, in, inlen, count);
+}
+
+#endif
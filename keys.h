@@ -1,2 +1,2 @@
 uint8_t pk[68] = { 0, 0, 0, 1, 73, 40, 103, 225, 212, 197, 111, 233, 67, 152, 23, 185, 32, 175, 229, 210, 5, 196, 126, 137, 201, 135, 157, 65, 213, 101, 98, 52, 197, 16, 39, 160, 145, 136, 38, 20, 145, 224, 50, 66, 43, 62, 132, 210, 185, 115, 105, 173, 60, 113, 16, 162, 244, 39, 252, 241, 149, 162, 100, 157, 247, 246, 52, 92 };
-uint8_t sk[1377] = { 0, 0, 0, 1, 0, 0, 0, 0, 231, 182, 34, 99, 159, 155, 87, 163, 46, 64, 241, 221, 71, 207, 1, 122, 230, 90, 3, 212, 59, 90, 167, 47, 13, 140, 176, 167, 21, 248, 199, 159, 7, 250, 23, 220, 122, 214, 54, 197, 140, 242, 20, 11, 243, 243, 193, 226, 113, 161, 104, 79, 17, 22, 105, 138, 185, 193, 22, 241, 219, 120, 108, 87, 73, 40, 103, 225, 212, 197, 111, 233, 67, 152, 23, 185, 32, 175, 229, 210, 5, 196, 126, 137, 201, 135, 157, 65, 213, 101, 98, 52, 197, 16, 39, 160, 145, 136, 38, 20, 145, 224, 50, 66, 43, 62, 132, 210, 185, 115, 105, 173, 60, 113, 16, 162, 244, 39, 252, 241, 149, 162, 100, 157, 247, 246, 52, 92, 112, 88, 228, 235, 255, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 107, 188, 1, 228, 30, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 32, 87, 228, 235, 255, 127, 0, 0, 224, 226, 0, 228, 30, 127, 0, 0, 127, 166, 0, 228, 30, 127, 0, 0, 16, 151, 34, 228, 30, 127, 0, 0, 91, 126, 1, 228, 30, 127, 0, 0, 1, 0, 1, 0, 255, 127, 0, 0, 104, 50, 71, 236, 255, 127, 0, 0, 40, 111, 192, 2, 0, 0, 0, 0, 225, 81, 219, 227, 30, 127, 0, 0, 48, 86, 228, 235, 255, 127, 0, 0, 0, 0, 0, 0, 30, 127, 0, 0, 56, 151, 34, 228, 30, 127, 0, 0, 84, 23, 1, 228, 30, 127, 0, 0, 144, 85, 228, 235, 255, 127, 0, 0, 112, 145, 34, 228, 30, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 95, 175, 0, 228, 30, 127, 0, 0, 0, 0, 52, 228, 30, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 80, 84, 228, 235, 255, 127, 0, 0, 208, 25, 193, 227, 30, 127, 0, 0, 105, 254, 157, 1, 0, 0, 0, 0, 193, 8, 0, 228, 30, 127, 0, 0, 128, 4, 0, 228, 30, 127, 0, 0, 108, 26, 192, 227, 30, 127, 0, 0, 29, 0, 0, 0, 30, 127, 0, 0, 0, 0, 0, 0, 30, 127, 0, 0, 0, 86, 228, 235, 255, 127, 0, 0, 3, 0, 0, 0, 30, 127, 0, 0, 240, 85, 228, 235, 255, 127, 0, 0, 0, 0, 0, 0, 255, 127, 0, 0, 16, 5, 52, 228, 30, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 52, 228, 30, 127, 0, 0, 225, 81, 219, 227, 30, 127, 0, 0, 95, 154, 127, 103, 0, 0, 0, 0, 200, 148, 34, 228, 30, 127, 0, 0, 32, 87, 228, 235, 255, 127, 0, 0, 136, 9, 52, 228, 30, 127, 0, 0, 0, 0, 0, 0, 30, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 229, 165, 151, 217, 89, 210, 63, 104, 206, 149, 121, 148, 165, 133, 243, 61, 166, 32, 72, 224, 9, 235, 205, 243, 118, 226, 174, 150, 156, 198, 43, 252, 224, 100, 107, 16, 94, 14, 93, 202, 14, 60, 88, 86, 35, 210, 141, 9, 89, 68, 129, 83, 254, 242, 99, 85, 228, 208, 30, 146, 138, 179, 107, 178, 225, 2, 203, 177, 147, 90, 24, 130, 44, 62, 69, 61, 191, 69, 105, 250, 47, 4, 124, 40, 222, 202, 85, 21, 196, 173, 242, 94, 233, 16, 221, 240, 36, 38, 245, 185, 121, 239, 46, 83, 21, 124, 115, 253, 127, 142, 121, 176, 220, 176, 254, 56, 161, 37, 7, 198, 118, 227, 135, 94, 115, 41, 54, 38, 57, 243, 222, 78, 176, 34, 35, 85, 59, 219, 141, 152, 212, 243, 120, 164, 66, 76, 28, 54, 103, 83, 200, 237, 94, 79, 83, 147, 3, 73, 173, 34, 188, 187, 92, 243, 36, 254, 125, 70, 77, 250, 198, 54, 230, 90, 95, 127, 175, 223, 120, 253, 194, 55, 129, 80, 253, 85, 158, 105, 73, 59, 73, 129, 252, 246, 32, 2, 128, 28, 61, 174, 247, 72, 20, 162, 202, 86, 73, 43, 249, 138, 69, 184, 18, 79, 245, 246, 244, 183, 224, 142, 122, 43, 208, 8, 110, 246, 14, 112, 139, 83, 49, 248, 18, 171, 24, 109, 103, 41, 208, 106, 40, 241, 127, 207, 41, 185, 57, 0, 180, 33, 103, 62, 130, 246, 230, 148, 98, 172, 36, 94, 84, 124, 232, 218, 21, 31, 139, 167, 107, 213, 245, 38, 128, 112, 252, 81, 140, 2, 196, 77, 56, 3, 57, 206, 102, 85, 186, 65, 65, 69, 161, 124, 90, 153, 130, 62, 99, 246, 28, 183, 178, 61, 113, 83, 57, 225, 158, 63, 180, 190, 41, 198, 164, 46, 31, 39, 240, 56, 74, 233, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 240, 6, 0, 228, 30, 127, 0, 0, 200, 148, 34, 228, 30, 127, 0, 0, 112, 87, 228, 235, 255, 127, 0, 0, 0, 0, 0, 228, 30, 127, 0, 0, 20, 9, 0, 228, 30, 127, 0, 0, 192, 3, 0, 228, 30, 127, 0, 0, 72, 128, 34, 228, 30, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 240, 137, 34, 228, 30, 127, 0, 0, 232, 80, 192, 227, 30, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 10, 0, 228, 30, 127, 0, 0, 128, 4, 0, 0, 0, 0, 0, 0, 39, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 39, 219, 4, 190, 208, 22, 178, 159, 39, 164, 36, 130, 112, 131, 37, 71, 215, 168, 221, 214, 142, 101, 110, 106, 3, 112, 45, 223, 47, 95, 157, 229, 1, 0, 0, 0, 0, 0, 1, 82, 34, 6, 211, 87, 92, 234, 173, 228, 116, 244, 152, 53, 178, 218, 178, 42, 220, 53, 99, 22, 90, 31, 231, 222, 63, 74, 77, 254, 55, 17, 235, 2, 0, 0, 215, 68, 0, 1, 119, 201, 47, 146, 138, 101, 184, 35, 90, 50, 3, 120, 56, 183, 38, 5, 183, 120, 234, 55, 102, 110, 64, 252, 185, 246, 129, 12, 99, 244, 202, 115, 3, 127, 0, 0, 0, 0, 1, 136, 65, 247, 136, 119, 135, 69, 102, 23, 174, 180, 106, 111, 120, 118, 251, 229, 28, 116, 41, 92, 64, 87, 170, 183, 228, 118, 20, 174, 220, 117, 34, 4, 30, 127, 0, 0, 0, 1, 16, 194, 45, 121, 132, 238, 99, 236, 6, 199, 2, 229, 65, 53, 21, 2, 41, 49, 248, 139, 176, 159, 236, 228, 62, 107, 238, 158, 129, 200, 22, 52, 5, 227, 30, 127, 0, 0, 1, 62, 220, 228, 25, 176, 162, 52, 130, 68, 252, 223, 233, 191, 97, 92, 113, 154, 230, 237, 239, 122, 68, 250, 125, 244, 69, 205, 12, 239, 225, 181, 172, 6, 254, 227, 30, 127, 0, 1, 154, 45, 20, 122, 148, 245, 59, 147, 28, 228, 233, 43, 122, 108, 253, 212, 1, 199, 78, 154, 135, 172, 219, 126, 185, 103, 165, 141, 9, 58, 151, 101, 7, 248, 166, 1, 110, 0, 1, 60, 121, 127, 173, 82, 44, 246, 79, 145, 197, 119, 167, 119, 89, 229, 195, 118, 52, 55, 53, 89, 118, 16, 225, 113, 31, 60, 12, 148, 217, 127, 76, 8, 32, 0, 0, 0, 0, 1, 251, 221, 150, 39, 255, 102, 10, 116, 54, 119, 89, 216, 253, 254, 174, 211, 184, 173, 113, 79, 103, 218, 212, 242, 153, 150, 7, 150, 168, 156, 206, 201, 9, 0, 239, 177, 0, 0, 1, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 16, 90, 228, 235, 255, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+uint8_t sk[1381] = { 0, 0, 0, 1, 0, 0, 0, 0, 231, 182, 34, 99, 159, 155, 87, 163, 46, 64, 241, 221, 71, 207, 1, 122, 230, 90, 3, 212, 59, 90, 167, 47, 13, 140, 176, 167, 21, 248, 199, 159, 7, 250, 23, 220, 122, 214, 54, 197, 140, 242, 20, 11, 243, 243, 193, 226, 113, 161, 104, 79, 17, 22, 105, 138, 185, 193, 22, 241, 219, 120, 108, 87, 73, 40, 103, 225, 212, 197, 111, 233, 67, 152, 23, 185, 32, 175, 229, 210, 5, 196, 126, 137, 201, 135, 157, 65, 213, 101, 98, 52, 197, 16, 39, 160, 145, 136, 38, 20, 145, 224, 50, 66, 43, 62, 132, 210, 185, 115, 105, 173, 60, 113, 16, 162, 244, 39, 252, 241, 149, 162, 100, 157, 247, 246, 52, 92, 112, 88, 228, 235, 255, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 107, 188, 1, 228, 30, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 32, 87, 228, 235, 255, 127, 0, 0, 224, 226, 0, 228, 30, 127, 0, 0, 127, 166, 0, 228, 30, 127, 0, 0, 16, 151, 34, 228, 30, 127, 0, 0, 91, 126, 1, 228, 30, 127, 0, 0, 1, 0, 1, 0, 255, 127, 0, 0, 104, 50, 71, 236, 255, 127, 0, 0, 40, 111, 192, 2, 0, 0, 0, 0, 225, 81, 219, 227, 30, 127, 0, 0, 48, 86, 228, 235, 255, 127, 0, 0, 0, 0, 0, 0, 30, 127, 0, 0, 56, 151, 34, 228, 30, 127, 0, 0, 84, 23, 1, 228, 30, 127, 0, 0, 144, 85, 228, 235, 255, 127, 0, 0, 112, 145, 34, 228, 30, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 95, 175, 0, 228, 30, 127, 0, 0, 0, 0, 52, 228, 30, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 80, 84, 228, 235, 255, 127, 0, 0, 208, 25, 193, 227, 30, 127, 0, 0, 105, 254, 157, 1, 0, 0, 0, 0, 193, 8, 0, 228, 30, 127, 0, 0, 128, 4, 0, 228, 30, 127, 0, 0, 108, 26, 192, 227, 30, 127, 0, 0, 29, 0, 0, 0, 30, 127, 0, 0, 0, 0, 0, 0, 30, 127, 0, 0, 0, 86, 228, 235, 255, 127, 0, 0, 3, 0, 0, 0, 30, 127, 0, 0, 240, 85, 228, 235, 255, 127, 0, 0, 0, 0, 0, 0, 255, 127, 0, 0, 16, 5, 52, 228, 30, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 52, 228, 30, 127, 0, 0, 225, 81, 219, 227, 30, 127, 0, 0, 95, 154, 127, 103, 0, 0, 0, 0, 200, 148, 34, 228, 30, 127, 0, 0, 32, 87, 228, 235, 255, 127, 0, 0, 136, 9, 52, 228, 30, 127, 0, 0, 0, 0, 0, 0, 30, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 229, 165, 151, 217, 89, 210, 63, 104, 206, 149, 121, 148, 165, 133, 243, 61, 166, 32, 72, 224, 9, 235, 205, 243, 118, 226, 174, 150, 156, 198, 43, 252, 224, 100, 107, 16, 94, 14, 93, 202, 14, 60, 88, 86, 35, 210, 141, 9, 89, 68, 129, 83, 254, 242, 99, 85, 228, 208, 30, 146, 138, 179, 107, 178, 225, 2, 203, 177, 147, 90, 24, 130, 44, 62, 69, 61, 191, 69, 105, 250, 47, 4, 124, 40, 222, 202, 85, 21, 196, 173, 242, 94, 233, 16, 221, 240, 36, 38, 245, 185, 121, 239, 46, 83, 21, 124, 115, 253, 127, 142, 121, 176, 220, 176, 254, 56, 161, 37, 7, 198, 118, 227, 135, 94, 115, 41, 54, 38, 57, 243, 222, 78, 176, 34, 35, 85, 59, 219, 141, 152, 212, 243, 120, 164, 66, 76, 28, 54, 103, 83, 200, 237, 94, 79, 83, 147, 3, 73, 173, 34, 188, 187, 92, 243, 36, 254, 125, 70, 77, 250, 198, 54, 230, 90, 95, 127, 175, 223, 120, 253, 194, 55, 129, 80, 253, 85, 158, 105, 73, 59, 73, 129, 252, 246, 32, 2, 128, 28, 61, 174, 247, 72, 20, 162, 202, 86, 73, 43, 249, 138, 69, 184, 18, 79, 245, 246, 244, 183, 224, 142, 122, 43, 208, 8, 110, 246, 14, 112, 139, 83, 49, 248, 18, 171, 24, 109, 103, 41, 208, 106, 40, 241, 127, 207, 41, 185, 57, 0, 180, 33, 103, 62, 130, 246, 230, 148, 98, 172, 36, 94, 84, 124, 232, 218, 21, 31, 139, 167, 107, 213, 245, 38, 128, 112, 252, 81, 140, 2, 196, 77, 56, 3, 57, 206, 102, 85, 186, 65, 65, 69, 161, 124, 90, 153, 130, 62, 99, 246, 28, 183, 178, 61, 113, 83, 57, 225, 158, 63, 180, 190, 41, 198, 164, 46, 31, 39, 240, 56, 74, 233, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 240, 6, 0, 228, 30, 127, 0, 0, 200, 148, 34, 228, 30, 127, 0, 0, 112, 87, 228, 235, 255, 127, 0, 0, 0, 0, 0, 228, 30, 127, 0, 0, 20, 9, 0, 228, 30, 127, 0, 0, 192, 3, 0, 228, 30, 127, 0, 0, 72, 128, 34, 228, 30, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 240, 137, 34, 228, 30, 127, 0, 0, 232, 80, 192, 227, 30, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 10, 0, 228, 30, 127, 0, 0, 128, 4, 0, 0, 0, 0, 0, 0, 39, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 39, 219, 4, 190, 208, 22, 178, 159, 39, 164, 36, 130, 112, 131, 37, 71, 215, 168, 221, 214, 142, 101, 110, 106, 3, 112, 45, 223, 47, 95, 157, 229, 82, 34, 6, 211, 87, 92, 234, 173, 228, 116, 244, 152, 53, 178, 218, 178, 42, 220, 53, 99, 22, 90, 31, 231, 222, 63, 74, 77, 254, 55, 17, 235, 119, 201, 47, 146, 138, 101, 184, 35, 90, 50, 3, 120, 56, 183, 38, 5, 183, 120, 234, 55, 102, 110, 64, 252, 185, 246, 129, 12, 99, 244, 202, 115, 136, 65, 247, 136, 119, 135, 69, 102, 23, 174, 180, 106, 111, 120, 118, 251, 229, 28, 116, 41, 92, 64, 87, 170, 183, 228, 118, 20, 174, 220, 117, 34, 16, 194, 45, 121, 132, 238, 99, 236, 6, 199, 2, 229, 65, 53, 21, 2, 41, 49, 248, 139, 176, 159, 236, 228, 62, 107, 238, 158, 129, 200, 22, 52, 62, 220, 228, 25, 176, 162, 52, 130, 68, 252, 223, 233, 191, 97, 92, 113, 154, 230, 237, 239, 122, 68, 250, 125, 244, 69, 205, 12, 239, 225, 181, 172, 154, 45, 20, 122, 148, 245, 59, 147, 28, 228, 233, 43, 122, 108, 253, 212, 1, 199, 78, 154, 135, 172, 219, 126, 185, 103, 165, 141, 9, 58, 151, 101, 60, 121, 127, 173, 82, 44, 246, 79, 145, 197, 119, 167, 119, 89, 229, 195, 118, 52, 55, 53, 89, 118, 16, 225, 113, 31, 60, 12, 148, 217, 127, 76, 251, 221, 150, 39, 255, 102, 10, 116, 54, 119, 89, 216, 253, 254, 174, 211, 184, 173, 113, 79, 103, 218, 212, 242, 153, 150, 7, 150, 168, 156, 206, 201, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 16, 90, 228, 235, 255, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 215, 68, 127, 0, 0, 0, 30, 127, 0, 0, 227, 30, 127, 0, 254, 227, 30, 127, 248, 166, 1, 110, 32, 0, 0, 0, 0, 239, 177, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 4, 0 };
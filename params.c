@@ -3,6 +3,7 @@
 
 #include "params.h"
 #include "xmss_core.h"
+#include "hash_backend.h"
 
 int xmss_str_to_oid(uint32_t *oid, const char *s)
 {
@@ -233,8 +234,9 @@ int xmss_parse_oid(xmss_params *params, const uint32_t oid)
     //params->wots_w = 4;
     //params->wots_w = 2;
 
-    // TODO figure out sensible and legal values for this based on the above
+    /* Retain no nodes by default; see xmss_set_bds_k for other trade-offs. */
     params->bds_k = 0;
+    params->grind_bits = XMSS_GRIND_BITS;
 
     return xmss_xmssmt_initialize_params(params);
 }
@@ -438,8 +440,9 @@ int xmssmt_parse_oid(xmss_params *params, const uint32_t oid)
 
     params->wots_w = 16;
 
-    // TODO figure out sensible and legal values for this based on the above
+    /* Retain no nodes by default; see xmss_set_bds_k for other trade-offs. */
     params->bds_k = 0;
+    params->grind_bits = XMSS_GRIND_BITS;
 
     return xmss_xmssmt_initialize_params(params);
 }
@@ -457,6 +460,15 @@ int xmssmt_parse_oid(xmss_params *params, const uint32_t oid)
 int xmss_xmssmt_initialize_params(xmss_params *params)
 {
     params->tree_height = params->full_height  / params->d;
+    /* BDS needs (h - k) / 2 treehash updates per round, so h - k has to be
+    even; with d > 1 at least one update is needed to build the NEXT trees.
+    k = 0 is always allowed, as it is the default for every parameter set. */
+    if (params->bds_k != 0
+        && (params->bds_k > params->tree_height
+            || ((params->tree_height - params->bds_k) & 1)
+            || (params->d > 1 && params->bds_k == params->tree_height))) {
+        return -1;
+    }
     if (params->wots_w == 4) {
         params->wots_log_w = 2;
         params->wots_len1 = 8 * params->n / params->wots_log_w;
@@ -495,6 +507,58 @@ int xmss_xmssmt_initialize_params(xmss_params *params)
 
     params->pk_bytes = 2 * params->n;
     params->sk_bytes = xmss_xmssmt_core_sk_bytes(params);
+    params->backend = xmss_hash_backend_default(params->func, params->n);
+    params->prf_cache = NULL;
+    params->node_cache = NULL;
+    params->wots_table = NULL;
+    params->fast_reject = 0;
+
+    return 0;
+}
 
+/**
+ * Sets the BDS traversal trade-off parameter k of an initialized params
+ * struct and recomputes the dependent sizes. The top k levels of each tree
+ * are retained in the secret key instead of being recomputed via treehash,
+ * which costs (2^k - k - 1) nodes of state and saves k/2 leaf computations
+ * per signature. Apart from the default k = 0, h - k has to be even and k can
+ * be at most h (or h - 2 for XMSSMT), where h is the height of a single tree.
+ * For all XMSS parameter sets this means: any even k up to h.
+ * Returns -1 when k is not valid for the parameter set, 0 otherwise.
+ */
+int xmss_set_bds_k(xmss_params *params, uint32_t bds_k)
+{
+    const struct xmss_hash_backend *backend = params->backend;
+    uint32_t old_k = params->bds_k;
+    int ret;
+
+    params->bds_k = bds_k;
+    ret = xmss_xmssmt_initialize_params(params);
+    /* Keep a backend that was selected before. */
+    params->backend = backend;
+    if (ret) {
+        params->bds_k = old_k;
+        return -1;
+    }
+    return 0;
+}
+
+int xmss_set_grind_bits(xmss_params *params, uint32_t grind_bits)
+{
+    if (grind_bits > 32) {
+        return -1;
+    }
+    params->grind_bits = grind_bits;
+    return 0;
+}
+
+int xmss_set_hash_backend(xmss_params *params, const char *name)
+{
+    const xmss_hash_backend *backend = xmss_hash_backend_find(name);
+
+    if (backend == NULL) {
+        return -1;
+    }
+    params->backend = backend;
     return 0;
 }
@@ -4,7 +4,9 @@
 #include <stdint.h>
 
 /* Use the original method from the RFC */
+#ifndef ORIG
 #define ORIG 0
+#endif
 
 /*
  * Use the hash precomputation trick as described in:
@@ -12,11 +14,18 @@
  * LMS vs XMSS: Comparison of Stateful Hash-Based Signature Schemes on ARM Cortex-M4
  * Fabio Campos and Tim Kohlstadt and Steffen Reith and Marc Stoettinger
  */
+#ifndef PRECOMP
 #define PRECOMP 1
+#endif
 
 #define PRINT_SIGN  0
 #define VERIFY_ONLY 0
 
+/* Count the hash function calls of each thread, see hash_stats_count. */
+#ifndef HASH_STATS
+#define HASH_STATS 0
+#endif
+
 #if PRINT_SIGN
 #define DO_SIGN     1
 #define PRINT_SIGN  1
@@ -52,6 +61,17 @@
 /* This is a result of the OID definitions in the draft; needed for parsing. */
 #define XMSS_OID_LEN 4
 
+/* The default grinding budget of COUNTER: 2^10 counters per signature. */
+#define XMSS_GRIND_BITS 10
+
+/* The largest n of any parameter set. */
+#define XMSS_MAX_N 64
+
+struct xmss_hash_backend;
+struct prf_cache;
+struct xmss_node_cache;
+struct xmss_wots_table;
+
 /* This structure will be populated when calling xmss[mt]_parse_oid. */
 typedef struct {
     uint32_t func;
@@ -70,6 +90,18 @@ typedef struct {
     uint32_t pk_bytes;
     uint64_t sk_bytes;
     uint32_t bds_k;
+    /* COUNTER tries 2^grind_bits counters per signature. */
+    uint32_t grind_bits;
+    const struct xmss_hash_backend *backend;
+    /* Optional cache of PRF outputs under one PUB_SEED, or NULL. */
+    struct prf_cache *prf_cache;
+    /* Optional cache of the upper nodes of the top tree, or NULL. */
+    struct xmss_node_cache *node_cache;
+    /* Optional table of all WOTS public keys and tree nodes, or NULL. */
+    struct xmss_wots_table *wots_table;
+    /* Whether verification rejects as soon as the node cache or the WOTS
+    table contradicts a signature, instead of hashing on to the root. */
+    uint32_t fast_reject;
 } xmss_params;
 
 /**
@@ -106,7 +138,35 @@ int xmssmt_parse_oid(xmss_params *params, const uint32_t oid);
     - func; one of {XMSS_SHA2, XMSS_SHAKE}
     - wots_w; the Winternitz parameter
     - optionally, bds_k; the BDS traversal trade-off parameter,
-    this function initializes the remainder of the params structure. */
+    this function initializes the remainder of the params structure, and
+    selects the default hash backend for func and n (see
+    xmss_hash_backend_default). */
 int xmss_xmssmt_initialize_params(xmss_params *params);
 
+/**
+ * Sets the BDS traversal trade-off parameter k and updates sk_bytes
+ * accordingly. Besides k = 0, valid values have tree_height - k even and are at
+ * most tree_height (below it for XMSSMT). Larger values of k keep more
+ * nodes in the secret key and make signing cheaper and more uniform.
+ * The same k has to be used for key generation and all signatures made
+ * with that key. Returns -1 when k is not valid, 0 otherwise.
+ */
+int xmss_set_bds_k(xmss_params *params, uint32_t bds_k);
+
+/**
+ * Sets the grinding budget of COUNTER: signing tries 2^grind_bits counters and
+ * keeps the one that shortens the WOTS chains most, so every added bit doubles
+ * the message hashes per signature. The default is XMSS_GRIND_BITS; 0 keeps
+ * counter 0. Verification does not depend on it. Returns -1 above 32.
+ */
+int xmss_set_grind_bits(xmss_params *params, uint32_t grind_bits);
+
+/**
+ * Selects the hash backend of an initialized params struct by name, e.g.
+ * "portable", "shani", "avx2", "avx512" or "libcrypto". All backends compute
+ * the same hashes, so keys and signatures do not depend on the choice.
+ * Returns -1 when the backend is not built in or not supported by the host.
+ */
+int xmss_set_hash_backend(xmss_params *params, const char *name);
+
 #endif
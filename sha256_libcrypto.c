@@ -0,0 +1,91 @@
+/* SHA-256 backend on top of the libcrypto of the system, which picks its own
+* assembly for the host. It is only built when XMSS_HASH_LIBCRYPTO is defined,
+* and then needs to be linked with -lcrypto. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hash_backend.h"
+#include "sha2.h"
+
+#ifdef XMSS_HASH_LIBCRYPTO
+
+/* Midstates need the low-level block function, which OpenSSL 3 deprecates. */
+#define OPENSSL_SUPPRESS_DEPRECATED
+#include <openssl/sha.h>
+
+static void libcrypto_compress(uint32_t state[8], const uint8_t *in, size_t inblocks)
+{
+  SHA256_CTX c;
+  int i;
+
+  for (i = 0; i < 8; i++) {
+    c.h[i] = state[i];
+  }
+  while (inblocks--) {
+    SHA256_Transform(&c, in);
+    in += 64;
+  }
+  for (i = 0; i < 8; i++) {
+    state[i] = c.h[i];
+  }
+}
+
+static int libcrypto_supported(void)
+{
+  return 1;
+}
+
+static void libcrypto_hash(uint8_t *out, const uint8_t *in, size_t inlen)
+{
+  SHA256(in, inlen, out);
+}
+
+static void libcrypto_hash_multi(uint8_t **out,
+                                 const uint8_t **in,
+                                 size_t inlen,
+                                 uint32_t count)
+{
+  uint32_t i;
+
+  for (i = 0; i < count; i++) {
+    SHA256(in[i], inlen, out[i]);
+  }
+}
+
+static void libcrypto_inc_blocks(sha256ctx *state, const uint8_t *in, size_t inblocks)
+{
+  sha256_backend_blocks(libcrypto_compress, state, in, inblocks);
+}
+
+static void libcrypto_inc_finalize(uint8_t *out,
+                                   sha256ctx *state,
+                                   const uint8_t *in,
+                                   size_t inlen)
+{
+  sha256_backend_finalize(libcrypto_compress, out, state, in, inlen);
+}
+
+static void libcrypto_prf_multi(uint8_t **out,
+                                const sha256ctx *state,
+                                const uint8_t **in,
+                                size_t inlen,
+                                uint32_t count)
+{
+  sha256ctx s;
+  uint32_t i;
+
+  for (i = 0; i < count; i++) {
+    s = *state;
+    libcrypto_inc_finalize(out[i], &s, in[i], inlen);
+  }
+}
+
+const xmss_hash_backend xmss_hash_libcrypto = {
+  "libcrypto", 1, libcrypto_supported, libcrypto_hash, libcrypto_hash_multi,
+  libcrypto_inc_blocks, libcrypto_inc_finalize, libcrypto_prf_multi,
+  1, shake128_portable_multi, shake256_portable_multi,
+  1, sha512_portable_multi
+};
+
+#endif
@@ -0,0 +1,341 @@
+/* SHA-256 backends for x86-64: SHA-NI for single inputs, and multi-buffer
+* AVX2 (8 lanes) and AVX-512 (16 lanes) for many independent inputs of the
+* same length. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hash_backend.h"
+#include "sha2.h"
+
+#if XMSS_HASH_X86
+
+#include <immintrin.h>
+
+static const uint32_t K256[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+  0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+  0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+  0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+  0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+  0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/* ====== SHA-NI ==== */
+
+__attribute__((target("sha,sse4.1")))
+static void shani_compress(uint32_t state[8], const uint8_t *in, size_t inblocks)
+{
+  const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                       0x0405060700010203ULL);
+  __m128i state0, state1, msg, tmp, abef, cdgh;
+  __m128i w[16];
+  int i;
+
+  /* The round instructions take the state as ABEF and CDGH. */
+  tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)state), 0xB1);
+  state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(state + 4)), 0x1B);
+  state0 = _mm_alignr_epi8(tmp, state1, 8);
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+  while (inblocks--) {
+    abef = state0;
+    cdgh = state1;
+
+    for (i = 0; i < 4; i++) {
+      w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(in + 16 * i)), bswap);
+    }
+    for (i = 0; i < 12; i++) {
+      w[i + 4] = _mm_sha256msg2_epu32(
+        _mm_add_epi32(_mm_sha256msg1_epu32(w[i], w[i + 1]),
+                      _mm_alignr_epi8(w[i + 3], w[i + 2], 4)),
+        w[i + 3]);
+    }
+    for (i = 0; i < 16; i++) {
+      msg = _mm_add_epi32(w[i], _mm_loadu_si128((const __m128i *)(K256 + 4 * i)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      msg = _mm_shuffle_epi32(msg, 0x0E);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+    }
+
+    state0 = _mm_add_epi32(state0, abef);
+    state1 = _mm_add_epi32(state1, cdgh);
+    in += 64;
+  }
+
+  tmp = _mm_shuffle_epi32(state0, 0x1B);
+  state1 = _mm_shuffle_epi32(state1, 0xB1);
+  _mm_storeu_si128((__m128i *)state, _mm_blend_epi16(tmp, state1, 0xF0));
+  _mm_storeu_si128((__m128i *)(state + 4), _mm_alignr_epi8(state1, tmp, 8));
+}
+
+static int shani_supported(void)
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1");
+}
+
+static void shani_inc_blocks(sha256ctx *state, const uint8_t *in, size_t inblocks)
+{
+  sha256_backend_blocks(shani_compress, state, in, inblocks);
+}
+
+static void shani_inc_finalize(uint8_t *out,
+                               sha256ctx *state,
+                               const uint8_t *in,
+                               size_t inlen)
+{
+  sha256_backend_finalize(shani_compress, out, state, in, inlen);
+}
+
+static void shani_hash(uint8_t *out, const uint8_t *in, size_t inlen)
+{
+  sha256ctx state;
+
+  sha256_inc_init(&state);
+  shani_inc_finalize(out, &state, in, inlen);
+}
+
+static void shani_hash_multi(uint8_t **out,
+                             const uint8_t **in,
+                             size_t inlen,
+                             uint32_t count)
+{
+  uint32_t i;
+
+  for (i = 0; i < count; i++) {
+    shani_hash(out[i], in[i], inlen);
+  }
+}
+
+static void shani_prf_multi(uint8_t **out,
+                            const sha256ctx *state,
+                            const uint8_t **in,
+                            size_t inlen,
+                            uint32_t count)
+{
+  sha256ctx s;
+  uint32_t i;
+
+  for (i = 0; i < count; i++) {
+    s = *state;
+    shani_inc_finalize(out[i], &s, in[i], inlen);
+  }
+}
+
+const xmss_hash_backend xmss_hash_shani = {
+  "shani", 1, shani_supported, shani_hash, shani_hash_multi,
+  shani_inc_blocks, shani_inc_finalize, shani_prf_multi,
+  1, shake128_portable_multi, shake256_portable_multi,
+  1, sha512_portable_multi
+};
+
+/* ====== AVX2, 8 lanes ==== */
+
+#define ROTR256(x, c) _mm256_or_si256(_mm256_srli_epi32(x, c), _mm256_slli_epi32(x, 32 - (c)))
+
+/**
+* Loads 8 big-endian words from each of 8 inputs, and transposes them so that
+* w[i] holds word i of all inputs.
+*/
+__attribute__((target("avx2")))
+static inline void avx2_load_transpose(__m256i w[8], const uint8_t **in, size_t offset)
+{
+  const __m256i bswap = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7,
+                                        0, 1, 2, 3, 12, 13, 14, 15, 8, 9, 10, 11,
+                                        4, 5, 6, 7, 0, 1, 2, 3);
+  __m256i r[8], t[8], u[8];
+  int j;
+
+  for (j = 0; j < 8; j++) {
+    r[j] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(in[j] + offset)), bswap);
+  }
+  for (j = 0; j < 8; j += 2) {
+    t[j] = _mm256_unpacklo_epi32(r[j], r[j + 1]);
+    t[j + 1] = _mm256_unpackhi_epi32(r[j], r[j + 1]);
+  }
+  for (j = 0; j < 8; j += 4) {
+    u[j] = _mm256_unpacklo_epi64(t[j], t[j + 2]);
+    u[j + 1] = _mm256_unpackhi_epi64(t[j], t[j + 2]);
+    u[j + 2] = _mm256_unpacklo_epi64(t[j + 1], t[j + 3]);
+    u[j + 3] = _mm256_unpackhi_epi64(t[j + 1], t[j + 3]);
+  }
+  for (j = 0; j < 4; j++) {
+    w[j] = _mm256_permute2x128_si256(u[j], u[j + 4], 0x20);
+    w[j + 4] = _mm256_permute2x128_si256(u[j], u[j + 4], 0x31);
+  }
+}
+
+__attribute__((target("avx2")))
+static void avx2_compress_lanes(uint32_t *state, const uint8_t **in)
+{
+  __m256i s[8], w[16], a, b, c, d, e, f, g, h, t1, t2, s0, s1;
+  int i;
+
+  for (i = 0; i < 8; i++) {
+    s[i] = _mm256_loadu_si256((const __m256i *)(state + 8 * i));
+  }
+  avx2_load_transpose(w, in, 0);
+  avx2_load_transpose(w + 8, in, 32);
+
+  a = s[0]; b = s[1]; c = s[2]; d = s[3];
+  e = s[4]; f = s[5]; g = s[6]; h = s[7];
+
+  for (i = 0; i < 64; i++) {
+    if (i >= 16) {
+      s0 = _mm256_xor_si256(_mm256_xor_si256(ROTR256(w[(i + 1) & 15], 7),
+                                             ROTR256(w[(i + 1) & 15], 18)),
+                            _mm256_srli_epi32(w[(i + 1) & 15], 3));
+      s1 = _mm256_xor_si256(_mm256_xor_si256(ROTR256(w[(i + 14) & 15], 17),
+                                             ROTR256(w[(i + 14) & 15], 19)),
+                            _mm256_srli_epi32(w[(i + 14) & 15], 10));
+      w[i & 15] = _mm256_add_epi32(_mm256_add_epi32(w[i & 15], s0),
+                                   _mm256_add_epi32(w[(i + 9) & 15], s1));
+    }
+    t1 = _mm256_xor_si256(_mm256_xor_si256(ROTR256(e, 6), ROTR256(e, 11)), ROTR256(e, 25));
+    t1 = _mm256_add_epi32(_mm256_add_epi32(h, t1),
+                          _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g)));
+    t1 = _mm256_add_epi32(t1, _mm256_add_epi32(_mm256_set1_epi32(K256[i]), w[i & 15]));
+    t2 = _mm256_xor_si256(_mm256_xor_si256(ROTR256(a, 2), ROTR256(a, 13)), ROTR256(a, 22));
+    t2 = _mm256_add_epi32(t2, _mm256_xor_si256(_mm256_and_si256(a, _mm256_xor_si256(b, c)),
+                                               _mm256_and_si256(b, c)));
+    h = g; g = f; f = e;
+    e = _mm256_add_epi32(d, t1);
+    d = c; c = b; b = a;
+    a = _mm256_add_epi32(t1, t2);
+  }
+
+  s[0] = _mm256_add_epi32(s[0], a); s[1] = _mm256_add_epi32(s[1], b);
+  s[2] = _mm256_add_epi32(s[2], c); s[3] = _mm256_add_epi32(s[3], d);
+  s[4] = _mm256_add_epi32(s[4], e); s[5] = _mm256_add_epi32(s[5], f);
+  s[6] = _mm256_add_epi32(s[6], g); s[7] = _mm256_add_epi32(s[7], h);
+  for (i = 0; i < 8; i++) {
+    _mm256_storeu_si256((__m256i *)(state + 8 * i), s[i]);
+  }
+}
+
+static int avx2_supported(void)
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+static void avx2_hash_multi(uint8_t **out,
+                            const uint8_t **in,
+                            size_t inlen,
+                            uint32_t count)
+{
+  sha256_backend_multi(avx2_compress_lanes, 8, out, NULL, in, inlen, count);
+}
+
+static void avx2_prf_multi(uint8_t **out,
+                           const sha256ctx *state,
+                           const uint8_t **in,
+                           size_t inlen,
+                           uint32_t count)
+{
+  sha256_backend_multi(avx2_compress_lanes, 8, out, state, in, inlen, count);
+}
+
+/* Single inputs gain nothing from lanes, and use the portable code. */
+const xmss_hash_backend xmss_hash_avx2 = {
+  "avx2", 8, avx2_supported, sha256, avx2_hash_multi,
+  sha256_inc_blocks, sha256_inc_finalize, avx2_prf_multi,
+  4, shake128_avx2_multi, shake256_avx2_multi,
+  4, sha512_avx2_multi
+};
+
+/* ====== AVX-512, 16 lanes ==== */
+
+__attribute__((target("avx512f")))
+static void avx512_compress_lanes(uint32_t *state, const uint8_t **in)
+{
+  __m512i s[8], w[16], a, b, c, d, e, f, g, h, t1, t2, s0, s1;
+  __m256i lo[16], hi[16];
+  int i;
+
+  for (i = 0; i < 8; i++) {
+    s[i] = _mm512_loadu_si512((const void *)(state + 16 * i));
+  }
+  avx2_load_transpose(lo, in, 0);
+  avx2_load_transpose(lo + 8, in, 32);
+  avx2_load_transpose(hi, in + 8, 0);
+  avx2_load_transpose(hi + 8, in + 8, 32);
+  for (i = 0; i < 16; i++) {
+    w[i] = _mm512_inserti64x4(_mm512_castsi256_si512(lo[i]), hi[i], 1);
+  }
+
+  a = s[0]; b = s[1]; c = s[2]; d = s[3];
+  e = s[4]; f = s[5]; g = s[6]; h = s[7];
+
+  for (i = 0; i < 64; i++) {
+    if (i >= 16) {
+      s0 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(w[(i + 1) & 15], 7),
+                                     _mm512_ror_epi32(w[(i + 1) & 15], 18),
+                                     _mm512_srli_epi32(w[(i + 1) & 15], 3), 0x96);
+      s1 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(w[(i + 14) & 15], 17),
+                                     _mm512_ror_epi32(w[(i + 14) & 15], 19),
+                                     _mm512_srli_epi32(w[(i + 14) & 15], 10), 0x96);
+      w[i & 15] = _mm512_add_epi32(_mm512_add_epi32(w[i & 15], s0),
+                                   _mm512_add_epi32(w[(i + 9) & 15], s1));
+    }
+    /* 0x96 is x ^ y ^ z, 0xCA is Ch(x, y, z) and 0xE8 is Maj(x, y, z). */
+    t1 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(e, 6), _mm512_ror_epi32(e, 11),
+                                   _mm512_ror_epi32(e, 25), 0x96);
+    t1 = _mm512_add_epi32(_mm512_add_epi32(h, t1),
+                          _mm512_ternarylogic_epi32(e, f, g, 0xCA));
+    t1 = _mm512_add_epi32(t1, _mm512_add_epi32(_mm512_set1_epi32(K256[i]), w[i & 15]));
+    t2 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(a, 2), _mm512_ror_epi32(a, 13),
+                                   _mm512_ror_epi32(a, 22), 0x96);
+    t2 = _mm512_add_epi32(t2, _mm512_ternarylogic_epi32(a, b, c, 0xE8));
+    h = g; g = f; f = e;
+    e = _mm512_add_epi32(d, t1);
+    d = c; c = b; b = a;
+    a = _mm512_add_epi32(t1, t2);
+  }
+
+  s[0] = _mm512_add_epi32(s[0], a); s[1] = _mm512_add_epi32(s[1], b);
+  s[2] = _mm512_add_epi32(s[2], c); s[3] = _mm512_add_epi32(s[3], d);
+  s[4] = _mm512_add_epi32(s[4], e); s[5] = _mm512_add_epi32(s[5], f);
+  s[6] = _mm512_add_epi32(s[6], g); s[7] = _mm512_add_epi32(s[7], h);
+  for (i = 0; i < 8; i++) {
+    _mm512_storeu_si512((void *)(state + 16 * i), s[i]);
+  }
+}
+
+static int avx512_supported(void)
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx512f");
+}
+
+static void avx512_hash_multi(uint8_t **out,
+                              const uint8_t **in,
+                              size_t inlen,
+                              uint32_t count)
+{
+  sha256_backend_multi(avx512_compress_lanes, 16, out, NULL, in, inlen, count);
+}
+
+static void avx512_prf_multi(uint8_t **out,
+                             const sha256ctx *state,
+                             const uint8_t **in,
+                             size_t inlen,
+                             uint32_t count)
+{
+  sha256_backend_multi(avx512_compress_lanes, 16, out, state, in, inlen, count);
+}
+
+const xmss_hash_backend xmss_hash_avx512 = {
+  "avx512", 16, avx512_supported, sha256, avx512_hash_multi,
+  sha256_inc_blocks, sha256_inc_finalize, avx512_prf_multi,
+  8, shake128_avx512_multi, shake256_avx512_multi,
+  8, sha512_avx512_multi
+};
+
+#endif
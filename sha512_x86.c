@@ -0,0 +1,210 @@
+/* Multi-buffer SHA-512 for x86-64, for the parameter sets with n = 64: AVX2
+* (4 lanes) and AVX-512 (8 lanes) for many independent inputs of the same
+* length. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hash_backend.h"
+#include "sha2.h"
+
+#if XMSS_HASH_X86
+
+#include <immintrin.h>
+
+static const uint64_t K512[80] = {
+  0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL,
+  0xe9b5dba58189dbbcULL, 0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+  0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL, 0xd807aa98a3030242ULL,
+  0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+  0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL,
+  0xc19bf174cf692694ULL, 0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+  0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL, 0x2de92c6f592b0275ULL,
+  0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+  0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL,
+  0xbf597fc7beef0ee4ULL, 0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+  0x06ca6351e003826fULL, 0x142929670a0e6e70ULL, 0x27b70a8546d22ffcULL,
+  0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+  0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL,
+  0x92722c851482353bULL, 0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+  0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL, 0xd192e819d6ef5218ULL,
+  0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+  0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL,
+  0x34b0bcb5e19b48a8ULL, 0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+  0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL, 0x748f82ee5defb2fcULL,
+  0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+  0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL,
+  0xc67178f2e372532bULL, 0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+  0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL, 0x06f067aa72176fbaULL,
+  0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+  0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL,
+  0x431d67c49c100d4cULL, 0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+  0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+static uint64_t load_bigendian_64(const uint8_t *x)
+{
+  uint64_t r = 0;
+  int i;
+
+  for (i = 0; i < 8; i++) {
+    r = (r << 8) | x[i];
+  }
+  return r;
+}
+
+/* ====== AVX2, 4 lanes ==== */
+
+#define ROTR256(x, c) _mm256_or_si256(_mm256_srli_epi64(x, c), _mm256_slli_epi64(x, 64 - (c)))
+
+/**
+* Loads 4 big-endian words from each of 4 inputs, and transposes them so that
+* w[i] holds word i of all inputs.
+*/
+__attribute__((target("avx2")))
+static inline void avx2_load_transpose(__m256i w[4], const uint8_t **in, size_t offset)
+{
+  const __m256i bswap = _mm256_set_epi8(8, 9, 10, 11, 12, 13, 14, 15,
+                                        0, 1, 2, 3, 4, 5, 6, 7,
+                                        8, 9, 10, 11, 12, 13, 14, 15,
+                                        0, 1, 2, 3, 4, 5, 6, 7);
+  __m256i r[4], t[4];
+  int j;
+
+  for (j = 0; j < 4; j++) {
+    r[j] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(in[j] + offset)), bswap);
+  }
+  t[0] = _mm256_unpacklo_epi64(r[0], r[1]);
+  t[1] = _mm256_unpackhi_epi64(r[0], r[1]);
+  t[2] = _mm256_unpacklo_epi64(r[2], r[3]);
+  t[3] = _mm256_unpackhi_epi64(r[2], r[3]);
+  w[0] = _mm256_permute2x128_si256(t[0], t[2], 0x20);
+  w[1] = _mm256_permute2x128_si256(t[1], t[3], 0x20);
+  w[2] = _mm256_permute2x128_si256(t[0], t[2], 0x31);
+  w[3] = _mm256_permute2x128_si256(t[1], t[3], 0x31);
+}
+
+__attribute__((target("avx2")))
+static void avx2_compress_lanes(uint64_t *state, const uint8_t **in)
+{
+  __m256i s[8], w[16], a, b, c, d, e, f, g, h, t1, t2, s0, s1;
+  int i;
+
+  for (i = 0; i < 8; i++) {
+    s[i] = _mm256_loadu_si256((const __m256i *)(state + 4 * i));
+  }
+  for (i = 0; i < 4; i++) {
+    avx2_load_transpose(w + 4 * i, in, 32 * i);
+  }
+
+  a = s[0]; b = s[1]; c = s[2]; d = s[3];
+  e = s[4]; f = s[5]; g = s[6]; h = s[7];
+
+  for (i = 0; i < 80; i++) {
+    if (i >= 16) {
+      s0 = _mm256_xor_si256(_mm256_xor_si256(ROTR256(w[(i + 1) & 15], 1),
+                                             ROTR256(w[(i + 1) & 15], 8)),
+                            _mm256_srli_epi64(w[(i + 1) & 15], 7));
+      s1 = _mm256_xor_si256(_mm256_xor_si256(ROTR256(w[(i + 14) & 15], 19),
+                                             ROTR256(w[(i + 14) & 15], 61)),
+                            _mm256_srli_epi64(w[(i + 14) & 15], 6));
+      w[i & 15] = _mm256_add_epi64(_mm256_add_epi64(w[i & 15], s0),
+                                   _mm256_add_epi64(w[(i + 9) & 15], s1));
+    }
+    t1 = _mm256_xor_si256(_mm256_xor_si256(ROTR256(e, 14), ROTR256(e, 18)), ROTR256(e, 41));
+    t1 = _mm256_add_epi64(_mm256_add_epi64(h, t1),
+                          _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g)));
+    t1 = _mm256_add_epi64(t1, _mm256_add_epi64(_mm256_set1_epi64x((long long)K512[i]), w[i & 15]));
+    t2 = _mm256_xor_si256(_mm256_xor_si256(ROTR256(a, 28), ROTR256(a, 34)), ROTR256(a, 39));
+    t2 = _mm256_add_epi64(t2, _mm256_xor_si256(_mm256_and_si256(a, _mm256_xor_si256(b, c)),
+                                               _mm256_and_si256(b, c)));
+    h = g; g = f; f = e;
+    e = _mm256_add_epi64(d, t1);
+    d = c; c = b; b = a;
+    a = _mm256_add_epi64(t1, t2);
+  }
+
+  s[0] = _mm256_add_epi64(s[0], a); s[1] = _mm256_add_epi64(s[1], b);
+  s[2] = _mm256_add_epi64(s[2], c); s[3] = _mm256_add_epi64(s[3], d);
+  s[4] = _mm256_add_epi64(s[4], e); s[5] = _mm256_add_epi64(s[5], f);
+  s[6] = _mm256_add_epi64(s[6], g); s[7] = _mm256_add_epi64(s[7], h);
+  for (i = 0; i < 8; i++) {
+    _mm256_storeu_si256((__m256i *)(state + 4 * i), s[i]);
+  }
+}
+
+void sha512_avx2_multi(uint8_t **out,
+                       const sha512ctx *state,
+                       const uint8_t **in,
+                       size_t inlen,
+                       uint32_t count)
+{
+  sha512_backend_multi(avx2_compress_lanes, 4, out, state, in, inlen, count);
+}
+
+/* ====== AVX-512, 8 lanes ==== */
+
+__attribute__((target("avx512f")))
+static void avx512_compress_lanes(uint64_t *state, const uint8_t **in)
+{
+  __m512i s[8], w[16], a, b, c, d, e, f, g, h, t1, t2, s0, s1;
+  uint64_t words[8];
+  int i, j;
+
+  for (i = 0; i < 8; i++) {
+    s[i] = _mm512_loadu_si512((const void *)(state + 8 * i));
+  }
+  for (i = 0; i < 16; i++) {
+    for (j = 0; j < 8; j++) {
+      words[j] = load_bigendian_64(in[j] + 8 * i);
+    }
+    w[i] = _mm512_loadu_si512((const void *)words);
+  }
+
+  a = s[0]; b = s[1]; c = s[2]; d = s[3];
+  e = s[4]; f = s[5]; g = s[6]; h = s[7];
+
+  for (i = 0; i < 80; i++) {
+    if (i >= 16) {
+      s0 = _mm512_ternarylogic_epi64(_mm512_ror_epi64(w[(i + 1) & 15], 1),
+                                     _mm512_ror_epi64(w[(i + 1) & 15], 8),
+                                     _mm512_srli_epi64(w[(i + 1) & 15], 7), 0x96);
+      s1 = _mm512_ternarylogic_epi64(_mm512_ror_epi64(w[(i + 14) & 15], 19),
+                                     _mm512_ror_epi64(w[(i + 14) & 15], 61),
+                                     _mm512_srli_epi64(w[(i + 14) & 15], 6), 0x96);
+      w[i & 15] = _mm512_add_epi64(_mm512_add_epi64(w[i & 15], s0),
+                                   _mm512_add_epi64(w[(i + 9) & 15], s1));
+    }
+    /* 0x96 is x ^ y ^ z, 0xCA is Ch(x, y, z) and 0xE8 is Maj(x, y, z). */
+    t1 = _mm512_ternarylogic_epi64(_mm512_ror_epi64(e, 14), _mm512_ror_epi64(e, 18),
+                                   _mm512_ror_epi64(e, 41), 0x96);
+    t1 = _mm512_add_epi64(_mm512_add_epi64(h, t1), _mm512_ternarylogic_epi64(e, f, g, 0xCA));
+    t1 = _mm512_add_epi64(t1, _mm512_add_epi64(_mm512_set1_epi64((long long)K512[i]), w[i & 15]));
+    t2 = _mm512_ternarylogic_epi64(_mm512_ror_epi64(a, 28), _mm512_ror_epi64(a, 34),
+                                   _mm512_ror_epi64(a, 39), 0x96);
+    t2 = _mm512_add_epi64(t2, _mm512_ternarylogic_epi64(a, b, c, 0xE8));
+    h = g; g = f; f = e;
+    e = _mm512_add_epi64(d, t1);
+    d = c; c = b; b = a;
+    a = _mm512_add_epi64(t1, t2);
+  }
+
+  s[0] = _mm512_add_epi64(s[0], a); s[1] = _mm512_add_epi64(s[1], b);
+  s[2] = _mm512_add_epi64(s[2], c); s[3] = _mm512_add_epi64(s[3], d);
+  s[4] = _mm512_add_epi64(s[4], e); s[5] = _mm512_add_epi64(s[5], f);
+  s[6] = _mm512_add_epi64(s[6], g); s[7] = _mm512_add_epi64(s[7], h);
+  for (i = 0; i < 8; i++) {
+    _mm512_storeu_si512((void *)(state + 8 * i), s[i]);
+  }
+}
+
+void sha512_avx512_multi(uint8_t **out,
+                         const sha512ctx *state,
+                         const uint8_t **in,
+                         size_t inlen,
+                         uint32_t count)
+{
+  sha512_backend_multi(avx512_compress_lanes, 8, out, state, in, inlen, count);
+}
+
+#endif
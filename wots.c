@@ -9,45 +9,67 @@
 
 /**
  * Helper method for pseudorandom key generation.
- * Expands an n-byte array into a len*n byte array using the `prf` function.
+ * Expands an n-byte array into a len*n byte array using the `prf` function,
+ * for all len outputs at once.
  */
 static void expand_seed(const xmss_params *params,
                         uint8_t *outseeds,
                         const uint8_t *inseed)
 {
     uint32_t i;
-    uint8_t ctr[32];
+    uint8_t ctr[params->wots_len][32];
+    uint8_t *out[params->wots_len];
+    const uint8_t *in[params->wots_len];
 
     for (i = 0; i < params->wots_len; i++) {
-        ull_to_bytes(ctr, 32, i);
-        prf(params, outseeds + i*params->n, ctr, inseed);
+        ull_to_bytes(ctr[i], 32, i);
+        out[i] = outseeds + i*params->n;
+        in[i] = ctr[i];
     }
+    prf_multi(params, out, in, inseed, params->wots_len);
 }
 
 /**
- * Computes the chaining function.
- * out and in have to be n-byte arrays.
+ * Computes the chaining function for all len chains.
+ * out and in have to be len*n-byte arrays.
  *
- * Interprets in as start-th value of the chain.
- * addr has to contain the address of the chain.
+ * Interprets the i-th n bytes of in as start[i]-th value of chain i, and
+ * iterates it steps[i] times. The chains are advanced together, one hash
+ * address at a time, so that every round is a single call to thash_f_multi.
+ * addr has to contain the address of the WOTS key pair.
  */
-static void gen_chain(const xmss_params *params,
-                      uint8_t *out,
-                      const uint8_t *in,
-                      uint32_t start,
-                      uint32_t steps,
-                      const uint8_t *pub_seed,
-                      uint32_t addr[8])
+static void gen_chains(const xmss_params *params,
+                       uint8_t *out,
+                       const uint8_t *in,
+                       const int *start,
+                       const int *steps,
+                       const uint8_t *pub_seed,
+                       uint32_t addr[8])
 {
-    uint32_t i;
+    uint32_t addrs[params->wots_len][8];
+    uint8_t *chains[params->wots_len];
+    uint32_t i, j, count;
 
-    /* Initialize out with the value at position 'start'. */
-    memcpy(out, in, params->n);
+    /* Initialize out with the values at position 'start'. */
+    if (out != in) {
+        memcpy(out, in, params->wots_sig_bytes);
+    }
 
-    /* Iterate 'steps' calls to the hash function. */
-    for (i = start; i < (start+steps) && i < params->wots_w; i++) {
-        set_hash_addr(addr, i);
-        thash_f(params, out, out, pub_seed, addr);
+    for (j = 0; j < params->wots_w; j++) {
+        count = 0;
+        for (i = 0; i < params->wots_len; i++) {
+            if ((uint32_t)start[i] <= j && j < (uint32_t)(start[i] + steps[i])) {
+                memcpy(addrs[count], addr, sizeof(addrs[count]));
+                set_chain_addr(addrs[count], i);
+                set_hash_addr(addrs[count], j);
+                chains[count] = out + i*params->n;
+                count++;
+            }
+        }
+        if (count > 0) {
+            thash_f_multi(params, chains, (const uint8_t **)chains, pub_seed,
+                          addrs, count);
+        }
     }
 }
 
@@ -124,16 +146,20 @@ void wots_pkgen(const xmss_params *params,
                 const uint8_t *pub_seed,
                 uint32_t addr[8])
 {
+    int start[params->wots_len];
+    int steps[params->wots_len];
     uint32_t i;
+    HASH_STATS_ENTER(HASH_STATS_WOTS);
 
     /* The WOTS+ private key is derived from the seed. */
     expand_seed(params, pk, seed);
 
     for (i = 0; i < params->wots_len; i++) {
-        set_chain_addr(addr, i);
-        gen_chain(params, pk + i*params->n, pk + i*params->n,
-                  0, params->wots_w - 1, pub_seed, addr);
+        start[i] = 0;
+        steps[i] = params->wots_w - 1;
     }
+    gen_chains(params, pk, pk, start, steps, pub_seed, addr);
+    HASH_STATS_LEAVE();
 }
 
 int wots_getlengths1(const xmss_params *params, const uint8_t *msg) {
@@ -170,7 +196,9 @@ void wots_sign(const xmss_params *params,
                uint32_t addr[8])
 {
     int lengths[params->wots_len];
+    int start[params->wots_len];
     uint32_t i;
+    HASH_STATS_ENTER(HASH_STATS_WOTS);
 
     chain_lengths(params, lengths, msg);
 
@@ -178,10 +206,10 @@ void wots_sign(const xmss_params *params,
     expand_seed(params, sig, seed);
 
     for (i = 0; i < params->wots_len; i++) {
-        set_chain_addr(addr, i);
-        gen_chain(params, sig + i*params->n, sig + i*params->n,
-                  0, lengths[i], pub_seed, addr);
+        start[i] = 0;
     }
+    gen_chains(params, sig, sig, start, lengths, pub_seed, addr);
+    HASH_STATS_LEAVE();
 }
 
 /**
@@ -197,13 +225,15 @@ void wots_pk_from_sig(const xmss_params *params,
                       uint32_t addr[8])
 {
     int lengths[params->wots_len];
+    int steps[params->wots_len];
     uint32_t i;
+    HASH_STATS_ENTER(HASH_STATS_WOTS);
 
     chain_lengths(params, lengths, msg);
 
     for (i = 0; i < params->wots_len; i++) {
-        set_chain_addr(addr, i);
-        gen_chain(params, pk + i*params->n, sig + i*params->n,
-                  lengths[i], params->wots_w - 1 - lengths[i], pub_seed, addr);
+        steps[i] = params->wots_w - 1 - lengths[i];
     }
+    gen_chains(params, pk, sig, lengths, steps, pub_seed, addr);
+    HASH_STATS_LEAVE();
 }
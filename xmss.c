@@ -1,4 +1,5 @@
 #include <stdint.h>
+#include <string.h>
 
 #include "params.h"
 #include "xmss_core.h"
@@ -65,6 +66,42 @@ int xmss_sign_open(uint8_t *m,
     return xmss_core_sign_open(&params, m, mlen, sm, smlen, pk + XMSS_OID_LEN);
 }
 
+int xmss_sign_detached(uint8_t *sk,
+                       uint8_t *sig,
+                       const uint8_t *m,
+                       uint64_t mlen)
+{
+    xmss_params params;
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= sk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    if (xmss_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmss_core_sign_detached(&params, sk + XMSS_OID_LEN, sig, m, mlen);
+}
+
+int xmss_verify(const uint8_t *sig,
+                const uint8_t *m,
+                uint64_t mlen,
+                const uint8_t *pk)
+{
+    xmss_params params;
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= pk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    if (xmss_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmss_core_verify(&params, sig, m, mlen, pk + XMSS_OID_LEN);
+}
+
 int xmssmt_keypair(uint8_t *pk,
                    uint8_t *sk,
                    const uint32_t oid)
@@ -119,3 +156,409 @@ int xmssmt_sign_open(uint8_t *m,
     }
     return xmssmt_core_sign_open(&params, m, mlen, sm, smlen, pk + XMSS_OID_LEN);
 }
+
+int xmssmt_sign_detached(uint8_t *sk,
+                         uint8_t *sig,
+                         const uint8_t *m,
+                         uint64_t mlen)
+{
+    xmss_params params;
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= sk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    if (xmssmt_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmssmt_core_sign_detached(&params, sk + XMSS_OID_LEN, sig, m, mlen);
+}
+
+int xmssmt_verify(const uint8_t *sig,
+                  const uint8_t *m,
+                  uint64_t mlen,
+                  const uint8_t *pk)
+{
+    xmss_params params;
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= pk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    if (xmssmt_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmssmt_core_verify(&params, sig, m, mlen, pk + XMSS_OID_LEN);
+}
+
+int xmss_split(uint8_t *shard_sk,
+               uint8_t *sk,
+               uint64_t start)
+{
+    xmss_params params;
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= sk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    if (xmss_parse_oid(&params, oid)) {
+        return -1;
+    }
+    memcpy(shard_sk, sk, XMSS_OID_LEN);
+    return xmss_core_split(&params, shard_sk + XMSS_OID_LEN, sk + XMSS_OID_LEN, start);
+}
+
+int xmssmt_split(uint8_t *shard_sk,
+                 uint8_t *sk,
+                 uint64_t start)
+{
+    xmss_params params;
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= sk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    if (xmssmt_parse_oid(&params, oid)) {
+        return -1;
+    }
+    memcpy(shard_sk, sk, XMSS_OID_LEN);
+    return xmss_core_split(&params, shard_sk + XMSS_OID_LEN, sk + XMSS_OID_LEN, start);
+}
+
+int xmss_signer_init(xmss_signer **signer, uint8_t *sk)
+{
+    xmss_params params;
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= sk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    if (xmss_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmss_core_signer_init(&params, signer, sk + XMSS_OID_LEN);
+}
+
+int xmssmt_signer_init(xmss_signer **signer, uint8_t *sk)
+{
+    xmss_params params;
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= sk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    if (xmssmt_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmss_core_signer_init(&params, signer, sk + XMSS_OID_LEN);
+}
+
+int xmss_signer_sign(xmss_signer *signer,
+                     uint8_t *sm,
+                     uint64_t *smlen,
+                     const uint8_t *m,
+                     uint64_t mlen)
+{
+    return xmss_core_signer_sign(signer, sm, smlen, m, mlen);
+}
+
+int xmss_signer_sign_batch(xmss_signer *signer,
+                           uint8_t **sm,
+                           uint64_t *smlen,
+                           const uint8_t **m,
+                           const uint64_t *mlen,
+                           uint32_t count)
+{
+    return xmss_core_signer_sign_batch(signer, sm, smlen, m, mlen, count);
+}
+
+void xmss_signer_checkpoint(xmss_signer *signer)
+{
+    xmss_core_signer_checkpoint(signer);
+}
+
+void xmss_signer_free(xmss_signer *signer)
+{
+    xmss_core_signer_free(signer);
+}
+
+int xmss_async_start(xmss_async_signer **signer, uint8_t *sk)
+{
+    xmss_params params;
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= sk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    if (xmss_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmss_core_async_start(&params, signer, sk + XMSS_OID_LEN);
+}
+
+int xmssmt_async_start(xmss_async_signer **signer, uint8_t *sk)
+{
+    xmss_params params;
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= sk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    if (xmssmt_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmss_core_async_start(&params, signer, sk + XMSS_OID_LEN);
+}
+
+int xmss_async_sign(xmss_async_signer *signer,
+                    uint8_t *sm,
+                    uint64_t *smlen,
+                    const uint8_t *m,
+                    uint64_t mlen)
+{
+    return xmss_core_async_sign(signer, sm, smlen, m, mlen);
+}
+
+void xmss_async_stop(xmss_async_signer *signer)
+{
+    xmss_core_async_stop(signer);
+}
+
+int xmss_concurrent_init(xmss_concurrent_signer **signer, uint8_t *sk)
+{
+    xmss_params params;
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= sk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    if (xmss_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmss_core_concurrent_init(&params, signer, sk + XMSS_OID_LEN);
+}
+
+int xmssmt_concurrent_init(xmss_concurrent_signer **signer, uint8_t *sk)
+{
+    xmss_params params;
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= sk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    if (xmssmt_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmss_core_concurrent_init(&params, signer, sk + XMSS_OID_LEN);
+}
+
+int xmss_concurrent_attach(xmss_concurrent_signer *signer,
+                           xmss_thread_signer **thread)
+{
+    return xmss_core_concurrent_attach(signer, thread);
+}
+
+int xmss_concurrent_sign(xmss_thread_signer *thread,
+                         uint8_t *sm,
+                         uint64_t *smlen,
+                         const uint8_t *m,
+                         uint64_t mlen)
+{
+    return xmss_core_concurrent_sign(thread, sm, smlen, m, mlen);
+}
+
+void xmss_concurrent_detach(xmss_thread_signer *thread)
+{
+    xmss_core_concurrent_detach(thread);
+}
+
+int xmss_concurrent_free(xmss_concurrent_signer *signer)
+{
+    return xmss_core_concurrent_free(signer);
+}
+
+int xmss_sign_init(xmss_sign_ctx **ctx, uint8_t *sk)
+{
+    xmss_params params;
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= sk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    if (xmss_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmss_core_sign_init(&params, ctx, sk + XMSS_OID_LEN);
+}
+
+int xmssmt_sign_init(xmss_sign_ctx **ctx, uint8_t *sk)
+{
+    xmss_params params;
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= sk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    if (xmssmt_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmss_core_sign_init(&params, ctx, sk + XMSS_OID_LEN);
+}
+
+int xmss_sign_update(xmss_sign_ctx *ctx,
+                     const uint8_t *m,
+                     uint64_t mlen)
+{
+    return xmss_core_sign_update(ctx, m, mlen);
+}
+
+int xmss_sign_final(xmss_sign_ctx *ctx, uint8_t *sig)
+{
+    return xmss_core_sign_final(ctx, sig);
+}
+
+int xmss_verify_init(xmss_verify_ctx **ctx,
+                     const uint8_t *sig,
+                     const uint8_t *pk)
+{
+    xmss_params params;
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= pk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    if (xmss_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmss_core_verify_init(&params, ctx, sig, pk + XMSS_OID_LEN);
+}
+
+int xmssmt_verify_init(xmss_verify_ctx **ctx,
+                       const uint8_t *sig,
+                       const uint8_t *pk)
+{
+    xmss_params params;
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= pk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    if (xmssmt_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmss_core_verify_init(&params, ctx, sig, pk + XMSS_OID_LEN);
+}
+
+int xmss_verify_update(xmss_verify_ctx *ctx,
+                       const uint8_t *m,
+                       uint64_t mlen)
+{
+    return xmss_core_verify_update(ctx, m, mlen);
+}
+
+int xmss_verify_final(xmss_verify_ctx *ctx)
+{
+    return xmss_core_verify_final(ctx);
+}
+
+int xmss_verifier_init(xmss_verifier **verifier,
+                       const uint8_t *pk,
+                       uint32_t cache_entries)
+{
+    xmss_params params;
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= pk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    if (xmss_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmss_core_verifier_init(&params, verifier, pk + XMSS_OID_LEN,
+                                   cache_entries);
+}
+
+int xmssmt_verifier_init(xmss_verifier **verifier,
+                         const uint8_t *pk,
+                         uint32_t cache_entries)
+{
+    xmss_params params;
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= pk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    if (xmssmt_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmss_core_verifier_init(&params, verifier, pk + XMSS_OID_LEN,
+                                   cache_entries);
+}
+
+int xmss_verifier_verify(xmss_verifier *verifier,
+                         const uint8_t *sig,
+                         const uint8_t *m,
+                         uint64_t mlen)
+{
+    return xmss_core_verifier_verify(verifier, sig, m, mlen);
+}
+
+int xmss_verifier_open(xmss_verifier *verifier,
+                       uint8_t *m,
+                       uint64_t *mlen,
+                       const uint8_t *sm,
+                       uint64_t smlen)
+{
+    return xmss_core_verifier_open(verifier, m, mlen, sm, smlen);
+}
+
+int xmss_verifier_keep_nodes(xmss_verifier *verifier, uint32_t levels)
+{
+    return xmss_core_verifier_keep_nodes(verifier, levels);
+}
+
+int xmss_wots_pks(uint8_t *wots_pks, const uint8_t *sk)
+{
+    xmss_params params;
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= sk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    if (xmss_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmss_core_wots_pks(&params, wots_pks, sk + XMSS_OID_LEN);
+}
+
+int xmss_verifier_load_wots(xmss_verifier *verifier, const uint8_t *wots_pks)
+{
+    return xmss_core_verifier_load_wots(verifier, wots_pks);
+}
+
+void xmss_verifier_fast_reject(xmss_verifier *verifier, uint32_t enable)
+{
+    xmss_core_verifier_fast_reject(verifier, enable);
+}
+
+void xmss_verifier_free(xmss_verifier *verifier)
+{
+    xmss_core_verifier_free(verifier);
+}
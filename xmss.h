@@ -37,6 +37,27 @@ int xmss_sign_open(uint8_t *m,
                    uint64_t smlen,
                    const uint8_t *pk);
 
+/**
+ * Signs a message using an XMSS secret key, without copying the message.
+ * Returns
+ * 1. the signature alone, of params.sig_bytes bytes, in sig AND
+ * 2. an updated secret key!
+ */
+int xmss_sign_detached(uint8_t *sk,
+                       uint8_t *sig,
+                       const uint8_t *m,
+                       uint64_t mlen);
+
+/**
+ * Verifies a signature over a message that is passed separately, using a
+ * given public key. The message is hashed where it is, so no buffer of the
+ * size of signature and message is needed.
+ */
+int xmss_verify(const uint8_t *sig,
+                const uint8_t *m,
+                uint64_t mlen,
+                const uint8_t *pk);
+
 /*
  * Generates a XMSSMT key pair for a given parameter set.
  * Format sk: [OID || (ceil(h/8) bit) idx || SK_SEED || SK_PRF || PUB_SEED || root]
@@ -70,4 +91,296 @@ int xmssmt_sign_open(uint8_t *m,
                      const uint8_t *sm,
                      uint64_t smlen,
                      const uint8_t *pk);
+
+/**
+ * Signs a message using an XMSSMT secret key, without copying the message.
+ * Returns
+ * 1. the signature alone, of params.sig_bytes bytes, in sig AND
+ * 2. an updated secret key!
+ */
+int xmssmt_sign_detached(uint8_t *sk,
+                         uint8_t *sig,
+                         const uint8_t *m,
+                         uint64_t mlen);
+
+/**
+ * Verifies a signature over a message that is passed separately, using a
+ * given public key. The message is hashed where it is, so no buffer of the
+ * size of signature and message is needed.
+ */
+int xmssmt_verify(const uint8_t *sig,
+                  const uint8_t *m,
+                  uint64_t mlen,
+                  const uint8_t *pk);
+
+/**
+ * Splits the indices from start onwards off an XMSS secret key into a new
+ * secret key (including OID) for another signer. Afterwards, sk can only
+ * sign with the indices below start, and shard_sk only with the others.
+ */
+int xmss_split(uint8_t *shard_sk,
+               uint8_t *sk,
+               uint64_t start);
+
+/**
+ * Splits the indices from start onwards off an XMSSMT secret key. Splitting
+ * at a multiple of the subtree size is cheapest.
+ */
+int xmssmt_split(uint8_t *shard_sk,
+                 uint8_t *sk,
+                 uint64_t start);
+
+typedef struct xmss_signer xmss_signer;
+
+/**
+ * Creates a signer for an XMSS secret key (including OID) that keeps the BDS
+ * state in memory between signatures. The index in sk is updated with every
+ * signature, the remaining state only on checkpoints and when freeing.
+ */
+int xmss_signer_init(xmss_signer **signer, uint8_t *sk);
+
+/**
+ * Creates a signer for an XMSSMT secret key (including OID).
+ */
+int xmssmt_signer_init(xmss_signer **signer, uint8_t *sk);
+
+/**
+ * Signs a message with a signer.
+ * Returns an array containing the signature followed by the message.
+ */
+int xmss_signer_sign(xmss_signer *signer,
+                     uint8_t *sm,
+                     uint64_t *smlen,
+                     const uint8_t *m,
+                     uint64_t mlen);
+
+/**
+ * Signs count messages with consecutive indices of a signer. The BDS updates
+ * run on a second thread, next to message hashing and WOTS signing.
+ * Returns the signed messages in sm[0..count-1]. Returns -1 without signing
+ * anything if too few indices are left or a message is too short to sign.
+ */
+int xmss_signer_sign_batch(xmss_signer *signer,
+                           uint8_t **sm,
+                           uint64_t *smlen,
+                           const uint8_t **m,
+                           const uint64_t *mlen,
+                           uint32_t count);
+
+/**
+ * Writes the complete state of the signer back into its secret key.
+ */
+void xmss_signer_checkpoint(xmss_signer *signer);
+
+/**
+ * Checkpoints the signer and releases it.
+ */
+void xmss_signer_free(xmss_signer *signer);
+
+typedef struct xmss_async_signer xmss_async_signer;
+
+/**
+ * Starts an asynchronous signer for an XMSS secret key (including OID).
+ * A worker thread prepares the auth path of the next index in the background.
+ * The signer owns sk until xmss_async_stop returns.
+ */
+int xmss_async_start(xmss_async_signer **signer, uint8_t *sk);
+
+/**
+ * Starts an asynchronous signer for an XMSSMT secret key (including OID).
+ */
+int xmssmt_async_start(xmss_async_signer **signer, uint8_t *sk);
+
+/**
+ * Signs a message with an asynchronous signer.
+ * Returns an array containing the signature followed by the message.
+ */
+int xmss_async_sign(xmss_async_signer *signer,
+                    uint8_t *sm,
+                    uint64_t *smlen,
+                    const uint8_t *m,
+                    uint64_t mlen);
+
+/**
+ * Stops the signer; afterwards sk holds the updated secret key.
+ */
+void xmss_async_stop(xmss_async_signer *signer);
+
+typedef struct xmss_concurrent_signer xmss_concurrent_signer;
+typedef struct xmss_thread_signer xmss_thread_signer;
+
+/**
+ * Creates a signer for an XMSS secret key (including OID) that several
+ * threads can use at the same time. XMSS has a single tree, so the threads
+ * take turns to claim an index, but hash and sign in parallel.
+ */
+int xmss_concurrent_init(xmss_concurrent_signer **signer, uint8_t *sk);
+
+/**
+ * Creates a concurrent signer for an XMSSMT secret key (including OID).
+ * Threads claim whole bottom trees and sign with them in parallel.
+ */
+int xmssmt_concurrent_init(xmss_concurrent_signer **signer, uint8_t *sk);
+
+/**
+ * Creates the handle through which one thread signs with a concurrent signer.
+ */
+int xmss_concurrent_attach(xmss_concurrent_signer *signer,
+                           xmss_thread_signer **thread);
+
+/**
+ * Signs a message with the handle of the calling thread.
+ * Returns an array containing the signature followed by the message.
+ */
+int xmss_concurrent_sign(xmss_thread_signer *thread,
+                         uint8_t *sm,
+                         uint64_t *smlen,
+                         const uint8_t *m,
+                         uint64_t mlen);
+
+/**
+ * Releases the handle of a thread.
+ */
+void xmss_concurrent_detach(xmss_thread_signer *thread);
+
+/**
+ * Releases the signer after all threads have detached; afterwards sk holds
+ * the updated secret key.
+ */
+int xmss_concurrent_free(xmss_concurrent_signer *signer);
+typedef struct xmss_sign_ctx xmss_sign_ctx;
+
+/**
+ * Starts signing a message that is passed in pieces, using an XMSS secret key
+ * (including OID). The message does not need to be in memory as a whole.
+ * sk must not be used otherwise until xmss_sign_final returns.
+ */
+int xmss_sign_init(xmss_sign_ctx **ctx, uint8_t *sk);
+
+/**
+ * Starts signing a message that is passed in pieces, using an XMSSMT secret
+ * key (including OID).
+ */
+int xmssmt_sign_init(xmss_sign_ctx **ctx, uint8_t *sk);
+
+/**
+ * Absorbs the next piece of the message.
+ */
+int xmss_sign_update(xmss_sign_ctx *ctx,
+                     const uint8_t *m,
+                     uint64_t mlen);
+
+/**
+ * Releases ctx and returns
+ * 1. the signature alone, as for xmss_sign_detached, in sig AND
+ * 2. an updated secret key!
+ */
+int xmss_sign_final(xmss_sign_ctx *ctx, uint8_t *sig);
+
+typedef struct xmss_verify_ctx xmss_verify_ctx;
+
+/**
+ * Starts verifying a signature over a message that is passed in pieces, using
+ * an XMSS public key. sig and pk must stay valid until xmss_verify_final.
+ */
+int xmss_verify_init(xmss_verify_ctx **ctx,
+                     const uint8_t *sig,
+                     const uint8_t *pk);
+
+/**
+ * Starts verifying a signature over a message that is passed in pieces, using
+ * an XMSSMT public key.
+ */
+int xmssmt_verify_init(xmss_verify_ctx **ctx,
+                       const uint8_t *sig,
+                       const uint8_t *pk);
+
+/**
+ * Absorbs the next piece of the message.
+ */
+int xmss_verify_update(xmss_verify_ctx *ctx,
+                       const uint8_t *m,
+                       uint64_t mlen);
+
+/**
+ * Releases ctx, and returns 0 if the signature is valid.
+ */
+int xmss_verify_final(xmss_verify_ctx *ctx);
+
+typedef struct xmss_verifier xmss_verifier;
+
+/**
+ * Keeps an XMSS public key for verifying any number of signatures under it.
+ * With cache_entries > 0 the verifier remembers that many of the keys and
+ * bitmasks of the hash tree nodes it derives from PUB_SEED, preferring those
+ * of the upper nodes, which most signatures need again. Each node takes 3
+ * entries, so 3 * 2^k entries hold the top k levels of a tree; 0 disables the
+ * cache. A verifier must not be
+ * used by several threads at once.
+ */
+int xmss_verifier_init(xmss_verifier **verifier,
+                       const uint8_t *pk,
+                       uint32_t cache_entries);
+
+/**
+ * The same for an XMSSMT public key.
+ */
+int xmssmt_verifier_init(xmss_verifier **verifier,
+                         const uint8_t *pk,
+                         uint32_t cache_entries);
+
+/**
+ * Verifies a signature over a message that is passed separately, as
+ * xmss_verify does. Returns 0 if the signature is valid.
+ */
+int xmss_verifier_verify(xmss_verifier *verifier,
+                         const uint8_t *sig,
+                         const uint8_t *m,
+                         uint64_t mlen);
+
+/**
+ * Verifies a signed message and writes the message to m, as xmss_sign_open
+ * does.
+ */
+int xmss_verifier_open(xmss_verifier *verifier,
+                       uint8_t *m,
+                       uint64_t *mlen,
+                       const uint8_t *sm,
+                       uint64_t smlen);
+
+/**
+ * Lets the verifier remember the nodes of the top levels levels of the (top)
+ * tree along the paths of valid signatures, 2^(levels + 1) - 2 nodes at most.
+ * Signatures then stop hashing towards the root at the first known node, so
+ * a hot key verifies with up to levels fewer tree hashes. levels must be
+ * below the tree height; 0 forgets all nodes. Returns -1 on failure.
+ */
+int xmss_verifier_keep_nodes(xmss_verifier *verifier, uint32_t levels);
+
+/**
+ * Writes the WOTS public keys of all leaves of an XMSS secret key to
+ * wots_pks, 2^h public keys of len * n bytes. These are public and let
+ * verifiers of a hot key skip the L-tree and the tree (see
+ * xmss_verifier_load_wots). Computing them costs as much as key generation.
+ */
+int xmss_wots_pks(uint8_t *wots_pks, const uint8_t *sk);
+
+/**
+ * Loads the WOTS public keys written by xmss_wots_pks into an XMSS verifier.
+ * The verifier checks them against the root of its public key, and keeps
+ * them with all nodes of the tree; afterwards, a signature is checked by
+ * comparing the WOTS public key it yields and its auth path with the table.
+ * Returns -1 if the keys do not match the public key or on failure.
+ */
+int xmss_verifier_load_wots(xmss_verifier *verifier, const uint8_t *wots_pks);
+
+/**
+ * With enable set, the verifier rejects a signature at the first node that
+ * contradicts the nodes or WOTS public keys it knows, before hashing on to the
+ * root. This is not constant-time, which verification of public data does not
+ * need; by default invalid signatures take the time of a full verification.
+ */
+void xmss_verifier_fast_reject(xmss_verifier *verifier, uint32_t enable);
+
+void xmss_verifier_free(xmss_verifier *verifier);
 #endif
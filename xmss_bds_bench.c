@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "params.h"
+#include "hash.h"
+#include "xmss_core.h"
+
+/* Include space for the additional counter. */
+#define XMSS_MLEN (32+8)
+
+#define XMSS_VARIANT "XMSS-SHA2_10_256"
+#define XMSS_SIGNATURES 256
+
+/*
+ * Shows the trade-off made by the BDS parameter k: for every valid k, a key
+ * is generated and XMSS_SIGNATURES signatures are made, reporting the size of
+ * the secret key and the number of hash function calls per signature. Every
+ * signature is verified; the last column counts those that do not verify.
+ *
+ * Usage: xmss_bds_bench [variant] [signatures], e.g.
+ *   xmss_bds_bench XMSSMT-SHA2_20/2_256 1024
+ */
+int main(int argc, char **argv)
+{
+    const char *variant = argc > 1 ? argv[1] : XMSS_VARIANT;
+    uint64_t signatures = argc > 2 ? strtoull(argv[2], NULL, 10) : XMSS_SIGNATURES;
+    xmss_params params;
+    uint32_t oid;
+    uint32_t k;
+    uint64_t i;
+    int mt = strncmp(variant, "XMSSMT", 6) == 0;
+    int ret = 0;
+
+    if (mt ? xmssmt_str_to_oid(&oid, variant) || xmssmt_parse_oid(&params, oid)
+           : xmss_str_to_oid(&oid, variant) || xmss_parse_oid(&params, oid)) {
+        fprintf(stderr, "Unknown parameter set %s\n", variant);
+        return -1;
+    }
+    if (signatures > (1ULL << params.full_height)) {
+        signatures = 1ULL << params.full_height;
+    }
+
+    printf("%s, %llu signatures per k\n", variant, (unsigned long long)signatures);
+    printf("%4s %10s %14s %14s %14s %14s %8s\n",
+           "k", "sk bytes", "keygen hashes", "sign min", "sign avg", "sign max",
+           "failed");
+
+    for (k = 0; k <= params.tree_height; k++) {
+        uint8_t m[XMSS_MLEN];
+        uint8_t *pk, *sk, *sm;
+        uint64_t smlen;
+        uint64_t keygen, calls, min = UINT64_MAX, max = 0, total = 0;
+        uint64_t failures = 0;
+
+        if (xmss_set_bds_k(&params, k)) {
+            continue;
+        }
+        pk = malloc(params.pk_bytes);
+        sk = malloc(params.sk_bytes);
+        sm = malloc(params.sig_bytes + XMSS_MLEN);
+
+        for (i = 0; i < XMSS_MLEN - 8; i++) m[i] = i;
+        for (i = XMSS_MLEN - 8; i < XMSS_MLEN; i++) m[i] = 0;
+
+#if HASH_STATS
+        hash_stats_reset();
+#endif
+        if (mt) {
+            xmssmt_core_keypair(&params, pk, sk);
+        }
+        else {
+            xmss_core_keypair(&params, pk, sk);
+        }
+#if HASH_STATS
+        keygen = hash_stats_count();
+#else
+        keygen = 0;
+#endif
+
+        for (i = 0; i < signatures; i++) {
+#if HASH_STATS
+            hash_stats_reset();
+#endif
+            if (mt) {
+                xmssmt_core_sign(&params, sk, sm, &smlen, m, XMSS_MLEN);
+            }
+            else {
+                xmss_core_sign(&params, sk, sm, &smlen, m, XMSS_MLEN);
+            }
+#if HASH_STATS
+            calls = hash_stats_count();
+#else
+            calls = 0;
+#endif
+            total += calls;
+            if (calls < min) min = calls;
+            if (calls > max) max = calls;
+
+            /* With COUNTER, verification reads the counter that signing
+            chose, so every signature is verified right away. */
+            if (xmssmt_core_verify(&params, sm, sm + params.sig_bytes,
+                                   smlen - params.sig_bytes, pk)) {
+                failures++;
+            }
+        }
+
+        printf("%4u %10llu %14llu %14llu %14llu %14llu %8llu\n", k,
+               (unsigned long long)params.sk_bytes, (unsigned long long)keygen,
+               (unsigned long long)min, (unsigned long long)(total / signatures),
+               (unsigned long long)max, (unsigned long long)failures);
+        if (failures) {
+            ret = -1;
+        }
+
+        free(pk);
+        free(sk);
+        free(sm);
+    }
+
+    return ret;
+}
@@ -0,0 +1,420 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "params.h"
+#include "hash_backend.h"
+#include "xmss_core.h"
+#if HASH_STATS
+#include "hash.h"
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define XMSS_BENCH_TSC 1
+#else
+#define XMSS_BENCH_TSC 0
+#endif
+
+/* Include space for the additional counter. */
+#define XMSS_MLEN (32+8)
+
+#define XMSS_SIGNATURES 256
+#define XMSS_KEYGENS 2
+#define XMSS_MAX_HEIGHT 10
+
+#if ORIG
+#define XMSS_BENCH_MODE "ORIG"
+#else
+#define XMSS_BENCH_MODE "COUNTER"
+#endif
+
+static const char *variants[] = {
+    "XMSS-SHA2_10_256", "XMSS-SHA2_16_256", "XMSS-SHA2_20_256",
+    "XMSS-SHA2_10_512", "XMSS-SHA2_16_512", "XMSS-SHA2_20_512",
+    "XMSS-SHAKE_10_256", "XMSS-SHAKE_16_256", "XMSS-SHAKE_20_256",
+    "XMSS-SHAKE_10_512", "XMSS-SHAKE_16_512", "XMSS-SHAKE_20_512",
+    "XMSSMT-SHA2_20/2_256", "XMSSMT-SHA2_20/4_256", "XMSSMT-SHA2_40/2_256",
+    "XMSSMT-SHA2_40/4_256", "XMSSMT-SHA2_40/8_256", "XMSSMT-SHA2_60/3_256",
+    "XMSSMT-SHA2_60/6_256", "XMSSMT-SHA2_60/12_256",
+    "XMSSMT-SHA2_20/2_512", "XMSSMT-SHA2_20/4_512", "XMSSMT-SHA2_40/2_512",
+    "XMSSMT-SHA2_40/4_512", "XMSSMT-SHA2_40/8_512", "XMSSMT-SHA2_60/3_512",
+    "XMSSMT-SHA2_60/6_512", "XMSSMT-SHA2_60/12_512",
+    "XMSSMT-SHAKE_20/2_256", "XMSSMT-SHAKE_20/4_256", "XMSSMT-SHAKE_40/2_256",
+    "XMSSMT-SHAKE_40/4_256", "XMSSMT-SHAKE_40/8_256", "XMSSMT-SHAKE_60/3_256",
+    "XMSSMT-SHAKE_60/6_256", "XMSSMT-SHAKE_60/12_256",
+    "XMSSMT-SHAKE_20/2_512", "XMSSMT-SHAKE_20/4_512", "XMSSMT-SHAKE_40/2_512",
+    "XMSSMT-SHAKE_40/4_512", "XMSSMT-SHAKE_40/8_512", "XMSSMT-SHAKE_60/3_512",
+    "XMSSMT-SHAKE_60/6_512", "XMSSMT-SHAKE_60/12_512",
+};
+
+/* The cycles and nanoseconds of every run of one operation, and with
+ * HASH_STATS the hash calls of all runs, by phase and kind. */
+typedef struct {
+    uint64_t *cycles;
+    uint64_t *ns;
+    uint64_t count;
+#if HASH_STATS
+    uint64_t calls[HASH_STATS_PHASES][HASH_STATS_TYPES];
+#endif
+} samples;
+
+typedef struct {
+    uint64_t c;
+    struct timespec t;
+} stamp;
+
+static int json;
+static int first_result = 1;
+
+static void stamp_now(stamp *s)
+{
+#if HASH_STATS
+    hash_stats_reset();
+#endif
+    clock_gettime(CLOCK_MONOTONIC, &s->t);
+#if XMSS_BENCH_TSC
+    s->c = __rdtsc();
+#else
+    s->c = 0;
+#endif
+}
+
+static void samples_add(samples *s, const stamp *start)
+{
+    stamp end;
+#if HASH_STATS
+    uint32_t p, t;
+
+    for (p = 0; p < HASH_STATS_PHASES; p++) {
+        for (t = 0; t < HASH_STATS_TYPES; t++) {
+            s->calls[p][t] += hash_stats_get(t, p);
+        }
+    }
+#endif
+
+    stamp_now(&end);
+    s->cycles[s->count] = end.c - start->c;
+    s->ns[s->count] = (uint64_t)(end.t.tv_sec - start->t.tv_sec) * 1000000000ULL
+                      + (uint64_t)end.t.tv_nsec - (uint64_t)start->t.tv_nsec;
+    s->count++;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Sorts v and returns the smallest value that at least p percent of the
+ * values do not exceed. */
+static uint64_t percentile(uint64_t *v, uint64_t count, uint32_t p)
+{
+    uint64_t i = (count * p + 99) / 100;
+
+    qsort(v, count, sizeof(uint64_t), cmp_u64);
+    return v[i > 0 ? i - 1 : 0];
+}
+
+static void samples_clear(samples *s)
+{
+    s->count = 0;
+#if HASH_STATS
+    memset(s->calls, 0, sizeof(s->calls));
+#endif
+}
+
+#if HASH_STATS
+/* Prints the hash calls per run of every phase that made any. */
+static void report_calls(const samples *s)
+{
+    uint32_t p, t;
+    int first = 1;
+
+    if (json) {
+        printf(", \"hash_calls\": {");
+    }
+    for (p = 0; p < HASH_STATS_PHASES; p++) {
+        if (s->calls[p][HASH_STATS_CALLS] == 0) {
+            continue;
+        }
+        if (json) {
+            printf("%s\"%s\": {", first ? "" : ", ", hash_stats_phase_name(p));
+        }
+        else {
+            printf("    %-8s", hash_stats_phase_name(p));
+        }
+        for (t = 0; t < HASH_STATS_TYPES; t++) {
+            printf(json ? "%s\"%s\": %.1f" : "%s%s %.1f",
+                   json ? (t ? ", " : "") : " ", hash_stats_type_name(t),
+                   (double)s->calls[p][t] / s->count);
+        }
+        printf(json ? "}" : "\n");
+        first = 0;
+    }
+    if (json) {
+        printf("}");
+    }
+}
+#endif
+
+static void report(const char *variant, const xmss_params *params,
+                   const char *op, int grind_bits, samples *s)
+{
+    uint64_t c50 = percentile(s->cycles, s->count, 50);
+    uint64_t c99 = percentile(s->cycles, s->count, 99);
+    uint64_t t50 = percentile(s->ns, s->count, 50);
+    uint64_t t99 = percentile(s->ns, s->count, 99);
+    char grind[16] = "-";
+
+    if (grind_bits >= 0) {
+        snprintf(grind, sizeof(grind), "%d", grind_bits);
+    }
+    if (json) {
+        printf("%s\n    {\"variant\": \"%s\", \"backend\": \"%s\", "
+               "\"op\": \"%s\", \"grind_bits\": %s, \"samples\": %llu, "
+               "\"median_cycles\": %llu, \"p99_cycles\": %llu, "
+               "\"median_ns\": %llu, \"p99_ns\": %llu",
+               first_result ? "" : ",", variant, params->backend->name, op,
+               grind_bits >= 0 ? grind : "null",
+               (unsigned long long)s->count,
+               (unsigned long long)c50, (unsigned long long)c99,
+               (unsigned long long)t50, (unsigned long long)t99);
+#if HASH_STATS
+        report_calls(s);
+#endif
+        printf("}");
+    }
+    else {
+        printf("%-24s %-7s %5s %7llu %14llu %14llu %12.3f %12.3f\n",
+               variant, op, grind, (unsigned long long)s->count,
+               (unsigned long long)c50, (unsigned long long)c99,
+               t50 / 1e6, t99 / 1e6);
+#if HASH_STATS
+        report_calls(s);
+#endif
+    }
+    first_result = 0;
+}
+
+static void keypair(const xmss_params *params, int mt, uint8_t *pk, uint8_t *sk)
+{
+    if (mt) {
+        xmssmt_core_keypair(params, pk, sk);
+    }
+    else {
+        xmss_core_keypair(params, pk, sk);
+    }
+}
+
+/*
+ * Measures keygen, sign and verify of one parameter set, signing with every
+ * grinding budget in turn. Returns the number of signatures that did not
+ * verify.
+ */
+static uint64_t bench_variant(const char *variant, uint64_t signatures,
+                              uint64_t keygens, const int *budgets,
+                              uint32_t nbudgets)
+{
+    xmss_params params;
+    uint32_t oid;
+    uint32_t b;
+    uint64_t i, used = 0, failures = 0;
+    uint8_t m[XMSS_MLEN];
+    uint8_t *pk, *sk, *sm;
+    uint64_t smlen;
+    samples s;
+    stamp start;
+    int mt = strncmp(variant, "XMSSMT", 6) == 0;
+
+    if (mt ? xmssmt_str_to_oid(&oid, variant) || xmssmt_parse_oid(&params, oid)
+           : xmss_str_to_oid(&oid, variant) || xmss_parse_oid(&params, oid)) {
+        fprintf(stderr, "Unknown parameter set %s\n", variant);
+        return 1;
+    }
+    if (signatures > (1ULL << params.full_height)) {
+        signatures = 1ULL << params.full_height;
+    }
+
+    pk = malloc(params.pk_bytes);
+    sk = malloc(params.sk_bytes);
+    sm = malloc(params.sig_bytes + XMSS_MLEN);
+    s.cycles = malloc((signatures > keygens ? signatures : keygens) * sizeof(uint64_t));
+    s.ns = malloc((signatures > keygens ? signatures : keygens) * sizeof(uint64_t));
+
+    /* The counter takes the place of the last 8 bytes. */
+    for (i = 0; i < XMSS_MLEN - 8; i++) m[i] = i;
+    for (i = XMSS_MLEN - 8; i < XMSS_MLEN; i++) m[i] = 0;
+
+    samples_clear(&s);
+    for (i = 0; i < keygens; i++) {
+        stamp_now(&start);
+        keypair(&params, mt, pk, sk);
+        samples_add(&s, &start);
+    }
+    report(variant, &params, "keygen", -1, &s);
+
+    for (b = 0; b < nbudgets; b++) {
+        samples v;
+
+        if (budgets[b] >= 0) {
+            xmss_set_grind_bits(&params, budgets[b]);
+        }
+        /* Every budget signs with fresh indices. */
+        if (used + signatures > (1ULL << params.full_height)) {
+            keypair(&params, mt, pk, sk);
+            used = 0;
+        }
+        used += signatures;
+
+        v.cycles = malloc(signatures * sizeof(uint64_t));
+        v.ns = malloc(signatures * sizeof(uint64_t));
+        samples_clear(&v);
+        samples_clear(&s);
+        for (i = 0; i < signatures; i++) {
+            stamp_now(&start);
+            if (mt) {
+                xmssmt_core_sign(&params, sk, sm, &smlen, m, XMSS_MLEN);
+            }
+            else {
+                xmss_core_sign(&params, sk, sm, &smlen, m, XMSS_MLEN);
+            }
+            samples_add(&s, &start);
+
+            /* With COUNTER, verification reads the counter that signing
+            chose, so every signature is verified right away. */
+            stamp_now(&start);
+            if (xmssmt_core_verify(&params, sm, sm + params.sig_bytes,
+                                   smlen - params.sig_bytes, pk)) {
+                failures++;
+            }
+            samples_add(&v, &start);
+        }
+        report(variant, &params, "sign", budgets[b], &s);
+        report(variant, &params, "verify", budgets[b], &v);
+        free(v.cycles);
+        free(v.ns);
+    }
+
+    free(pk);
+    free(sk);
+    free(sm);
+    free(s.cycles);
+    free(s.ns);
+    return failures;
+}
+
+/*
+ * Measures key generation, signing and verification, reporting the median and
+ * 99th percentile of the TSC cycles (reference cycles, via rdtsc) and of the
+ * wall time of every operation. Signing is measured for each grinding budget
+ * of COUNTER; ORIG and PRECOMP are fixed at build time, see the
+ * xmss_bench_orig and xmss_bench_noprecomp targets. The xmss_bench_stats
+ * target also reports the hash calls of every phase per operation, by kind;
+ * its counting makes its timings slightly worse.
+ *
+ * Usage: xmss_bench [-j] [-n signatures] [-k keygens] [-g bits,bits,...]
+ *                   [variant ...], e.g.
+ *   xmss_bench -j -n 1024 -g 0,10,14 XMSS-SHA2_10_256
+ * Without variants, all parameter sets with trees of height at most 10 are
+ * measured. -j writes JSON instead of a table.
+ */
+int main(int argc, char **argv)
+{
+    uint64_t signatures = XMSS_SIGNATURES;
+    uint64_t keygens = XMSS_KEYGENS;
+    int budgets[32] = { XMSS_GRIND_BITS };
+    uint32_t nbudgets = 1;
+    uint64_t failures = 0;
+    int argi;
+    uint32_t i;
+
+    for (argi = 1; argi < argc && argv[argi][0] == '-'; argi++) {
+        if (!strcmp(argv[argi], "-j")) {
+            json = 1;
+        }
+        else if (!strcmp(argv[argi], "-n") && argi + 1 < argc) {
+            signatures = strtoull(argv[++argi], NULL, 10);
+        }
+        else if (!strcmp(argv[argi], "-k") && argi + 1 < argc) {
+            keygens = strtoull(argv[++argi], NULL, 10);
+        }
+        else if (!strcmp(argv[argi], "-g") && argi + 1 < argc) {
+            char *p = argv[++argi];
+
+            for (nbudgets = 0; nbudgets < 32 && *p; nbudgets++) {
+                budgets[nbudgets] = (int)strtoul(p, &p, 10);
+                if (budgets[nbudgets] > 32) {
+                    fprintf(stderr, "Grinding budgets go up to 32 bits\n");
+                    return -1;
+                }
+                if (*p == ',') p++;
+            }
+        }
+        else {
+            fprintf(stderr, "Usage: %s [-j] [-n signatures] [-k keygens] "
+                    "[-g bits,bits,...] [variant ...]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (signatures == 0 || keygens == 0 || nbudgets == 0) {
+        fprintf(stderr, "Nothing to measure\n");
+        return -1;
+    }
+#if ORIG
+    /* Without COUNTER there is nothing to grind. */
+    budgets[0] = -1;
+    nbudgets = 1;
+#endif
+
+    if (json) {
+        printf("{\n  \"bench\": \"xmss_bench\", \"mode\": \"%s\", "
+               "\"precomp\": %d, \"tsc\": %d, \"hash_stats\": %d,\n"
+               "  \"results\": [",
+               XMSS_BENCH_MODE, PRECOMP, XMSS_BENCH_TSC, HASH_STATS);
+    }
+    else {
+        printf("%s, PRECOMP %d, %llu signatures per budget\n",
+               XMSS_BENCH_MODE, PRECOMP, (unsigned long long)signatures);
+        printf("%-24s %-7s %5s %7s %14s %14s %12s %12s\n", "variant", "op",
+               "grind", "samples", "median cycles", "p99 cycles",
+               "median ms", "p99 ms");
+    }
+
+    if (argi < argc) {
+        for (; argi < argc; argi++) {
+            failures += bench_variant(argv[argi], signatures, keygens,
+                                      budgets, nbudgets);
+        }
+    }
+    else {
+        for (i = 0; i < sizeof(variants) / sizeof(variants[0]); i++) {
+            xmss_params params;
+            uint32_t oid;
+            int mt = strncmp(variants[i], "XMSSMT", 6) == 0;
+
+            if (mt ? xmssmt_str_to_oid(&oid, variants[i]) || xmssmt_parse_oid(&params, oid)
+                   : xmss_str_to_oid(&oid, variants[i]) || xmss_parse_oid(&params, oid)) {
+                continue;
+            }
+            if (params.tree_height <= XMSS_MAX_HEIGHT) {
+                failures += bench_variant(variants[i], signatures, keygens,
+                                          budgets, nbudgets);
+            }
+        }
+    }
+
+    if (json) {
+        printf("\n  ],\n  \"verify_failures\": %llu\n}\n",
+               (unsigned long long)failures);
+    }
+    else if (failures) {
+        printf("%llu signatures did not verify\n", (unsigned long long)failures);
+    }
+    return failures ? 1 : 0;
+}
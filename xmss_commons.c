@@ -3,13 +3,14 @@
 #include <stdint.h>
 
 #include "hash.h"
+#include "xmss_trace.h"
 #include "hash_address.h"
 #include "params.h"
 #include "wots.h"
 #include "utils.h"
 #include "xmss_commons.h"
 
-extern uint8_t msg_h_best1[32], msg_h_best2[32];
+extern _Thread_local uint8_t msg_h_best1[XMSS_MAX_N], msg_h_best2[XMSS_MAX_N];
 
 /**
 * Computes a leaf node from a WOTS public key using an L-tree.
@@ -25,6 +26,7 @@ static void l_tree(const xmss_params *params,
   uint32_t parent_nodes;
   uint32_t i;
   uint32_t height = 0;
+  HASH_STATS_ENTER(HASH_STATS_LTREE);
 
   set_tree_height(addr, height);
 
@@ -50,21 +52,121 @@ static void l_tree(const xmss_params *params,
     set_tree_height(addr, height);
   }
   memcpy(leaf, wots_pk, params->n);
+  HASH_STATS_LEAVE();
+}
+
+/* The upper levels of the top tree, learned from valid signatures. Level j,
+for 1 <= j <= levels, holds the 2^j nodes at height tree_height - j, starting
+at slot 2^j - 2. */
+struct xmss_node_cache {
+  uint32_t levels;
+  uint8_t *known;
+  uint8_t *nodes;
+};
+
+/**
+* Returns the known node at the given height and index, or NULL.
+*/
+static const uint8_t *node_cache_get(const xmss_params *params,
+                                     const struct xmss_node_cache *cache,
+                                     uint32_t height,
+                                     unsigned long idx)
+{
+  uint32_t j = params->tree_height - height;
+  unsigned long slot;
+
+  if (height == 0 || height >= params->tree_height || j > cache->levels) {
+    return NULL;
+  }
+  slot = (1UL << j) - 2 + idx;
+  return cache->known[slot] ? cache->nodes + slot * params->n : NULL;
+}
+
+/**
+* Checks node, at the given height and index, against the cache. Returns 1 if
+* the node and the rest of the auth path, from its sibling on, are known and
+* equal, so that the path ends at the root. Returns -1 if the cache
+* contradicts the node or a sibling and params->fast_reject is set, and 0 if
+* the path has to be hashed further.
+*/
+static int node_cache_check(const xmss_params *params,
+                            const struct xmss_node_cache *cache,
+                            uint32_t height,
+                            unsigned long idx,
+                            const uint8_t *node,
+                            const uint8_t *auth_path)
+{
+  const uint8_t *known;
+  const uint8_t *sibling;
+
+  if ((known = node_cache_get(params, cache, height, idx)) == NULL) {
+    return 0;
+  }
+  if (memcmp(known, node, params->n)) {
+    return params->fast_reject ? -1 : 0;
+  }
+  for (; height < params->tree_height; height++) {
+    sibling = node_cache_get(params, cache, height, idx ^ 1);
+    if (sibling == NULL) {
+      return 0;
+    }
+    if (memcmp(sibling, auth_path, params->n)) {
+      return params->fast_reject ? -1 : 0;
+    }
+    idx >>= 1;
+    auth_path += params->n;
+  }
+  return 1;
+}
+
+/**
+* Stores the upper nodes of a valid path from leaf leafidx to the root of the
+* top tree and their siblings, where path holds the node at height i + 1 from
+* i * n on.
+*/
+static void node_cache_learn(const xmss_params *params,
+                             struct xmss_node_cache *cache,
+                             unsigned long leafidx,
+                             const uint8_t *path,
+                             const uint8_t *auth_path)
+{
+  uint32_t height;
+  uint32_t j;
+  unsigned long slot;
+
+  for (j = 1; j <= cache->levels; j++) {
+    height = params->tree_height - j;
+    slot = (1UL << j) - 2 + (leafidx >> height);
+    memcpy(cache->nodes + slot * params->n, path + (height - 1) * params->n,
+           params->n);
+    cache->known[slot] = 1;
+    slot ^= 1;
+    memcpy(cache->nodes + slot * params->n, auth_path + height * params->n,
+           params->n);
+    cache->known[slot] = 1;
+  }
 }
 
 /**
-* Computes a root node given a leaf and an auth path
+* Computes a root node given a leaf and an auth path, and writes the node at
+* height i + 1 to path + i*n. If cache is given, it stops as soon as
+* node_cache_check decides, and returns its result; otherwise it returns 0.
 */
-static void compute_root(const xmss_params *params,
-                         uint8_t *root,
-                         const uint8_t *leaf,
-                         unsigned long leafidx,
-                         const uint8_t *auth_path,
-                         const uint8_t *pub_seed,
-                         uint32_t addr[8])
+static int compute_root(const xmss_params *params,
+                        uint8_t *root,
+                        const uint8_t *leaf,
+                        unsigned long leafidx,
+                        const uint8_t *auth_path,
+                        const uint8_t *pub_seed,
+                        uint32_t addr[8],
+                        const struct xmss_node_cache *cache,
+                        uint8_t *path)
 {
   uint32_t i;
   uint8_t buffer[2 * params->n];
+  uint8_t *node;
+  int ret;
+  HASH_STATS_ENTER(HASH_STATS_AUTH);
 
   /* If leafidx is odd (last bit = 1), current path element is a right child
   and auth_path has to go left. Otherwise it is the other way around. */
@@ -84,14 +186,17 @@ static void compute_root(const xmss_params *params,
     set_tree_index(addr, leafidx);
 
     /* Pick the right or left neighbor, depending on parity of the node. */
-    if (leafidx & 1) {
-      thash_h(params, buffer + params->n, buffer, pub_seed, addr);
-      memcpy(buffer, auth_path, params->n);
-    }
-    else {
-      thash_h(params, buffer, buffer, pub_seed, addr);
-      memcpy(buffer + params->n, auth_path, params->n);
+    node = (leafidx & 1) ? buffer + params->n : buffer;
+    thash_h(params, node, buffer, pub_seed, addr);
+    memcpy(path + i * params->n, node, params->n);
+
+    if (cache != NULL &&
+        (ret = node_cache_check(params, cache, i + 1, leafidx, node,
+                                auth_path)) != 0) {
+      HASH_STATS_LEAVE();
+      return ret;
     }
+    memcpy((leafidx & 1) ? buffer : buffer + params->n, auth_path, params->n);
     auth_path += params->n;
   }
 
@@ -100,9 +205,67 @@ static void compute_root(const xmss_params *params,
   leafidx >>= 1;
   set_tree_index(addr, leafidx);
   thash_h(params, root, buffer, pub_seed, addr);
+  memcpy(path + i * params->n, root, params->n);
+  HASH_STATS_LEAVE();
+  return 0;
 }
 
 
+/* The WOTS public keys of all leaves of an XMSS tree, and all of its nodes.
+The node at height k and index i is at (2^(tree_height - k) - 1 + i) * n. */
+struct xmss_wots_table {
+  uint8_t *wots_pks;
+  uint8_t *nodes;
+};
+
+static uint8_t *wots_table_node(const xmss_params *params,
+                                const struct xmss_wots_table *table,
+                                uint32_t height,
+                                unsigned long idx)
+{
+  unsigned long slot = (1UL << (params->tree_height - height)) - 1 + idx;
+
+  return table->nodes + slot * params->n;
+}
+
+/**
+* Checks that the auth path of a leaf consists of the siblings of its path.
+*/
+static int wots_table_check_auth(const xmss_params *params,
+                                 const struct xmss_wots_table *table,
+                                 unsigned long leafidx,
+                                 const uint8_t *auth_path)
+{
+  uint32_t i;
+
+  for (i = 0; i < params->tree_height; i++) {
+    if (memcmp(auth_path + i * params->n,
+               wots_table_node(params, table, i, (leafidx >> i) ^ 1),
+               params->n)) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+* Checks a leaf against the table: the WOTS public key computed from the
+* signature must be the one of the leaf, and the auth path must consist of the
+* siblings of its path. Then the path ends at the root, as when it is hashed.
+*/
+static int wots_table_check(const xmss_params *params,
+                            const struct xmss_wots_table *table,
+                            unsigned long leafidx,
+                            const uint8_t *wots_pk,
+                            const uint8_t *auth_path)
+{
+  if (memcmp(wots_pk, table->wots_pks + leafidx * params->wots_sig_bytes,
+             params->wots_sig_bytes)) {
+    return -1;
+  }
+  return wots_table_check_auth(params, table, leafidx, auth_path);
+}
+
 /**
 * Computes the leaf at a given address. First generates the WOTS key pair,
 * then computes leaf using l_tree. As this happens position independent, we
@@ -135,7 +298,7 @@ void get_seed(const xmss_params *params,
               const uint8_t *sk_seed,
               uint32_t addr[8])
 {
-  uint8_t bytes[32];
+  HASH_STATS_ENTER(HASH_STATS_WOTS);
 
   /* Make sure that chain addr, hash addr, and key bit are zeroed. */
   set_chain_addr(addr, 0);
@@ -143,8 +306,8 @@ void get_seed(const xmss_params *params,
   set_key_and_mask(addr, 0);
 
   /* Generate seed. */
-  addr_to_bytes(bytes, addr);
-  prf(params, seed, bytes, sk_seed);
+  prf(params, seed, (const uint8_t *)addr, sk_seed);
+  HASH_STATS_LEAVE();
 }
 
 /**
@@ -165,27 +328,46 @@ int xmss_core_sign_open(const xmss_params *params,
   return xmssmt_core_sign_open(params, m, mlen, sm, smlen, pk);
 }
 
-#if ORIG
+#if COUNTER
+extern _Thread_local uint64_t besti;
+#endif
+
 /**
-* Verifies a given message signature pair under a given public key.
+* Verifies a signature over a message that is passed separately. The message
+* is hashed where it is, and never copied.
 * Note that this assumes a pk without an OID, i.e. [root || PUB_SEED]
 */
-int xmssmt_core_sign_open(const xmss_params *params,
-                          uint8_t *m,
-                          uint64_t *mlen,
-                          const uint8_t *sm,
-                          uint64_t smlen,
-                          const uint8_t *pk)
+int xmss_core_verify(const xmss_params *params,
+                     const uint8_t *sig,
+                     const uint8_t *m,
+                     uint64_t mlen,
+                     const uint8_t *pk)
+{
+  /* As for xmss_core_sign_open, XMSS is the special case d=1 of XMSSMT. */
+  return xmssmt_core_verify(params, sig, m, mlen, pk);
+}
+
+/**
+* Verifies a signature over the message that has been absorbed into h.
+*/
+static int verify_hashed(const xmss_params *params,
+                         const uint8_t *sig,
+                         const uint8_t *pk,
+                         hash_message_ctx *h)
 {
   const uint8_t *pub_root = pk;
   const uint8_t *pub_seed = pk + params->n;
   uint8_t wots_pk[params->wots_sig_bytes];
   uint8_t leaf[params->n];
   uint8_t root[params->n];
+  uint8_t path[params->tree_height * params->n];
   uint8_t *mhash = root;
+  int known = 0;
+  const uint8_t *auth_path = NULL;
   uint64_t idx = 0;
+  uint64_t sig_idx;
   uint32_t i;
-  uint32_t idx_leaf;
+  uint32_t idx_leaf = 0;
 
   uint32_t ots_addr[8] = { 0 };
   uint32_t ltree_addr[8] = { 0 };
@@ -195,19 +377,28 @@ int xmssmt_core_sign_open(const xmss_params *params,
   set_type(ltree_addr, XMSS_ADDR_TYPE_LTREE);
   set_type(node_addr, XMSS_ADDR_TYPE_HASHTREE);
 
-  *mlen = smlen - params->sig_bytes;
-
   /* Convert the index bytes from the signature to an integer. */
-  idx = bytes_to_ull(sm, params->index_bytes);
-
-  /* Put the message all the way at the end of the m buffer, so that we can
-  * prepend the required other inputs for the hash function. */
-  memcpy(m + params->sig_bytes, sm + params->sig_bytes, *mlen);
+  idx = bytes_to_ull(sig, params->index_bytes);
+  sig_idx = idx;
 
   /* Compute the message hash. */
-  hash_message(params, mhash, sm + params->index_bytes, pk, idx,
-    m + params->sig_bytes - 4 * params->n, *mlen);
-  sm += params->index_bytes + params->n;
+  XMSS_TRACE_BEGIN(XMSS_TRACE_MESSAGE, sig_idx);
+#if COUNTER
+  /* The counter that signing chose is not part of the signature; it is
+  passed in besti, and takes the place of the last 8 bytes of the message.
+  XMSSMT does not grind, and hashes the message as it is. */
+  if (params->d > 1) {
+    hash_message_final(mhash, h);
+  }
+  else if (hash_message_final_counter(mhash, h, besti)) {
+    XMSS_TRACE_END(XMSS_TRACE_MESSAGE, sig_idx);
+    return -1;
+  }
+#else
+  hash_message_final(mhash, h);
+#endif
+  XMSS_TRACE_END(XMSS_TRACE_MESSAGE, sig_idx);
+  sig += params->index_bytes + params->n;
 
   /* For each subtree.. */
   for (i = 0; i < params->d; i++) {
@@ -222,128 +413,319 @@ int xmssmt_core_sign_open(const xmss_params *params,
     set_tree_addr(ots_addr, idx);
     set_tree_addr(node_addr, idx);
 
+    /* A wrong auth path is caught by the table before any chain is hashed. */
+    if (params->wots_table != NULL && params->fast_reject &&
+        wots_table_check_auth(params, params->wots_table, idx_leaf,
+                              sig + params->wots_sig_bytes)) {
+      return -1;
+    }
+
     /* The WOTS public key is only correct if the signature was correct. */
     set_ots_addr(ots_addr, idx_leaf);
     /* Initially, root = mhash, but on subsequent iterations it is the root
     of the subtree below the currently processed subtree. */
-    wots_pk_from_sig(params, wots_pk, sm, root, pub_seed, ots_addr);
-    sm += params->wots_sig_bytes;
+    XMSS_TRACE_BEGIN(XMSS_TRACE_WOTS, sig_idx);
+    wots_pk_from_sig(params, wots_pk, sig, root, pub_seed, ots_addr);
+    XMSS_TRACE_END(XMSS_TRACE_WOTS, sig_idx);
+    sig += params->wots_sig_bytes;
+
+    /* With a table of the whole tree, the WOTS public key and the auth path
+    are looked up instead of being hashed up to the root. */
+    if (params->wots_table != NULL) {
+      return wots_table_check(params, params->wots_table, idx_leaf, wots_pk,
+                              sig);
+    }
 
     /* Compute the leaf node using the WOTS public key. */
     set_ltree_addr(ltree_addr, idx_leaf);
+    XMSS_TRACE_BEGIN(XMSS_TRACE_LTREE, sig_idx);
     l_tree(params, leaf, wots_pk, pub_seed, ltree_addr);
+    XMSS_TRACE_END(XMSS_TRACE_LTREE, sig_idx);
+
+    /* Compute the root node of this subtree. The upper nodes of the top
+    tree are the same for all signatures, so known ones end the path. */
+    auth_path = sig;
+    XMSS_TRACE_BEGIN(XMSS_TRACE_ROOT, sig_idx);
+    known = compute_root(params, root, leaf, idx_leaf, sig, pub_seed,
+                         node_addr,
+                         i == params->d - 1 ? params->node_cache : NULL,
+                         path);
+    XMSS_TRACE_END(XMSS_TRACE_ROOT, sig_idx);
+    sig += params->tree_height*params->n;
+  }
 
-    /* Compute the root node of this subtree. */
-    compute_root(params, root, leaf, idx_leaf, sm, pub_seed, node_addr);
-    sm += params->tree_height*params->n;
+  if (known != 0) {
+    return known > 0 ? 0 : -1;
   }
 
   /* Check if the root node equals the root node in the public key. */
   if (memcmp(root, pub_root, params->n)) {
-    /* If not, zero the message */
-    memset(m, 0, *mlen);
-    *mlen = 0;
     return -1;
   }
-
-  /* If verification was successful, copy the message from the signature. */
-  memcpy(m, sm, *mlen);
-
+  if (params->node_cache != NULL) {
+    node_cache_learn(params, params->node_cache, idx_leaf, path, auth_path);
+  }
   return 0;
 }
-#endif
-
-#if COUNTER
-extern uint64_t besti;
 
 /**
-* Verifies a given message signature pair under a given public key.
+* Verifies a signature over a message that is passed separately. The message
+* is hashed where it is, and never copied.
 * Note that this assumes a pk without an OID, i.e. [root || PUB_SEED]
 */
-int xmssmt_core_sign_open(const xmss_params *params,
-                          uint8_t *m,
-                          uint64_t *mlen,
-                          const uint8_t *sm,
-                          uint64_t smlen,
+int xmssmt_core_verify(const xmss_params *params,
+                       const uint8_t *sig,
+                       const uint8_t *m,
+                       uint64_t mlen,
+                       const uint8_t *pk)
+{
+  hash_message_ctx h;
+
+  if (hash_message_init(params, &h, sig + params->index_bytes, pk,
+                        bytes_to_ull(sig, params->index_bytes))) {
+    return -1;
+  }
+  hash_message_update(&h, m, mlen);
+
+  return verify_hashed(params, sig, pk, &h);
+}
+
+/* State of a verification over a streamed message; see xmss_core_verify_init. */
+struct xmss_verify_ctx {
+  xmss_params params;
+  const uint8_t *sig;
+  const uint8_t *pk;
+  hash_message_ctx hash;
+};
+
+int xmss_core_verify_init(const xmss_params *params,
+                          xmss_verify_ctx **ctx,
+                          const uint8_t *sig,
                           const uint8_t *pk)
 {
-  const uint8_t *pub_root = pk;
-  const uint8_t *pub_seed = pk + params->n;
-  uint8_t wots_pk[params->wots_sig_bytes];
-  uint8_t leaf[params->n];
-  uint8_t root[params->n];
-  uint8_t *mhash = root;
-  uint64_t idx = 0;
-  uint32_t i;
-  uint32_t idx_leaf;
+  xmss_verify_ctx *c = malloc(sizeof(xmss_verify_ctx));
 
-  uint32_t ots_addr[8] = { 0 };
-  uint32_t ltree_addr[8] = { 0 };
-  uint32_t node_addr[8] = { 0 };
+  if (c == NULL) {
+    return -1;
+  }
+  c->params = *params;
+  c->sig = sig;
+  c->pk = pk;
+  if (hash_message_init(params, &c->hash, sig + params->index_bytes, pk,
+                        bytes_to_ull(sig, params->index_bytes))) {
+    free(c);
+    return -1;
+  }
 
-  set_type(ots_addr, XMSS_ADDR_TYPE_OTS);
-  set_type(ltree_addr, XMSS_ADDR_TYPE_LTREE);
-  set_type(node_addr, XMSS_ADDR_TYPE_HASHTREE);
+  *ctx = c;
+  return 0;
+}
 
-  *mlen = smlen - params->sig_bytes;
+int xmss_core_verify_update(xmss_verify_ctx *ctx,
+                            const uint8_t *m,
+                            uint64_t mlen)
+{
+  hash_message_update(&ctx->hash, m, mlen);
+  return 0;
+}
 
-  /* Convert the index bytes from the signature to an integer. */
-  idx = bytes_to_ull(sm, params->index_bytes);
+int xmss_core_verify_final(xmss_verify_ctx *ctx)
+{
+  int ret = verify_hashed(&ctx->params, ctx->sig, ctx->pk, &ctx->hash);
 
-  /* Put the message all the way at the end of the m buffer, so that we can
-  * prepend the required other inputs for the hash function. */
-  memcpy(m + params->sig_bytes, sm + params->sig_bytes, *mlen);
+  free(ctx);
+  return ret;
+}
 
-  /* Compute the message hash. */
-#define XMSS_HASH_PADDING_HASH 2
-  ull_to_bytes(m + params->sig_bytes - 4 * params->n, params->n, XMSS_HASH_PADDING_HASH);
-  memcpy(m + params->sig_bytes - 4 * params->n + params->n, sm + params->index_bytes, params->n);
-  memcpy(m + params->sig_bytes - 4 * params->n + 2 * params->n, pk, params->n);
-  ull_to_bytes(m + params->sig_bytes - 4 * params->n + 3 * params->n, params->n, idx);
+/* A public key kept for repeated verifications; see xmss_core_verifier_init. */
+struct xmss_verifier {
+  xmss_params params;
+  uint8_t pk[2*XMSS_MAX_N];
+};
 
-  *(uint64_t*)(m + params->sig_bytes + 32) = (uint64_t)besti; // include best chain!
-  SHA256(m + params->sig_bytes - 4 * params->n, *mlen + 4 * params->n, mhash);
+int xmss_core_verifier_init(const xmss_params *params,
+                            xmss_verifier **verifier,
+                            const uint8_t *pk,
+                            uint32_t cache_entries)
+{
+  xmss_verifier *v = malloc(sizeof(xmss_verifier));
 
-  /* Now mhash should be the same as msg_h_best2 if the signature generation 
-   * was done in a previous call. */
-  //printf("Besti = %d\n", besti);
-  //for (int i = 0; i < 256 / 8; i++) {
-  //  printf("%X %X\n", mhash[i], msg_h_best2[i]);
-  //}
+  if (v == NULL) {
+    return -1;
+  }
+  v->params = *params;
+  memcpy(v->pk, pk, 2*params->n);
+  v->params.prf_cache = NULL;
+  v->params.node_cache = NULL;
+  v->params.wots_table = NULL;
+  v->params.fast_reject = 0;
+  if (cache_entries > 0) {
+    v->params.prf_cache = prf_cache_new(params, pk + params->n, cache_entries);
+    if (v->params.prf_cache == NULL) {
+      free(v);
+      return -1;
+    }
+  }
 
-  sm += params->index_bytes + params->n;
+  *verifier = v;
+  return 0;
+}
 
-  /* For each subtree.. */
-  for (i = 0; i < params->d; i++) {
-    idx_leaf = (idx & ((1 << params->tree_height) - 1));
-    idx = idx >> params->tree_height;
+int xmss_core_verifier_verify(xmss_verifier *verifier,
+                              const uint8_t *sig,
+                              const uint8_t *m,
+                              uint64_t mlen)
+{
+  return xmssmt_core_verify(&verifier->params, sig, m, mlen, verifier->pk);
+}
 
-    set_layer_addr(ots_addr, i);
-    set_layer_addr(ltree_addr, i);
-    set_layer_addr(node_addr, i);
+int xmss_core_verifier_open(xmss_verifier *verifier,
+                            uint8_t *m,
+                            uint64_t *mlen,
+                            const uint8_t *sm,
+                            uint64_t smlen)
+{
+  return xmssmt_core_sign_open(&verifier->params, m, mlen, sm, smlen,
+                               verifier->pk);
+}
 
-    set_tree_addr(ltree_addr, idx);
-    set_tree_addr(ots_addr, idx);
-    set_tree_addr(node_addr, idx);
+static void node_cache_free(struct xmss_node_cache *cache)
+{
+  if (cache != NULL) {
+    free(cache->known);
+    free(cache->nodes);
+    free(cache);
+  }
+}
 
-    /* The WOTS public key is only correct if the signature was correct. */
-    set_ots_addr(ots_addr, idx_leaf);
-    /* Initially, root = mhash, but on subsequent iterations it is the root
-    of the subtree below the currently processed subtree. */
-    wots_pk_from_sig(params, wots_pk, sm, root, pub_seed, ots_addr);
-    sm += params->wots_sig_bytes;
+int xmss_core_verifier_keep_nodes(xmss_verifier *verifier, uint32_t levels)
+{
+  const xmss_params *params = &verifier->params;
+  struct xmss_node_cache *cache = NULL;
+  unsigned long slots = (1UL << (levels + 1)) - 2;
 
-    /* Compute the leaf node using the WOTS public key. */
-    set_ltree_addr(ltree_addr, idx_leaf);
-    l_tree(params, leaf, wots_pk, pub_seed, ltree_addr);
+  if (levels >= params->tree_height) {
+    return -1;
+  }
+  if (levels > 0) {
+    cache = malloc(sizeof(struct xmss_node_cache));
+    if (cache == NULL) {
+      return -1;
+    }
+    cache->levels = levels;
+    cache->known = calloc(slots, 1);
+    cache->nodes = malloc(slots * params->n);
+    if (cache->known == NULL || cache->nodes == NULL) {
+      node_cache_free(cache);
+      return -1;
+    }
+  }
+
+  node_cache_free(verifier->params.node_cache);
+  verifier->params.node_cache = cache;
+  return 0;
+}
 
-    /* Compute the root node of this subtree. */
-    compute_root(params, root, leaf, idx_leaf, sm, pub_seed, node_addr);
-    sm += params->tree_height*params->n;
+static void wots_table_free(struct xmss_wots_table *table)
+{
+  if (table != NULL) {
+    free(table->wots_pks);
+    free(table->nodes);
+    free(table);
   }
+}
 
-  /* Check if the root node equals the root node in the public key. */
-  if (memcmp(root, pub_root, params->n)) {
+int xmss_core_verifier_load_wots(xmss_verifier *verifier,
+                                 const uint8_t *wots_pks)
+{
+  const xmss_params *params = &verifier->params;
+  const uint8_t *pub_seed = verifier->pk + params->n;
+  struct xmss_wots_table *table;
+  uint8_t wots_pk[params->wots_sig_bytes];
+  uint32_t ltree_addr[8] = { 0 };
+  uint32_t node_addr[8] = { 0 };
+  unsigned long leaves = 1UL << params->tree_height;
+  unsigned long i;
+  uint32_t height;
+
+  if (params->d != 1) {
+    return -1;
+  }
+  table = malloc(sizeof(struct xmss_wots_table));
+  if (table == NULL) {
+    return -1;
+  }
+  table->wots_pks = malloc(leaves * params->wots_sig_bytes);
+  table->nodes = malloc((2 * leaves - 1) * params->n);
+  if (table->wots_pks == NULL || table->nodes == NULL) {
+    wots_table_free(table);
+    return -1;
+  }
+  memcpy(table->wots_pks, wots_pks, leaves * params->wots_sig_bytes);
+
+  /* Rebuild the tree from the public keys; it has to end at the root of pk,
+  so that a table can never make a verifier accept what it would reject. */
+  set_type(ltree_addr, XMSS_ADDR_TYPE_LTREE);
+  set_type(node_addr, XMSS_ADDR_TYPE_HASHTREE);
+  for (i = 0; i < leaves; i++) {
+    memcpy(wots_pk, wots_pks + i * params->wots_sig_bytes,
+           params->wots_sig_bytes);
+    set_ltree_addr(ltree_addr, i);
+    l_tree(params, wots_table_node(params, table, 0, i), wots_pk, pub_seed,
+           ltree_addr);
+  }
+  for (height = 0; height < params->tree_height; height++) {
+    set_tree_height(node_addr, height);
+    for (i = 0; i < (leaves >> (height + 1)); i++) {
+      set_tree_index(node_addr, i);
+      thash_h(params, wots_table_node(params, table, height + 1, i),
+              wots_table_node(params, table, height, 2 * i), pub_seed,
+              node_addr);
+    }
+  }
+  if (memcmp(table->nodes, verifier->pk, params->n)) {
+    wots_table_free(table);
+    return -1;
+  }
+
+  wots_table_free(verifier->params.wots_table);
+  verifier->params.wots_table = table;
+  return 0;
+}
+
+void xmss_core_verifier_fast_reject(xmss_verifier *verifier, uint32_t enable)
+{
+  verifier->params.fast_reject = enable != 0;
+}
+
+void xmss_core_verifier_free(xmss_verifier *verifier)
+{
+  if (verifier != NULL) {
+    wots_table_free(verifier->params.wots_table);
+    node_cache_free(verifier->params.node_cache);
+    prf_cache_free(verifier->params.prf_cache);
+    free(verifier);
+  }
+}
+
+/**
+* Verifies a given message signature pair under a given public key.
+* Note that this assumes a pk without an OID, i.e. [root || PUB_SEED]
+*/
+int xmssmt_core_sign_open(const xmss_params *params,
+                          uint8_t *m,
+                          uint64_t *mlen,
+                          const uint8_t *sm,
+                          uint64_t smlen,
+                          const uint8_t *pk)
+{
+  if (smlen < params->sig_bytes) {
+    *mlen = 0;
+    return -1;
+  }
+  *mlen = smlen - params->sig_bytes;
+
+  if (xmssmt_core_verify(params, sm, sm + params->sig_bytes, *mlen, pk)) {
     /* If not, zero the message */
     memset(m, 0, *mlen);
     *mlen = 0;
@@ -351,8 +733,7 @@ int xmssmt_core_sign_open(const xmss_params *params,
   }
 
   /* If verification was successful, copy the message from the signature. */
-  memcpy(m, sm, *mlen);
+  memcpy(m, sm + params->sig_bytes, *mlen);
 
   return 0;
 }
-#endif
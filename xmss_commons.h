@@ -48,4 +48,108 @@ int xmssmt_core_sign_open(const xmss_params *params,
                           const uint8_t *sm,
                           uint64_t smlen,
                           const uint8_t *pk);
+
+/**
+ * Verifies a signature over a message that is passed separately.
+ * Note that this assumes a pk without an OID, i.e. [root || PUB_SEED]
+ */
+int xmss_core_verify(const xmss_params *params,
+                     const uint8_t *sig,
+                     const uint8_t *m,
+                     uint64_t mlen,
+                     const uint8_t *pk);
+
+/**
+ * Verifies a signature over a message that is passed separately.
+ * Note that this assumes a pk without an OID, i.e. [root || PUB_SEED]
+ */
+int xmssmt_core_verify(const xmss_params *params,
+                       const uint8_t *sig,
+                       const uint8_t *m,
+                       uint64_t mlen,
+                       const uint8_t *pk);
+
+typedef struct xmss_verify_ctx xmss_verify_ctx;
+
+/**
+ * Starts verifying a signature over a message that is passed in pieces.
+ * Note that this assumes a pk without an OID, i.e. [root || PUB_SEED]
+ */
+int xmss_core_verify_init(const xmss_params *params,
+                          xmss_verify_ctx **ctx,
+                          const uint8_t *sig,
+                          const uint8_t *pk);
+
+/**
+ * Absorbs the next piece of the message.
+ */
+int xmss_core_verify_update(xmss_verify_ctx *ctx,
+                            const uint8_t *m,
+                            uint64_t mlen);
+
+/**
+ * Finishes the verification and releases ctx.
+ */
+int xmss_core_verify_final(xmss_verify_ctx *ctx);
+
+typedef struct xmss_verifier xmss_verifier;
+
+/**
+ * Keeps the public key pk for verifying any number of signatures under it,
+ * with a cache of up to cache_entries PRF outputs for the keys and bitmasks of
+ * the tree hashes (none if cache_entries is 0). Returns -1 if the cache cannot
+ * be allocated.
+ * Note that this assumes a pk without an OID, i.e. [root || PUB_SEED]
+ */
+int xmss_core_verifier_init(const xmss_params *params,
+                            xmss_verifier **verifier,
+                            const uint8_t *pk,
+                            uint32_t cache_entries);
+
+/**
+ * Verifies a signature over a message that is passed separately.
+ */
+int xmss_core_verifier_verify(xmss_verifier *verifier,
+                              const uint8_t *sig,
+                              const uint8_t *m,
+                              uint64_t mlen);
+
+/**
+ * Verifies a signed message and writes the message to m.
+ */
+int xmss_core_verifier_open(xmss_verifier *verifier,
+                            uint8_t *m,
+                            uint64_t *mlen,
+                            const uint8_t *sm,
+                            uint64_t smlen);
+
+/**
+ * Lets the verifier remember the nodes of the top levels levels of the top
+ * tree that valid signatures authenticate. Later signatures stop hashing
+ * towards the root at the first node it knows, and are valid only if they
+ * reach it. levels must be below the tree height; 0 forgets all nodes.
+ * Returns -1 on failure.
+ */
+int xmss_core_verifier_keep_nodes(xmss_verifier *verifier, uint32_t levels);
+
+/**
+ * Gives the verifier the WOTS public keys of all leaves of an XMSS tree, as
+ * written by xmss_core_wots_pks. The verifier rebuilds the tree from them and
+ * rejects them (returning -1) unless it ends at its root. Afterwards each
+ * signature is checked by comparing its WOTS public key and auth path against
+ * the table, without L-tree or tree hashes. Only for d = 1.
+ */
+int xmss_core_verifier_load_wots(xmss_verifier *verifier,
+                                 const uint8_t *wots_pks);
+
+/**
+ * With enable set, the verifier rejects a signature as soon as a node or an
+ * auth path node it knows (see xmss_core_verifier_keep_nodes and
+ * xmss_core_verifier_load_wots) contradicts it, instead of doing the work of a
+ * valid signature first. Verification handles public data only, so this
+ * trades no secrets for the time saved on invalid signatures.
+ */
+void xmss_core_verifier_fast_reject(xmss_verifier *verifier, uint32_t enable);
+
+void xmss_core_verifier_free(xmss_verifier *verifier);
 #endif
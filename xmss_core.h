@@ -43,6 +43,28 @@ int xmss_core_sign_open(const xmss_params *params,
                         uint64_t smlen,
                         const uint8_t *pk);
 
+/**
+ * Signs a message without copying it. Writes a signature of params->sig_bytes
+ * bytes to sig and updates the secret key. With COUNTER, the last 8 bytes of
+ * the message are the slot for the counter, so it needs at least 8 bytes.
+ */
+int xmss_core_sign_detached(const xmss_params *params,
+                            uint8_t *sk,
+                            uint8_t *sig,
+                            const uint8_t *m,
+                            uint64_t mlen);
+
+/**
+ * Verifies a signature of params->sig_bytes bytes over a message that is
+ * passed separately, and hashed where it is.
+ * Note that this assumes a pk without an OID, i.e. [root || PUB_SEED]
+ */
+int xmss_core_verify(const xmss_params *params,
+                     const uint8_t *sig,
+                     const uint8_t *m,
+                     uint64_t mlen,
+                     const uint8_t *pk);
+
 /*
  * Generates a XMSSMT key pair for a given parameter set.
  * Format sk: [(ceil(h/8) bit) index || SK_SEED || SK_PRF || PUB_SEED || root]
@@ -74,4 +96,289 @@ int xmssmt_core_sign_open(const xmss_params *params,
                           uint64_t smlen,
                           const uint8_t *pk);
 
+/**
+ * Signs a message without copying it. Writes a signature of params->sig_bytes
+ * bytes to sig and updates the secret key. With COUNTER, the last 8 bytes of
+ * the message are the slot for the counter, so it needs at least 8 bytes.
+ */
+int xmssmt_core_sign_detached(const xmss_params *params,
+                              uint8_t *sk,
+                              uint8_t *sig,
+                              const uint8_t *m,
+                              uint64_t mlen);
+
+/**
+ * Verifies a signature of params->sig_bytes bytes over a message that is
+ * passed separately, and hashed where it is.
+ * Note that this assumes a pk without an OID, i.e. [root || PUB_SEED]
+ */
+int xmssmt_core_verify(const xmss_params *params,
+                       const uint8_t *sig,
+                       const uint8_t *m,
+                       uint64_t mlen,
+                       const uint8_t *pk);
+
+typedef struct xmss_sign_ctx xmss_sign_ctx;
+
+/**
+ * Starts signing a message that is passed in pieces, for an XMSS or XMSSMT
+ * secret key. The index of the signature is fixed here; sk must not be used
+ * otherwise until xmss_core_sign_final returns.
+ */
+int xmss_core_sign_init(const xmss_params *params,
+                        xmss_sign_ctx **ctx,
+                        uint8_t *sk);
+
+/**
+ * Absorbs the next piece of the message. The pieces can have any length.
+ */
+int xmss_core_sign_update(xmss_sign_ctx *ctx,
+                          const uint8_t *m,
+                          uint64_t mlen);
+
+/**
+ * Writes the signature of params->sig_bytes bytes to sig, updates the secret
+ * key and releases ctx. The last 8 bytes of the message are held back until
+ * here, so that with COUNTER the grinding happens only at the final block.
+ */
+int xmss_core_sign_final(xmss_sign_ctx *ctx, uint8_t *sig);
+
+typedef struct xmss_verify_ctx xmss_verify_ctx;
+
+/**
+ * Starts verifying a signature over a message that is passed in pieces.
+ * sig and pk must stay valid until xmss_core_verify_final returns.
+ * Note that this assumes a pk without an OID, i.e. [root || PUB_SEED]
+ */
+int xmss_core_verify_init(const xmss_params *params,
+                          xmss_verify_ctx **ctx,
+                          const uint8_t *sig,
+                          const uint8_t *pk);
+
+/**
+ * Absorbs the next piece of the message.
+ */
+int xmss_core_verify_update(xmss_verify_ctx *ctx,
+                            const uint8_t *m,
+                            uint64_t mlen);
+
+/**
+ * Finishes the verification and releases ctx. Returns 0 if the signature is
+ * valid.
+ */
+int xmss_core_verify_final(xmss_verify_ctx *ctx);
+
+typedef struct xmss_verifier xmss_verifier;
+
+/**
+ * Keeps the public key pk for verifying any number of signatures under it,
+ * with a cache of up to cache_entries PRF outputs for the keys and bitmasks of
+ * the tree hashes (none if cache_entries is 0). Returns -1 if the cache cannot
+ * be allocated.
+ * Note that this assumes a pk without an OID, i.e. [root || PUB_SEED]
+ */
+int xmss_core_verifier_init(const xmss_params *params,
+                            xmss_verifier **verifier,
+                            const uint8_t *pk,
+                            uint32_t cache_entries);
+
+/**
+ * Verifies a signature over a message that is passed separately.
+ */
+int xmss_core_verifier_verify(xmss_verifier *verifier,
+                              const uint8_t *sig,
+                              const uint8_t *m,
+                              uint64_t mlen);
+
+/**
+ * Verifies a signed message and writes the message to m.
+ */
+int xmss_core_verifier_open(xmss_verifier *verifier,
+                            uint8_t *m,
+                            uint64_t *mlen,
+                            const uint8_t *sm,
+                            uint64_t smlen);
+
+/**
+ * Lets the verifier remember the nodes of the top levels levels of the top
+ * tree that valid signatures authenticate. Later signatures stop hashing
+ * towards the root at the first node it knows, and are valid only if they
+ * reach it. levels must be below the tree height; 0 forgets all nodes.
+ * Returns -1 on failure.
+ */
+int xmss_core_verifier_keep_nodes(xmss_verifier *verifier, uint32_t levels);
+
+/**
+ * Gives the verifier the WOTS public keys of all leaves of an XMSS tree, as
+ * written by xmss_core_wots_pks. The verifier rebuilds the tree from them and
+ * rejects them (returning -1) unless it ends at its root. Afterwards each
+ * signature is checked by comparing its WOTS public key and auth path against
+ * the table, without L-tree or tree hashes. Only for d = 1.
+ */
+int xmss_core_verifier_load_wots(xmss_verifier *verifier,
+                                 const uint8_t *wots_pks);
+
+/**
+ * With enable set, the verifier rejects a signature as soon as a node or an
+ * auth path node it knows (see xmss_core_verifier_keep_nodes and
+ * xmss_core_verifier_load_wots) contradicts it, instead of doing the work of a
+ * valid signature first. Verification handles public data only, so this
+ * trades no secrets for the time saved on invalid signatures.
+ */
+void xmss_core_verifier_fast_reject(xmss_verifier *verifier, uint32_t enable);
+
+void xmss_core_verifier_free(xmss_verifier *verifier);
+
+/**
+ * Writes the WOTS public keys of all 2^tree_height leaves of an XMSS key to
+ * wots_pks, params->wots_sig_bytes bytes each, for verifiers to load. They are
+ * public, but this costs as much as generating the key. Only for d = 1.
+ */
+int xmss_core_wots_pks(const xmss_params *params,
+                       uint8_t *wots_pks,
+                       const uint8_t *sk);
+
+/**
+ * Returns the index limit of sk: 2^h for a new key, or where a shard ends.
+ */
+uint64_t xmss_core_index_limit(const xmss_params *params, const uint8_t *sk);
+
+/**
+ * Splits the indices from start up to the index limit of sk off into a new
+ * secret key shard_sk, with its own BDS states, and lowers the index limit of
+ * sk to start. Both keys sign with the same public key, but never with the
+ * same index. sk must not be in use by a signer while it is split.
+ */
+int xmss_core_split(const xmss_params *params,
+                    uint8_t *shard_sk,
+                    uint8_t *sk,
+                    uint64_t start);
+
+typedef struct xmss_signer xmss_signer;
+
+/**
+ * Creates a signer for an XMSS or XMSSMT secret key. The signer keeps the BDS
+ * states in memory, so that signing does not deserialize and serialize the
+ * whole secret key every time. The index in sk is updated with every
+ * signature; the rest of sk is only updated by xmss_core_signer_checkpoint
+ * and xmss_core_signer_free. Until then, sk must not be used otherwise.
+ */
+int xmss_core_signer_init(const xmss_params *params,
+                          xmss_signer **signer,
+                          uint8_t *sk);
+
+/**
+ * Signs a message with a signer. Returns an array containing the signature
+ * followed by the message, like xmss[mt]_core_sign.
+ */
+int xmss_core_signer_sign(xmss_signer *signer,
+                          uint8_t *sm,
+                          uint64_t *smlen,
+                          const uint8_t *m,
+                          uint64_t mlen);
+
+/**
+ * Signs count messages m[j] of length mlen[j] with consecutive indices, and
+ * writes the signed messages to sm[j] and their lengths to smlen[j]. The
+ * whole range is reserved in sk first; returns -1 if fewer indices are left
+ * or a message cannot be signed (with COUNTER, XMSS messages need at least 8
+ * bytes), in which case nothing is signed.
+ */
+int xmss_core_signer_sign_batch(xmss_signer *signer,
+                                uint8_t **sm,
+                                uint64_t *smlen,
+                                const uint8_t **m,
+                                const uint64_t *mlen,
+                                uint32_t count);
+
+/**
+ * Moves a signer forward to index idx without producing signatures; the
+ * indices in between are never used. Returns -1 if idx lies behind the
+ * current index or beyond the index limit of the key.
+ */
+int xmss_core_signer_skip(xmss_signer *signer, uint64_t idx);
+
+/**
+ * Writes the complete state of the signer back into its secret key.
+ */
+void xmss_core_signer_checkpoint(xmss_signer *signer);
+
+/**
+ * Checkpoints the signer and releases it.
+ */
+void xmss_core_signer_free(xmss_signer *signer);
+
+typedef struct xmss_async_signer xmss_async_signer;
+
+/**
+ * Starts an asynchronous signer for an XMSS or XMSSMT secret key. A worker
+ * thread advances the BDS state for the next index in the background, so that
+ * signing only has to hash the message and compute the WOTS signature.
+ * The signer owns sk until xmss_core_async_stop returns; sk must not be
+ * accessed or used with the synchronous functions in the meantime.
+ */
+int xmss_core_async_start(const xmss_params *params,
+                          xmss_async_signer **signer,
+                          uint8_t *sk);
+
+/**
+ * Signs a message with an asynchronous signer. Returns an array containing
+ * the signature followed by the message, like xmss[mt]_core_sign.
+ */
+int xmss_core_async_sign(xmss_async_signer *signer,
+                         uint8_t *sm,
+                         uint64_t *smlen,
+                         const uint8_t *m,
+                         uint64_t mlen);
+
+/**
+ * Finishes the outstanding state update and stops the signer.
+ * Afterwards, sk is an ordinary, up-to-date secret key again.
+ */
+void xmss_core_async_stop(xmss_async_signer *signer);
+
+
+typedef struct xmss_concurrent_signer xmss_concurrent_signer;
+typedef struct xmss_thread_signer xmss_thread_signer;
+
+/**
+ * Creates a signer for an XMSS or XMSSMT secret key that several threads can
+ * use at the same time, each through its own handle. For XMSSMT, threads claim
+ * whole bottom trees with an atomic counter and sign with them independently;
+ * the index in sk is raised to the end of every claimed tree right away. For
+ * XMSS, threads only take turns to claim an index and advance the BDS state.
+ * The signer owns sk until xmss_core_concurrent_free returns.
+ */
+int xmss_core_concurrent_init(const xmss_params *params,
+                              xmss_concurrent_signer **signer,
+                              uint8_t *sk);
+
+/**
+ * Creates the handle through which one thread signs with a concurrent signer.
+ */
+int xmss_core_concurrent_attach(xmss_concurrent_signer *signer,
+                                xmss_thread_signer **thread);
+
+/**
+ * Signs a message with the handle of the calling thread. Returns an array
+ * containing the signature followed by the message, or -1 if the key is
+ * exhausted.
+ */
+int xmss_core_concurrent_sign(xmss_thread_signer *thread,
+                              uint8_t *sm,
+                              uint64_t *smlen,
+                              const uint8_t *m,
+                              uint64_t mlen);
+
+/**
+ * Releases the handle of a thread. Unused indices of its tree are given up.
+ */
+void xmss_core_concurrent_detach(xmss_thread_signer *thread);
+
+/**
+ * Releases the signer after all threads have detached. Afterwards, sk is an
+ * ordinary secret key again that continues after the last claimed index.
+ */
+int xmss_core_concurrent_free(xmss_concurrent_signer *signer);
+
 #endif
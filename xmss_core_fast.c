@@ -1,8 +1,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #include "hash.h"
+#include "xmss_trace.h"
 #include "hash_address.h"
 #include "params.h"
 #include "randombytes.h"
@@ -15,13 +18,18 @@
 #include <stdio.h>
 #endif
 
+/* The treehash instances of a BDS state, stored as a structure of arrays that
+are indexed by instance. The nodes, h, stackusage and completed point directly
+into sk, where the nodes form one contiguous block. next_idx and the
+scheduling key of every instance (low) are kept in native form next to it. */
 typedef struct {
-  uint8_t h;
-  unsigned long next_idx;
-  uint8_t stackusage;
-  uint8_t completed;
   uint8_t *node;
-} treehash_inst;
+  uint8_t *h;
+  uint8_t *stackusage;
+  uint8_t *completed;
+  uint32_t *next_idx;
+  uint8_t *low;
+} treehash_insts;
 
 typedef struct {
   uint8_t *stack;
@@ -29,13 +37,101 @@ typedef struct {
   uint8_t *stacklevels;
   uint8_t *auth;
   uint8_t *keep;
-  treehash_inst *treehash;
+  treehash_insts treehash;
   uint8_t *retain;
   uint32_t next_leaf;
 } bds_state;
 
-uint64_t besti = 0;
-uint8_t msg_h_best1[32], msg_h_best2[32];
+/* The counter that grinding chose for the last signature of the thread;
+threads that sign concurrently each grind on their own. */
+_Thread_local uint64_t besti = 0;
+_Thread_local uint8_t msg_h_best1[XMSS_MAX_N], msg_h_best2[XMSS_MAX_N];
+
+/**
+* The state slot table is stored at the very end of sk. It holds one byte per
+* layer below the top layer, which is set when the current and the NEXT state
+* of that layer have traded places in sk.
+*/
+static uint8_t *state_slots(const xmss_params *params, uint8_t *sk)
+{
+  return sk + xmss_xmssmt_core_sk_bytes(params) - (params->d - 1);
+}
+
+/**
+* The index limit is stored right before the slot table. Signing refuses
+* indices at or above it, which confines a shard to its own range.
+*/
+static uint8_t *index_limit(const xmss_params *params, uint8_t *sk)
+{
+  return state_slots(params, sk) - params->index_bytes;
+}
+
+/**
+* Returns the index of the state that is stored in slot j of sk.
+*/
+static uint32_t slot_state(const xmss_params *params,
+                           const uint8_t *slots,
+                           uint32_t j)
+{
+  if (j < params->d - 1 && slots[j]) {
+    return params->d + j;
+  }
+  if (j >= params->d && slots[j - params->d]) {
+    return j - params->d;
+  }
+  return j;
+}
+
+static int treehash_minheight_on_stack(const xmss_params *params,
+                                       const bds_state *state,
+                                       uint32_t inst)
+{
+  uint32_t r = params->tree_height, i;
+
+  for (i = 0; i < state->treehash.stackusage[inst]; i++) {
+    if (state->stacklevels[state->stackoffset - i - 1] < r) {
+      r = state->stacklevels[state->stackoffset - i - 1];
+    }
+  }
+  return r;
+}
+
+/**
+* Refreshes the scheduling key of treehash instance inst, i.e. the lowest
+* height at which it still needs work; completed instances get tree_height.
+*/
+static void treehash_set_low(const xmss_params *params,
+                             bds_state *state,
+                             uint32_t inst)
+{
+  if (state->treehash.completed[inst]) {
+    state->treehash.low[inst] = params->tree_height;
+  }
+  else if (state->treehash.stackusage[inst] == 0) {
+    state->treehash.low[inst] = inst;
+  }
+  else {
+    state->treehash.low[inst] = treehash_minheight_on_stack(params, state, inst);
+  }
+}
+
+/**
+* Points the treehash instances of count states to their native-form arrays,
+* which hold tree_height - bds_k entries per state.
+*/
+static void treehash_attach(const xmss_params *params,
+                            bds_state *states,
+                            uint32_t count,
+                            uint32_t *next_idx,
+                            uint8_t *low)
+{
+  uint32_t i;
+
+  for (i = 0; i < count; i++) {
+    states[i].treehash.next_idx = next_idx + i * (params->tree_height - params->bds_k);
+    states[i].treehash.low = low + i * (params->tree_height - params->bds_k);
+  }
+}
 
 /* These serialization functions provide a transition between the current
 way of storing the state in an exposed struct, and storing it as part of the
@@ -46,41 +142,39 @@ static void xmssmt_serialize_state(const xmss_params *params,
                                    uint8_t *sk,
                                    bds_state *states)
 {
+  const uint8_t *slots = state_slots(params, sk);
+  bds_state *state;
   uint32_t i, j;
 
   /* Skip past the 'regular' sk */
   sk += params->index_bytes + 4 * params->n;
 
   for (i = 0; i < 2 * params->d - 1; i++) {
+    state = &states[slot_state(params, slots, i)];
+
     sk += (params->tree_height + 1) * params->n; /* stack */
 
-    ull_to_bytes(sk, 4, states[i].stackoffset);
+    ull_to_bytes(sk, 4, state->stackoffset);
     sk += 4;
 
     sk += params->tree_height + 1; /* stacklevels */
     sk += params->tree_height * params->n; /* auth */
     sk += (params->tree_height >> 1) * params->n; /* keep */
 
-    for (j = 0; j < params->tree_height - params->bds_k; j++) {
-      ull_to_bytes(sk, 1, states[i].treehash[j].h);
-      sk += 1;
+    sk += (params->tree_height - params->bds_k) * params->n; /* nodes */
 
-      ull_to_bytes(sk, 4, states[i].treehash[j].next_idx);
+    for (j = 0; j < params->tree_height - params->bds_k; j++) {
+      ull_to_bytes(sk, 4, state->treehash.next_idx[j]);
       sk += 4;
-
-      ull_to_bytes(sk, 1, states[i].treehash[j].stackusage);
-      sk += 1;
-
-      ull_to_bytes(sk, 1, states[i].treehash[j].completed);
-      sk += 1;
-
-      sk += params->n; /* node */
     }
 
+    /* h, stackusage and completed */
+    sk += 3 * (params->tree_height - params->bds_k);
+
     /* retain */
     sk += ((1 << params->bds_k) - params->bds_k - 1) * params->n;
 
-    ull_to_bytes(sk, 4, states[i].next_leaf);
+    ull_to_bytes(sk, 4, state->next_leaf);
     sk += 4;
   }
 }
@@ -90,6 +184,8 @@ static void xmssmt_deserialize_state(const xmss_params *params,
                                      uint8_t **wots_sigs,
                                      uint8_t *sk)
 {
+  const uint8_t *slots = state_slots(params, sk);
+  bds_state *state;
   uint32_t i, j;
 
   /* Skip past the 'regular' sk */
@@ -99,42 +195,48 @@ static void xmssmt_deserialize_state(const xmss_params *params,
   // TODO They should be reconsidered / motivated more explicitly
 
   for (i = 0; i < 2 * params->d - 1; i++) {
-    states[i].stack = sk;
+    state = &states[slot_state(params, slots, i)];
+
+    state->stack = sk;
     sk += (params->tree_height + 1) * params->n;
 
-    states[i].stackoffset = bytes_to_ull(sk, 4);
+    state->stackoffset = bytes_to_ull(sk, 4);
     sk += 4;
 
-    states[i].stacklevels = sk;
+    state->stacklevels = sk;
     sk += params->tree_height + 1;
 
-    states[i].auth = sk;
+    state->auth = sk;
     sk += params->tree_height * params->n;
 
-    states[i].keep = sk;
+    state->keep = sk;
     sk += (params->tree_height >> 1) * params->n;
 
-    for (j = 0; j < params->tree_height - params->bds_k; j++) {
-      states[i].treehash[j].h = bytes_to_ull(sk, 1);
-      sk += 1;
+    state->treehash.node = sk;
+    sk += (params->tree_height - params->bds_k) * params->n;
 
-      states[i].treehash[j].next_idx = bytes_to_ull(sk, 4);
+    for (j = 0; j < params->tree_height - params->bds_k; j++) {
+      state->treehash.next_idx[j] = bytes_to_ull(sk, 4);
       sk += 4;
+    }
+
+    state->treehash.h = sk;
+    sk += params->tree_height - params->bds_k;
 
-      states[i].treehash[j].stackusage = bytes_to_ull(sk, 1);
-      sk += 1;
+    state->treehash.stackusage = sk;
+    sk += params->tree_height - params->bds_k;
 
-      states[i].treehash[j].completed = bytes_to_ull(sk, 1);
-      sk += 1;
+    state->treehash.completed = sk;
+    sk += params->tree_height - params->bds_k;
 
-      states[i].treehash[j].node = sk;
-      sk += params->n;
+    for (j = 0; j < params->tree_height - params->bds_k; j++) {
+      treehash_set_low(params, state, j);
     }
 
-    states[i].retain = sk;
+    state->retain = sk;
     sk += ((1 << params->bds_k) - params->bds_k - 1) * params->n;
 
-    states[i].next_leaf = bytes_to_ull(sk, 4);
+    state->next_leaf = bytes_to_ull(sk, 4);
     sk += 4;
   }
 
@@ -157,64 +259,21 @@ static void xmss_deserialize_state(const xmss_params *params,
   xmssmt_deserialize_state(params, state, NULL, sk);
 }
 
-static void memswap(void *a, void *b, void *t, uint64_t len)
-{
-  memcpy(t, a, len);
-  memcpy(a, b, len);
-  memcpy(b, t, len);
-}
-
 /**
-* Swaps the content of two bds_state objects, swapping actual memory rather
-* than pointers.
-* As we're mapping memory chunks in the secret key to bds state objects,
-* it is now necessary to make swaps 'real swaps'. This could be done in the
-* serialization function as well, but that causes more overhead
+* Makes the NEXT state of a layer the current one and vice versa. Only the
+* state objects are exchanged, which still point to their own chunks of sk;
+* the slot table in sk records which chunk now holds which state.
 */
-// TODO this should not be necessary if we keep better track of the states
-static void deep_state_swap(const xmss_params *params,
-                            bds_state *a,
-                            bds_state *b)
-{
-  // TODO this is extremely ugly and should be refactored
-  // TODO right now, this ensures that both 'stack' and 'retain' fit
-  uint8_t t[
-    ((params->tree_height + 1) > ((1 << params->bds_k) - params->bds_k - 1)
-      ? (params->tree_height + 1)
-      : ((1 << params->bds_k) - params->bds_k - 1))
-      * params->n];
-  uint32_t i;
-
-  memswap(a->stack, b->stack, t, (params->tree_height + 1) * params->n);
-  memswap(&a->stackoffset, &b->stackoffset, t, sizeof(a->stackoffset));
-  memswap(a->stacklevels, b->stacklevels, t, params->tree_height + 1);
-  memswap(a->auth, b->auth, t, params->tree_height * params->n);
-  memswap(a->keep, b->keep, t, (params->tree_height >> 1) * params->n);
-
-  for (i = 0; i < params->tree_height - params->bds_k; i++) {
-    memswap(&a->treehash[i].h, &b->treehash[i].h, t, sizeof(a->treehash[i].h));
-    memswap(&a->treehash[i].next_idx, &b->treehash[i].next_idx, t, sizeof(a->treehash[i].next_idx));
-    memswap(&a->treehash[i].stackusage, &b->treehash[i].stackusage, t, sizeof(a->treehash[i].stackusage));
-    memswap(&a->treehash[i].completed, &b->treehash[i].completed, t, sizeof(a->treehash[i].completed));
-    memswap(a->treehash[i].node, b->treehash[i].node, t, params->n);
-  }
-
-  memswap(a->retain, b->retain, t, ((1 << params->bds_k) - params->bds_k - 1) * params->n);
-  memswap(&a->next_leaf, &b->next_leaf, t, sizeof(a->next_leaf));
-}
-
-static int treehash_minheight_on_stack(const xmss_params *params,
-                                       bds_state *state,
-                                       const treehash_inst *treehash)
+static void state_swap(const xmss_params *params,
+                       bds_state *states,
+                       uint8_t *slots,
+                       uint32_t layer)
 {
-  uint32_t r = params->tree_height, i;
+  bds_state t = states[layer];
 
-  for (i = 0; i < treehash->stackusage; i++) {
-    if (state->stacklevels[state->stackoffset - i - 1] < r) {
-      r = state->stacklevels[state->stackoffset - i - 1];
-    }
-  }
-  return r;
+  states[layer] = states[params->d + layer];
+  states[params->d + layer] = t;
+  slots[layer] ^= 1;
 }
 
 /**
@@ -250,13 +309,15 @@ static void treehash_init(const xmss_params *params,
   uint32_t stacklevels[height + 1];
   uint32_t stackoffset = 0;
   uint32_t nodeh;
+  HASH_STATS_ENTER(HASH_STATS_BDS);
 
   lastnode = idx + (1 << height);
 
   for (i = 0; i < params->tree_height - params->bds_k; i++) {
-    state->treehash[i].h = i;
-    state->treehash[i].completed = 1;
-    state->treehash[i].stackusage = 0;
+    state->treehash.h[i] = i;
+    state->treehash.completed[i] = 1;
+    state->treehash.stackusage[i] = 0;
+    state->treehash.low[i] = params->tree_height;
   }
 
   i = 0;
@@ -267,7 +328,7 @@ static void treehash_init(const xmss_params *params,
     stacklevels[stackoffset] = 0;
     stackoffset++;
     if (params->tree_height - params->bds_k > 0 && i == 3) {
-      memcpy(state->treehash[0].node, stack + stackoffset * params->n, params->n);
+      memcpy(state->treehash.node, stack + stackoffset * params->n, params->n);
     }
     while (stackoffset>1 && stacklevels[stackoffset - 1] == stacklevels[stackoffset - 2]) {
       nodeh = stacklevels[stackoffset - 1];
@@ -276,7 +337,7 @@ static void treehash_init(const xmss_params *params,
       }
       else {
         if (nodeh < params->tree_height - params->bds_k && i >> nodeh == 3) {
-          memcpy(state->treehash[nodeh].node, stack + (stackoffset - 1)*params->n, params->n);
+          memcpy(state->treehash.node + nodeh * params->n, stack + (stackoffset - 1)*params->n, params->n);
         }
         else if (nodeh >= params->tree_height - params->bds_k) {
           memcpy(state->retain + ((1 << (params->tree_height - 1 - nodeh)) + nodeh - params->tree_height + (((i >> nodeh) - 3) >> 1)) * params->n, stack + (stackoffset - 1)*params->n, params->n);
@@ -294,11 +355,12 @@ static void treehash_init(const xmss_params *params,
   for (i = 0; i < params->n; i++) {
     node[i] = stack[i];
   }
+  HASH_STATS_LEAVE();
 }
 
 static void treehash_update(const xmss_params *params,
-                            treehash_inst *treehash,
                             bds_state *state,
+                            uint32_t inst,
                             const uint8_t *sk_seed,
                             const uint8_t *pub_seed,
                             const uint32_t addr[8])
@@ -306,6 +368,7 @@ static void treehash_update(const xmss_params *params,
   uint32_t ots_addr[8] = { 0 };
   uint32_t ltree_addr[8] = { 0 };
   uint32_t node_addr[8] = { 0 };
+  treehash_insts *treehash = &state->treehash;
   // only copy layer and tree address parts
   copy_subtree_addr(ots_addr, addr);
   // type = ots
@@ -315,32 +378,32 @@ static void treehash_update(const xmss_params *params,
   copy_subtree_addr(node_addr, addr);
   set_type(node_addr, 2);
 
-  set_ltree_addr(ltree_addr, treehash->next_idx);
-  set_ots_addr(ots_addr, treehash->next_idx);
+  set_ltree_addr(ltree_addr, treehash->next_idx[inst]);
+  set_ots_addr(ots_addr, treehash->next_idx[inst]);
 
   uint8_t nodebuffer[2 * params->n];
   uint32_t nodeheight = 0;
   gen_leaf_wots(params, nodebuffer, sk_seed, pub_seed, ltree_addr, ots_addr);
-  while (treehash->stackusage > 0 && state->stacklevels[state->stackoffset - 1] == nodeheight) {
+  while (treehash->stackusage[inst] > 0 && state->stacklevels[state->stackoffset - 1] == nodeheight) {
     memcpy(nodebuffer + params->n, nodebuffer, params->n);
     memcpy(nodebuffer, state->stack + (state->stackoffset - 1)*params->n, params->n);
     set_tree_height(node_addr, nodeheight);
-    set_tree_index(node_addr, (treehash->next_idx >> (nodeheight + 1)));
+    set_tree_index(node_addr, (treehash->next_idx[inst] >> (nodeheight + 1)));
     thash_h(params, nodebuffer, nodebuffer, pub_seed, node_addr);
     nodeheight++;
-    treehash->stackusage--;
+    treehash->stackusage[inst]--;
     state->stackoffset--;
   }
-  if (nodeheight == treehash->h) { // this also implies stackusage == 0
-    memcpy(treehash->node, nodebuffer, params->n);
-    treehash->completed = 1;
+  if (nodeheight == treehash->h[inst]) { // this also implies stackusage == 0
+    memcpy(treehash->node + inst * params->n, nodebuffer, params->n);
+    treehash->completed[inst] = 1;
   }
   else {
     memcpy(state->stack + state->stackoffset*params->n, nodebuffer, params->n);
-    treehash->stackusage++;
+    treehash->stackusage[inst]++;
     state->stacklevels[state->stackoffset] = nodeheight;
     state->stackoffset++;
-    treehash->next_idx++;
+    treehash->next_idx[inst]++;
   }
 }
 
@@ -352,36 +415,35 @@ static char bds_treehash_update(const xmss_params *params,
                                 bds_state *state,
                                 uint32_t updates,
                                 const uint8_t *sk_seed,
-                                uint8_t *pub_seed,
+                                const uint8_t *pub_seed,
                                 const uint32_t addr[8])
 {
+  const uint8_t *low = state->treehash.low;
   uint32_t i, j;
-  uint32_t level, l_min, low;
+  uint32_t level, l_min;
   uint32_t used = 0;
 
   for (j = 0; j < updates; j++) {
     l_min = params->tree_height;
     level = params->tree_height - params->bds_k;
     for (i = 0; i < params->tree_height - params->bds_k; i++) {
-      if (state->treehash[i].completed) {
-        low = params->tree_height;
-      }
-      else if (state->treehash[i].stackusage == 0) {
-        low = i;
-      }
-      else {
-        low = treehash_minheight_on_stack(params, state, &(state->treehash[i]));
-      }
-      if (low < l_min) {
+      if (low[i] < l_min) {
         level = i;
-        l_min = low;
+        l_min = low[i];
       }
     }
     if (level == params->tree_height - params->bds_k) {
       break;
     }
-    treehash_update(params, &(state->treehash[level]), state, sk_seed, pub_seed, addr);
+    treehash_update(params, state, level, sk_seed, pub_seed, addr);
     used++;
+
+    /* Only the keys of instances with nodes on the stack can have changed. */
+    for (i = 0; i < params->tree_height - params->bds_k; i++) {
+      if (i == level || state->treehash.stackusage[i]) {
+        treehash_set_low(params, state, i);
+      }
+    }
   }
   return updates - used;
 }
@@ -423,7 +485,7 @@ static char bds_state_update(const xmss_params *params,
   state->stacklevels[state->stackoffset] = 0;
   state->stackoffset++;
   if (params->tree_height - params->bds_k > 0 && idx == 3) {
-    memcpy(state->treehash[0].node, state->stack + state->stackoffset*params->n, params->n);
+    memcpy(state->treehash.node, state->stack + state->stackoffset*params->n, params->n);
   }
   while (state->stackoffset>1 && state->stacklevels[state->stackoffset - 1] == state->stacklevels[state->stackoffset - 2]) {
     nodeh = state->stacklevels[state->stackoffset - 1];
@@ -432,7 +494,7 @@ static char bds_state_update(const xmss_params *params,
     }
     else {
       if (nodeh < params->tree_height - params->bds_k && idx >> nodeh == 3) {
-        memcpy(state->treehash[nodeh].node, state->stack + (state->stackoffset - 1)*params->n, params->n);
+        memcpy(state->treehash.node + nodeh * params->n, state->stack + (state->stackoffset - 1)*params->n, params->n);
       }
       else if (nodeh >= params->tree_height - params->bds_k) {
         memcpy(state->retain + ((1 << (params->tree_height - 1 - nodeh)) + nodeh - params->tree_height + (((idx >> nodeh) - 3) >> 1)) * params->n, state->stack + (state->stackoffset - 1)*params->n, params->n);
@@ -506,7 +568,7 @@ static void bds_round(const xmss_params *params,
     thash_h(params, state->auth + tau * params->n, buf, pub_seed, node_addr);
     for (i = 0; i < tau; i++) {
       if (i < params->tree_height - params->bds_k) {
-        memcpy(state->auth + i * params->n, state->treehash[i].node, params->n);
+        memcpy(state->auth + i * params->n, state->treehash.node + i * params->n, params->n);
       }
       else {
         offset = (1 << (params->tree_height - 1 - i)) + i - params->tree_height;
@@ -518,10 +580,11 @@ static void bds_round(const xmss_params *params,
     for (i = 0; i < ((tau < params->tree_height - params->bds_k) ? tau : (params->tree_height - params->bds_k)); i++) {
       startidx = leaf_idx + 1 + 3 * (1 << i);
       if (startidx < 1U << params->tree_height) {
-        state->treehash[i].h = i;
-        state->treehash[i].next_idx = startidx;
-        state->treehash[i].completed = 0;
-        state->treehash[i].stackusage = 0;
+        state->treehash.h[i] = i;
+        state->treehash.next_idx[i] = startidx;
+        state->treehash.completed[i] = 0;
+        state->treehash.stackusage[i] = 0;
+        state->treehash.low[i] = i;
       }
     }
   }
@@ -547,7 +610,9 @@ uint64_t xmss_xmssmt_core_sk_bytes(const xmss_params *params)
       + ((1 << params->bds_k) - params->bds_k - 1) * params->n
       + 4
       )
-    + (params->d - 1) * params->wots_sig_bytes;
+    + (params->d - 1) * params->wots_sig_bytes
+    + params->index_bytes
+    + (params->d - 1);
 }
 
 /*
@@ -561,13 +626,18 @@ int xmss_core_keypair(const xmss_params *params,
 {
   uint32_t addr[8] = { 0 };
 
-  // TODO refactor BDS state not to need separate treehash instances
   bds_state state;
-  treehash_inst treehash[params->tree_height - params->bds_k];
-  state.treehash = treehash;
+  uint32_t next_idx[params->tree_height - params->bds_k];
+  uint8_t low[params->tree_height - params->bds_k];
+  treehash_attach(params, &state, 1, next_idx, low);
 
+  /* Start from a zeroed sk, so that the state is well-formed when loaded. */
+  memset(sk, 0, params->sk_bytes);
   xmss_deserialize_state(params, &state, sk);
 
+  /* The key may use all of its indices. */
+  ull_to_bytes(index_limit(params, sk), params->index_bytes, 1ULL << params->full_height);
+
   state.stackoffset = 0;
   state.next_leaf = 0;
 
@@ -595,54 +665,105 @@ int xmss_core_keypair(const xmss_params *params,
   return 0;
 }
 
+int xmss_core_wots_pks(const xmss_params *params,
+                       uint8_t *wots_pks,
+                       const uint8_t *sk)
+{
+  const uint8_t *sk_seed = sk + params->index_bytes;
+  const uint8_t *pub_seed = sk + params->index_bytes + 3 * params->n;
+  uint8_t ots_seed[params->n];
+  uint32_t ots_addr[8] = { 0 };
+  uint32_t i;
+
+  if (params->d != 1) {
+    return -1;
+  }
+  set_type(ots_addr, XMSS_ADDR_TYPE_OTS);
+
+  for (i = 0; i < (1U << params->tree_height); i++) {
+    set_ots_addr(ots_addr, i);
+    get_seed(params, ots_seed, sk_seed, ots_addr);
+    wots_pkgen(params, wots_pks + i * params->wots_sig_bytes, ots_seed,
+               pub_seed, ots_addr);
+  }
+  return 0;
+}
+
 /**
-* Signs a message.
-* Returns
-* 1. an array containing the signature followed by the message AND
-* 2. an updated secret key!
-*
+* Prepares the auth path of the index following idx by running a BDS round
+* and the treehash updates that come with it.
 */
+static void xmss_advance(const xmss_params *params,
+                         bds_state *state,
+                         unsigned long idx,
+                         const uint8_t *sk)
+{
+  const uint8_t *sk_seed = sk + params->index_bytes;
+  const uint8_t *pub_seed = sk + params->index_bytes + 3 * params->n;
+  uint32_t addr[8] = { 0 };
+  HASH_STATS_ENTER(HASH_STATS_BDS);
+
+  if (idx < (1U << params->tree_height) - 1) {
+    XMSS_TRACE_BEGIN(XMSS_TRACE_BDS, idx);
+    bds_round(params, state, idx, sk_seed, pub_seed, addr);
+    XMSS_TRACE_END(XMSS_TRACE_BDS, idx);
+    XMSS_TRACE_BEGIN(XMSS_TRACE_TREEHASH, idx);
+    bds_treehash_update(params, state, (params->tree_height - params->bds_k) >> 1, sk_seed, pub_seed, addr);
+    XMSS_TRACE_END(XMSS_TRACE_TREEHASH, idx);
+  }
+  HASH_STATS_LEAVE();
+}
 
-#if ORIG
 /**
-* Signs a message.
-* Returns
-* 1. an array containing the signature followed by the message AND
-* 2. an updated secret key!
-*
+* Starts the message hash for the index stored in sk: computes the
+* pseudorandom value R for that index and absorbs the prefix into h.
 */
-int xmss_core_sign(const xmss_params *params,
-                   uint8_t *sk,
-                   uint8_t *sm,
-                   uint64_t *smlen,
-                   const uint8_t *m,
-                   uint64_t mlen)
+static int sign_hash_init(const xmss_params *params,
+                          const uint8_t *sk,
+                          hash_message_ctx *h,
+                          uint8_t *R)
 {
+  const uint8_t *sk_prf = sk + params->index_bytes + params->n;
   const uint8_t *pub_root = sk + params->index_bytes + 2 * params->n;
+  uint64_t idx = bytes_to_ull(sk, params->index_bytes);
+  uint8_t idx_bytes_32[32];
+  HASH_STATS_ENTER(HASH_STATS_MESSAGE);
 
-  uint16_t i = 0;
+  ull_to_bytes(idx_bytes_32, 32, idx);
+  prf(params, R, idx_bytes_32, sk_prf);
+  HASH_STATS_LEAVE();
 
-  // TODO refactor BDS state not to need separate treehash instances
-  bds_state state;
-  treehash_inst treehash[params->tree_height - params->bds_k];
-  state.treehash = treehash;
+  return hash_message_init(params, h, R, pub_root, idx);
+}
 
-  /* Load the BDS state from sk. */
-  xmss_deserialize_state(params, &state, sk);
+#if ORIG
+/**
+* Computes the signature for the index stored in sk, using the auth path that
+* was prepared in state during the previous round, and bumps the index in sk.
+* The message has been absorbed into h, with randomness R; the signature of
+* params->sig_bytes bytes is written to sig. The BDS state is not advanced;
+* the used index is returned in idx_out.
+*/
+static int xmss_sign_leaf_hashed(const xmss_params *params,
+                                 uint8_t *sk,
+                                 const bds_state *state,
+                                 unsigned long *idx_out,
+                                 uint8_t *sig,
+                                 const uint8_t *R,
+                                 hash_message_ctx *h)
+{
+  uint16_t i = 0;
 
   // Extract SK
   unsigned long idx = ((unsigned long)sk[0] << 24) | ((unsigned long)sk[1] << 16) | ((unsigned long)sk[2] << 8) | sk[3];
+  if (idx >= bytes_to_ull(index_limit(params, sk), params->index_bytes)) {
+    return -1;
+  }
   uint8_t sk_seed[params->n];
   memcpy(sk_seed, sk + params->index_bytes, params->n);
-  uint8_t sk_prf[params->n];
-  memcpy(sk_prf, sk + params->index_bytes + params->n, params->n);
   uint8_t pub_seed[params->n];
   memcpy(pub_seed, sk + params->index_bytes + 3 * params->n, params->n);
 
-  // index as 32 bytes string
-  uint8_t idx_bytes_32[32];
-  ull_to_bytes(idx_bytes_32, 32, idx);
-
   // Update SK
   sk[0] = ((idx + 1) >> 24) & 255;
   sk[1] = ((idx + 1) >> 16) & 255;
@@ -653,7 +774,6 @@ int xmss_core_sign(const xmss_params *params,
   //  and write the updated secret key at this point!
 
   // Init working params
-  uint8_t R[params->n];
   uint8_t msg_h[params->n];
   uint8_t ots_seed[params->n];
   uint32_t ots_addr[8] = { 0 };
@@ -662,37 +782,25 @@ int xmss_core_sign(const xmss_params *params,
   // Message Hashing
   // ---------------------------------
 
-  // Message Hash:
-  // First compute pseudorandom value
-  prf(params, R, idx_bytes_32, sk_prf);
-
-  /* Already put the message in the right place, to make it easier to prepend
-  * things when computing the hash over the message. */
-  memcpy(sm + params->sig_bytes, m, mlen);
-
-  /* Compute the message hash. */
-  hash_message(params, msg_h, R, pub_root, idx,
-    sm + params->sig_bytes - 4 * params->n, mlen);
-
-  // Start collecting signature
-  *smlen = 0;
+  /* The pseudorandom value R is already part of the hash in h. */
+  XMSS_TRACE_BEGIN(XMSS_TRACE_MESSAGE, idx);
+  hash_message_final(msg_h, h);
+  XMSS_TRACE_END(XMSS_TRACE_MESSAGE, idx);
 
   // Copy index to signature
-  sm[0] = (idx >> 24) & 255;
-  sm[1] = (idx >> 16) & 255;
-  sm[2] = (idx >> 8) & 255;
-  sm[3] = idx & 255;
+  sig[0] = (idx >> 24) & 255;
+  sig[1] = (idx >> 16) & 255;
+  sig[2] = (idx >> 8) & 255;
+  sig[3] = idx & 255;
 
-  sm += 4;
-  *smlen += 4;
+  sig += 4;
 
   // Copy R to signature
   for (i = 0; i < params->n; i++) {
-    sm[i] = R[i];
+    sig[i] = R[i];
   }
 
-  sm += params->n;
-  *smlen += params->n;
+  sig += params->n;
 
   // ----------------------------------
   // Now we start to "really sign"
@@ -703,30 +811,19 @@ int xmss_core_sign(const xmss_params *params,
   set_ots_addr(ots_addr, idx);
 
   // Compute seed for OTS key pair
+  XMSS_TRACE_BEGIN(XMSS_TRACE_WOTS, idx);
   get_seed(params, ots_seed, sk_seed, ots_addr);
 
   // Compute WOTS signature
-  wots_sign(params, sm, msg_h, ots_seed, pub_seed, ots_addr);
+  wots_sign(params, sig, msg_h, ots_seed, pub_seed, ots_addr);
+  XMSS_TRACE_END(XMSS_TRACE_WOTS, idx);
 
-  sm += params->wots_sig_bytes;
-  *smlen += params->wots_sig_bytes;
+  sig += params->wots_sig_bytes;
 
   // the auth path was already computed during the previous round
-  memcpy(sm, state.auth, params->tree_height*params->n);
-
-  if (idx < (1U << params->tree_height) - 1) {
-    bds_round(params, &state, idx, sk_seed, pub_seed, ots_addr);
-    bds_treehash_update(params, &state, (params->tree_height - params->bds_k) >> 1, sk_seed, pub_seed, ots_addr);
-  }
-
-  sm += params->tree_height*params->n;
-  *smlen += params->tree_height*params->n;
+  memcpy(sig, state->auth, params->tree_height*params->n);
 
-  memcpy(sm, m, mlen);
-  *smlen += mlen;
-
-  /* Write the updated BDS state back into sk. */
-  xmss_serialize_state(params, sk, &state);
+  *idx_out = idx;
 
   return 0;
 }
@@ -734,44 +831,33 @@ int xmss_core_sign(const xmss_params *params,
 
 #if COUNTER
 /**
-* Signs a message.
-* Returns
-* 1. an array containing the signature followed by the message AND
-* 2. an updated secret key!
-*
+* Computes the signature for the index stored in sk, using the auth path that
+* was prepared in state during the previous round, and bumps the index in sk.
+* The message has been absorbed into h, with randomness R; the signature of
+* params->sig_bytes bytes is written to sig. The BDS state is not advanced;
+* the used index is returned in idx_out.
 */
-int xmss_core_sign(const xmss_params *params,
-                   uint8_t *sk,
-                   uint8_t *sm,
-                   uint64_t *smlen,
-                   const uint8_t *m,
-                   uint64_t mlen)
+static int xmss_sign_leaf_hashed(const xmss_params *params,
+                                 uint8_t *sk,
+                                 const bds_state *state,
+                                 unsigned long *idx_out,
+                                 uint8_t *sig,
+                                 const uint8_t *R,
+                                 hash_message_ctx *h)
 {
-  const uint8_t *pub_root = sk + params->index_bytes + 2 * params->n;
-
   uint64_t i = 0;
 
-  // TODO refactor BDS state not to need separate treehash instances
-  bds_state state;
-  treehash_inst treehash[params->tree_height - params->bds_k];
-  state.treehash = treehash;
-
-  /* Load the BDS state from sk. */
-  xmss_deserialize_state(params, &state, sk);
-
   // Extract SK
   unsigned long idx = ((unsigned long)sk[0] << 24) | ((unsigned long)sk[1] << 16) | ((unsigned long)sk[2] << 8) | sk[3];
+  /* The last 8 bytes of the message are the slot for the counter. */
+  if (h->taillen < 8 || idx >= bytes_to_ull(index_limit(params, sk), params->index_bytes)) {
+    return -1;
+  }
   uint8_t sk_seed[params->n];
   memcpy(sk_seed, sk + params->index_bytes, params->n);
-  uint8_t sk_prf[params->n];
-  memcpy(sk_prf, sk + params->index_bytes + params->n, params->n);
   uint8_t pub_seed[params->n];
   memcpy(pub_seed, sk + params->index_bytes + 3 * params->n, params->n);
 
-  // index as 32 bytes string
-  uint8_t idx_bytes_32[32];
-  ull_to_bytes(idx_bytes_32, 32, idx);
-
   // Update SK
   sk[0] = ((idx + 1) >> 24) & 255;
   sk[1] = ((idx + 1) >> 16) & 255;
@@ -782,7 +868,6 @@ int xmss_core_sign(const xmss_params *params,
   //  and write the updated secret key at this point!
 
   // Init working params
-  uint8_t R[params->n];
   uint8_t msg_h[params->n];
   uint8_t ots_seed[params->n];
   uint32_t ots_addr[8] = { 0 };
@@ -791,67 +876,36 @@ int xmss_core_sign(const xmss_params *params,
   // Message Hashing
   // ---------------------------------
 
-  // Message Hash:
-  // First compute pseudorandom value
-  prf(params, R, idx_bytes_32, sk_prf);
-
-  /* Already put the message in the right place, to make it easier to prepend
-  * things when computing the hash over the message. */
-  memcpy(sm + params->sig_bytes, m, mlen);
-
-  /* Compute the message hash. */
+  /* Compute the message hash. The pseudorandom value R is already part of
+  * the hash in h. */
 
   /* Below the original code from the RDC implementation. */
   //hash_message(params, msg_h, R, pub_root, idx,
   //             (sm + params->sig_bytes - 4*params->n), mlen);
 
-#define XMSS_HASH_PADDING_HASH 2
-
-  ull_to_bytes((sm + params->sig_bytes - 4 * params->n), params->n, XMSS_HASH_PADDING_HASH);
-  memcpy((sm + params->sig_bytes - 4 * params->n) + params->n, R, params->n);
-  memcpy((sm + params->sig_bytes - 4 * params->n) + 2 * params->n, pub_root, params->n);
-  ull_to_bytes((sm + params->sig_bytes - 4 * params->n) + 3 * params->n, params->n, idx);
-  *(uint64_t*)(sm + params->sig_bytes + 32) = 0;
-
-  SHA256((sm + params->sig_bytes - 4 * params->n), mlen + 4 * params->n, msg_h);
-
-  /* Number of blocks, hardcoded for this example. */
-#define BLOCK 2
-
-  /* Enable or disable the precomputation of the hash blocks. */
-#define FASTHASH 1
+  /* The prefix and all full message blocks before the counter have been
+  * absorbed into h; every counter value only hashes the tail of the
+  * message again. */
+  XMSS_TRACE_BEGIN(XMSS_TRACE_MESSAGE, idx);
+  hash_message_final_counter(msg_h, h, 0);
+  XMSS_TRACE_END(XMSS_TRACE_MESSAGE, idx);
 
   {
-    uint8_t h2[258 / 8];
+    uint8_t h2[params->n];
     int orig1 = wots_getlengths1(params, msg_h),
         orig2 = wots_getlengths2(params, msg_h),
         new1, new2;
+    HASH_STATS_ENTER(HASH_STATS_GRIND);
+    XMSS_TRACE_BEGIN(XMSS_TRACE_GRIND, idx);
 
     memcpy(msg_h_best1, msg_h, params->n);
     memcpy(msg_h_best2, msg_h, params->n);
-
-#if FASTHASH
-    sha256ctx state1, state2;
-    sha256_inc_init(&state1);
-
-    // Message = 32+8 bytes
-    // Rest = 128 bytes
-    // Total 168 bytes
-    // SHA256 has 64 byte blocks so process two blocks first
-    sha256_inc_blocks(&state1, (sm + params->sig_bytes - 4 * params->n), BLOCK);
-#endif
+    /* Counter 0 wins unless another one does better. */
+    besti = 0;
 
     /* we already processed counter number 0 */
-    for (i = 1; i < ((uint64_t)1 << 10); i++) {
-      *(uint64_t*)(sm + params->sig_bytes + 32) = i;
-#if FASTHASH
-      memcpy(state2.ctx, state1.ctx, PQC_SHA256CTX_BYTES);
-      sha256_inc_finalize(h2, &state1, (sm + params->sig_bytes - 4 * params->n) + BLOCK * 64, mlen + 4 * params->n - BLOCK * 64);
-      memcpy(state1.ctx, state2.ctx, PQC_SHA256CTX_BYTES);
-#else
-      /* Do the full hash over and over again */
-      SHA256((sm + params->sig_bytes - 4 * params->n), mlen + 4 * params->n, h2);
-#endif
+    for (i = 1; i < ((uint64_t)1 << params->grind_bits); i++) {
+      hash_message_final_counter(h2, h, i);
       
       new1 = wots_getlengths1(params, h2);
       new2 = wots_getlengths2(params, h2);
@@ -867,6 +921,8 @@ int xmss_core_sign(const xmss_params *params,
         memcpy(msg_h_best2, h2, params->n);
       }
     }
+    XMSS_TRACE_END(XMSS_TRACE_GRIND, idx);
+    HASH_STATS_LEAVE();
 
 #if 0
     /* Output findings to generate graphs, in real
@@ -898,28 +954,23 @@ int xmss_core_sign(const xmss_params *params,
 #endif
 
     // Copy the winner over
-    memcpy(msg_h, msg_h_best2, 256 / 8);
+    memcpy(msg_h, msg_h_best2, params->n);
   }
 
-  // Start collecting signature
-  *smlen = 0;
-
   // Copy index to signature
-  sm[0] = (idx >> 24) & 255;
-  sm[1] = (idx >> 16) & 255;
-  sm[2] = (idx >> 8) & 255;
-  sm[3] = idx & 255;
+  sig[0] = (idx >> 24) & 255;
+  sig[1] = (idx >> 16) & 255;
+  sig[2] = (idx >> 8) & 255;
+  sig[3] = idx & 255;
 
-  sm += 4;
-  *smlen += 4;
+  sig += 4;
 
   // Copy R to signature
   for (i = 0; i < params->n; i++) {
-    sm[i] = R[i];
+    sig[i] = R[i];
   }
 
-  sm += params->n;
-  *smlen += params->n;
+  sig += params->n;
 
   // ----------------------------------
   // Now we start to "really sign"
@@ -930,90 +981,65 @@ int xmss_core_sign(const xmss_params *params,
   set_ots_addr(ots_addr, idx);
 
   // Compute seed for OTS key pair
+  XMSS_TRACE_BEGIN(XMSS_TRACE_WOTS, idx);
   get_seed(params, ots_seed, sk_seed, ots_addr);
 
   // Compute WOTS signature
-  wots_sign(params, sm, msg_h, ots_seed, pub_seed, ots_addr);
+  wots_sign(params, sig, msg_h, ots_seed, pub_seed, ots_addr);
+  XMSS_TRACE_END(XMSS_TRACE_WOTS, idx);
 
-  sm += params->wots_sig_bytes;
-  *smlen += params->wots_sig_bytes;
+  sig += params->wots_sig_bytes;
 
   // the auth path was already computed during the previous round
-  memcpy(sm, state.auth, params->tree_height*params->n);
+  memcpy(sig, state->auth, params->tree_height*params->n);
 
-  if (idx < (1U << params->tree_height) - 1) {
-    bds_round(params, &state, idx, sk_seed, pub_seed, ots_addr);
-    bds_treehash_update(params, &state, (params->tree_height - params->bds_k) >> 1, sk_seed, pub_seed, ots_addr);
-  }
-
-  sm += params->tree_height*params->n;
-  *smlen += params->tree_height*params->n;
-
-  memcpy(sm, m, mlen);
-  *smlen += mlen;
-
-  /* Write the updated BDS state back into sk. */
-  xmss_serialize_state(params, sk, &state);
+  *idx_out = idx;
 
   return 0;
 }
 #endif
 
-/*
-* Generates a XMSSMT key pair for a given parameter set.
-* Format sk: [(ceil(h/8) bit) idx || SK_SEED || SK_PRF || root || PUB_SEED]
-* Format pk: [root || PUB_SEED] omitting algo oid.
+/**
+* Computes the signature of a message that is only read, like
+* xmss_sign_leaf_hashed.
 */
-int xmssmt_core_keypair(const xmss_params *params,
-                        uint8_t *pk,
-                        uint8_t *sk)
+static int xmss_sign_leaf_detached(const xmss_params *params,
+                                   uint8_t *sk,
+                                   const bds_state *state,
+                                   unsigned long *idx_out,
+                                   uint8_t *sig,
+                                   const uint8_t *m,
+                                   uint64_t mlen)
 {
-  uint8_t ots_seed[params->n];
-  uint32_t addr[8] = { 0 };
-  uint32_t i;
-  uint8_t *wots_sigs;
-
-  // TODO refactor BDS state not to need separate treehash instances
-  bds_state states[2 * params->d - 1];
-  treehash_inst treehash[(2 * params->d - 1) * (params->tree_height - params->bds_k)];
-  for (i = 0; i < 2 * params->d - 1; i++) {
-    states[i].treehash = treehash + i * (params->tree_height - params->bds_k);
-  }
-
-  xmssmt_deserialize_state(params, states, &wots_sigs, sk);
-
-  for (i = 0; i < 2 * params->d - 1; i++) {
-    states[i].stackoffset = 0;
-    states[i].next_leaf = 0;
-  }
+  hash_message_ctx h;
+  uint8_t R[params->n];
 
-  // Set idx = 0
-  for (i = 0; i < params->index_bytes; i++) {
-    sk[i] = 0;
+  if (sign_hash_init(params, sk, &h, R)) {
+    return -1;
   }
-  // Init SK_SEED (params->n byte) and SK_PRF (params->n byte)
-  randombytes(sk + params->index_bytes, 2 * params->n);
+  hash_message_update(&h, m, mlen);
 
-  // Init PUB_SEED (params->n byte)
-  randombytes(sk + params->index_bytes + 3 * params->n, params->n);
-  // Copy PUB_SEED to public key
-  memcpy(pk + params->n, sk + params->index_bytes + 3 * params->n, params->n);
+  return xmss_sign_leaf_hashed(params, sk, state, idx_out, sig, R, &h);
+}
 
-  // Start with the bottom-most layer
-  set_layer_addr(addr, 0);
-  // Set up state and compute wots signatures for all but topmost tree root
-  for (i = 0; i < params->d - 1; i++) {
-    // Compute seed for OTS key pair
-    treehash_init(params, pk, params->tree_height, 0, states + i, sk + params->index_bytes, pk + params->n, addr);
-    set_layer_addr(addr, (i + 1));
-    get_seed(params, ots_seed, sk + params->index_bytes, addr);
-    wots_sign(params, wots_sigs + i * params->wots_sig_bytes, pk, ots_seed, pk + params->n, addr);
+/**
+* Computes the signature like xmss_sign_leaf_detached, and appends the
+* message to it in sm.
+*/
+static int xmss_sign_leaf(const xmss_params *params,
+                          uint8_t *sk,
+                          const bds_state *state,
+                          unsigned long *idx_out,
+                          uint8_t *sm,
+                          uint64_t *smlen,
+                          const uint8_t *m,
+                          uint64_t mlen)
+{
+  if (xmss_sign_leaf_detached(params, sk, state, idx_out, sm, m, mlen)) {
+    return -1;
   }
-  // Address now points to the single tree on layer d-1
-  treehash_init(params, pk, params->tree_height, 0, states + i, sk + params->index_bytes, pk + params->n, addr);
-  memcpy(sk + params->index_bytes + 2 * params->n, pk, params->n);
-
-  xmssmt_serialize_state(params, sk, states);
+  memcpy(sm + params->sig_bytes, m, mlen);
+  *smlen = params->sig_bytes + mlen;
 
   return 0;
 }
@@ -1025,51 +1051,173 @@ int xmssmt_core_keypair(const xmss_params *params,
 * 2. an updated secret key!
 *
 */
-int xmssmt_core_sign(const xmss_params *params,
-                     uint8_t *sk,
-                     uint8_t *sm,
-                     uint64_t *smlen,
-                     const uint8_t *m,
-                     uint64_t mlen)
+int xmss_core_sign(const xmss_params *params,
+                   uint8_t *sk,
+                   uint8_t *sm,
+                   uint64_t *smlen,
+                   const uint8_t *m,
+                   uint64_t mlen)
 {
-  const uint8_t *pub_root = sk + params->index_bytes + 2 * params->n;
+  if (xmss_core_sign_detached(params, sk, sm, m, mlen)) {
+    return -1;
+  }
+  memcpy(sm + params->sig_bytes, m, mlen);
+  *smlen = params->sig_bytes + mlen;
 
-  uint64_t idx_tree;
-  uint32_t idx_leaf;
-  uint64_t i, j;
-  int needswap_upto = -1;
-  uint32_t updates;
+  return 0;
+}
 
-  uint8_t sk_seed[params->n];
-  uint8_t sk_prf[params->n];
-  uint8_t pub_seed[params->n];
-  // Init working params
+/**
+* Signs the message that has been absorbed into h, with randomness R, and
+* advances the BDS state in sk.
+*/
+static int xmss_sign_hashed(const xmss_params *params,
+                            uint8_t *sk,
+                            uint8_t *sig,
+                            const uint8_t *R,
+                            hash_message_ctx *h)
+{
+  unsigned long idx;
+
+  bds_state state;
+  uint32_t next_idx[params->tree_height - params->bds_k];
+  uint8_t low[params->tree_height - params->bds_k];
+  treehash_attach(params, &state, 1, next_idx, low);
+
+  /* Load the BDS state from sk. */
+  xmss_deserialize_state(params, &state, sk);
+
+  if (xmss_sign_leaf_hashed(params, sk, &state, &idx, sig, R, h)) {
+    return -1;
+  }
+  xmss_advance(params, &state, idx, sk);
+
+  /* Write the updated BDS state back into sk. */
+  xmss_serialize_state(params, sk, &state);
+
+  return 0;
+}
+
+/**
+* Signs a message without copying it. The signature of params->sig_bytes
+* bytes is written to sig, and sk is updated.
+*/
+int xmss_core_sign_detached(const xmss_params *params,
+                            uint8_t *sk,
+                            uint8_t *sig,
+                            const uint8_t *m,
+                            uint64_t mlen)
+{
+  hash_message_ctx h;
   uint8_t R[params->n];
-  uint8_t msg_h[params->n];
+
+  if (sign_hash_init(params, sk, &h, R)) {
+    return -1;
+  }
+  hash_message_update(&h, m, mlen);
+
+  return xmss_sign_hashed(params, sk, sig, R, &h);
+}
+
+/*
+* Generates a XMSSMT key pair for a given parameter set.
+* Format sk: [(ceil(h/8) bit) idx || SK_SEED || SK_PRF || root || PUB_SEED]
+* Format pk: [root || PUB_SEED] omitting algo oid.
+*/
+int xmssmt_core_keypair(const xmss_params *params,
+                        uint8_t *pk,
+                        uint8_t *sk)
+{
   uint8_t ots_seed[params->n];
   uint32_t addr[8] = { 0 };
-  uint32_t ots_addr[8] = { 0 };
-  uint8_t idx_bytes_32[32];
-
+  uint32_t i;
   uint8_t *wots_sigs;
 
-  // TODO refactor BDS state not to need separate treehash instances
   bds_state states[2 * params->d - 1];
-  treehash_inst treehash[(2 * params->d - 1) * (params->tree_height - params->bds_k)];
+  uint32_t next_idx[(2 * params->d - 1) * (params->tree_height - params->bds_k)];
+  uint8_t low[(2 * params->d - 1) * (params->tree_height - params->bds_k)];
+  treehash_attach(params, states, 2 * params->d - 1, next_idx, low);
+
+  /* Start from a zeroed sk, so that the states are well-formed when loaded
+  and all of them start out in their own slots. */
+  memset(sk, 0, params->sk_bytes);
+  xmssmt_deserialize_state(params, states, &wots_sigs, sk);
+
+  /* The key may use all of its indices. */
+  ull_to_bytes(index_limit(params, sk), params->index_bytes, 1ULL << params->full_height);
+
   for (i = 0; i < 2 * params->d - 1; i++) {
-    states[i].treehash = treehash + i * (params->tree_height - params->bds_k);
+    states[i].stackoffset = 0;
+    states[i].next_leaf = 0;
   }
 
-  xmssmt_deserialize_state(params, states, &wots_sigs, sk);
+  // Set idx = 0
+  for (i = 0; i < params->index_bytes; i++) {
+    sk[i] = 0;
+  }
+  // Init SK_SEED (params->n byte) and SK_PRF (params->n byte)
+  randombytes(sk + params->index_bytes, 2 * params->n);
+
+  // Init PUB_SEED (params->n byte)
+  randombytes(sk + params->index_bytes + 3 * params->n, params->n);
+  // Copy PUB_SEED to public key
+  memcpy(pk + params->n, sk + params->index_bytes + 3 * params->n, params->n);
+
+  // Start with the bottom-most layer
+  set_layer_addr(addr, 0);
+  // Set up state and compute wots signatures for all but topmost tree root
+  for (i = 0; i < params->d - 1; i++) {
+    // Compute seed for OTS key pair
+    treehash_init(params, pk, params->tree_height, 0, states + i, sk + params->index_bytes, pk + params->n, addr);
+    set_layer_addr(addr, (i + 1));
+    get_seed(params, ots_seed, sk + params->index_bytes, addr);
+    wots_sign(params, wots_sigs + i * params->wots_sig_bytes, pk, ots_seed, pk + params->n, addr);
+  }
+  // Address now points to the single tree on layer d-1
+  treehash_init(params, pk, params->tree_height, 0, states + i, sk + params->index_bytes, pk + params->n, addr);
+  memcpy(sk + params->index_bytes + 2 * params->n, pk, params->n);
+
+  xmssmt_serialize_state(params, sk, states);
+
+  return 0;
+}
+
+/**
+* Computes the XMSSMT signature for the index stored in sk, using the auth
+* paths and WOTS signatures prepared during the previous round, and bumps the
+* index in sk. The message has been absorbed into h, with randomness R. The
+* BDS states are not advanced; the used index is returned in idx_out.
+*/
+static int xmssmt_sign_leaf_hashed(const xmss_params *params,
+                                   uint8_t *sk,
+                                   const bds_state *states,
+                                   const uint8_t *wots_sigs,
+                                   uint64_t *idx_out,
+                                   uint8_t *sig,
+                                   const uint8_t *R,
+                                   const hash_message_ctx *h)
+{
+  uint64_t idx_tree;
+  uint32_t idx_leaf;
+  uint64_t i;
+
+  uint8_t sk_seed[params->n];
+  uint8_t pub_seed[params->n];
+  // Init working params
+  uint8_t msg_h[params->n];
+  uint8_t ots_seed[params->n];
+  uint32_t ots_addr[8] = { 0 };
 
   // Extract SK
   uint64_t idx = 0;
   for (i = 0; i < params->index_bytes; i++) {
     idx |= ((uint64_t)sk[i]) << 8 * (params->index_bytes - 1 - i);
   }
+  if (idx >= bytes_to_ull(index_limit(params, sk), params->index_bytes)) {
+    return -1;
+  }
 
   memcpy(sk_seed, sk + params->index_bytes, params->n);
-  memcpy(sk_prf, sk + params->index_bytes + params->n, params->n);
   memcpy(pub_seed, sk + params->index_bytes + 3 * params->n, params->n);
 
   // Update SK
@@ -1084,37 +1232,24 @@ int xmssmt_core_sign(const xmss_params *params,
   // Message Hashing
   // ---------------------------------
 
-  // Message Hash:
-  // First compute pseudorandom value
-  ull_to_bytes(idx_bytes_32, 32, idx);
-  prf(params, R, idx_bytes_32, sk_prf);
-
-  /* Already put the message in the right place, to make it easier to prepend
-  * things when computing the hash over the message. */
-  memcpy(sm + params->sig_bytes, m, mlen);
-
-  /* Compute the message hash. */
-  hash_message(params, msg_h, R, pub_root, idx,
-    sm + params->sig_bytes - 4 * params->n, mlen);
-
-  // Start collecting signature
-  *smlen = 0;
+  /* The pseudorandom value R is already part of the hash in h. */
+  XMSS_TRACE_BEGIN(XMSS_TRACE_MESSAGE, idx);
+  hash_message_final(msg_h, h);
+  XMSS_TRACE_END(XMSS_TRACE_MESSAGE, idx);
 
   // Copy index to signature
   for (i = 0; i < params->index_bytes; i++) {
-    sm[i] = (idx >> 8 * (params->index_bytes - 1 - i)) & 255;
+    sig[i] = (idx >> 8 * (params->index_bytes - 1 - i)) & 255;
   }
 
-  sm += params->index_bytes;
-  *smlen += params->index_bytes;
+  sig += params->index_bytes;
 
   // Copy R to signature
   for (i = 0; i < params->n; i++) {
-    sm[i] = R[i];
+    sig[i] = R[i];
   }
 
-  sm += params->n;
-  *smlen += params->n;
+  sig += params->n;
 
   // ----------------------------------
   // Now we start to "really sign"
@@ -1131,38 +1266,118 @@ int xmssmt_core_sign(const xmss_params *params,
   set_ots_addr(ots_addr, idx_leaf);
 
   // Compute seed for OTS key pair
+  XMSS_TRACE_BEGIN(XMSS_TRACE_WOTS, idx);
   get_seed(params, ots_seed, sk_seed, ots_addr);
 
   // Compute WOTS signature
-  wots_sign(params, sm, msg_h, ots_seed, pub_seed, ots_addr);
+  wots_sign(params, sig, msg_h, ots_seed, pub_seed, ots_addr);
+  XMSS_TRACE_END(XMSS_TRACE_WOTS, idx);
 
-  sm += params->wots_sig_bytes;
-  *smlen += params->wots_sig_bytes;
+  sig += params->wots_sig_bytes;
 
-  memcpy(sm, states[0].auth, params->tree_height*params->n);
-  sm += params->tree_height*params->n;
-  *smlen += params->tree_height*params->n;
+  memcpy(sig, states[0].auth, params->tree_height*params->n);
+  sig += params->tree_height*params->n;
 
   // prepare signature of remaining layers
   for (i = 1; i < params->d; i++) {
     // put WOTS signature in place
-    memcpy(sm, wots_sigs + (i - 1)*params->wots_sig_bytes, params->wots_sig_bytes);
+    memcpy(sig, wots_sigs + (i - 1)*params->wots_sig_bytes, params->wots_sig_bytes);
 
-    sm += params->wots_sig_bytes;
-    *smlen += params->wots_sig_bytes;
+    sig += params->wots_sig_bytes;
 
     // put AUTH nodes in place
-    memcpy(sm, states[i].auth, params->tree_height*params->n);
-    sm += params->tree_height*params->n;
-    *smlen += params->tree_height*params->n;
+    memcpy(sig, states[i].auth, params->tree_height*params->n);
+    sig += params->tree_height*params->n;
+  }
+
+  *idx_out = idx;
+
+  return 0;
+}
+
+/**
+* Computes the signature of a message that is only read, like
+* xmssmt_sign_leaf_hashed.
+*/
+static int xmssmt_sign_leaf_detached(const xmss_params *params,
+                                     uint8_t *sk,
+                                     const bds_state *states,
+                                     const uint8_t *wots_sigs,
+                                     uint64_t *idx_out,
+                                     uint8_t *sig,
+                                     const uint8_t *m,
+                                     uint64_t mlen)
+{
+  hash_message_ctx h;
+  uint8_t R[params->n];
+
+  if (sign_hash_init(params, sk, &h, R)) {
+    return -1;
+  }
+  hash_message_update(&h, m, mlen);
+
+  return xmssmt_sign_leaf_hashed(params, sk, states, wots_sigs, idx_out, sig, R, &h);
+}
+
+/**
+* Computes the signature like xmssmt_sign_leaf_detached, and appends the
+* message to it in sm.
+*/
+static int xmssmt_sign_leaf(const xmss_params *params,
+                            uint8_t *sk,
+                            const bds_state *states,
+                            const uint8_t *wots_sigs,
+                            uint64_t *idx_out,
+                            uint8_t *sm,
+                            uint64_t *smlen,
+                            const uint8_t *m,
+                            uint64_t mlen)
+{
+  if (xmssmt_sign_leaf_detached(params, sk, states, wots_sigs, idx_out, sm, m, mlen)) {
+    return -1;
   }
+  memcpy(sm + params->sig_bytes, m, mlen);
+  *smlen = params->sig_bytes + mlen;
+
+  return 0;
+}
+
+/**
+* Prepares the auth paths and WOTS signatures of the index following idx:
+* advances the BDS states of all layers, builds the NEXT trees and switches
+* to them when a subtree has been used up.
+*/
+static void xmssmt_advance(const xmss_params *params,
+                           bds_state *states,
+                           uint8_t *wots_sigs,
+                           uint64_t idx,
+                           uint8_t *sk)
+{
+  const uint8_t *sk_seed = sk + params->index_bytes;
+  const uint8_t *pub_seed = sk + params->index_bytes + 3 * params->n;
+
+  uint64_t idx_tree;
+  uint32_t idx_leaf;
+  uint64_t i, j;
+  int needswap_upto = -1;
+  uint32_t updates;
+
+  uint8_t ots_seed[params->n];
+  uint32_t addr[8] = { 0 };
+  uint32_t ots_addr[8] = { 0 };
+  HASH_STATS_ENTER(HASH_STATS_BDS);
+
+  idx_tree = idx >> params->tree_height;
+  idx_leaf = (idx & ((1 << params->tree_height) - 1));
 
   updates = (params->tree_height - params->bds_k) >> 1;
 
   set_tree_addr(addr, (idx_tree + 1));
   // mandatory update for NEXT_0 (does not count towards h-k/2) if NEXT_0 exists
   if ((1 + idx_tree) * (1 << params->tree_height) + idx_leaf < (1ULL << params->full_height)) {
+    XMSS_TRACE_BEGIN(XMSS_TRACE_NEXT_TREE, idx);
     bds_state_update(params, &states[params->d], sk_seed, pub_seed, addr);
+    XMSS_TRACE_END(XMSS_TRACE_NEXT_TREE, idx);
   }
 
   for (i = 0; i < params->d; i++) {
@@ -1173,26 +1388,33 @@ int xmssmt_core_sign(const xmss_params *params,
       set_layer_addr(addr, i);
       set_tree_addr(addr, idx_tree);
       if (i == (uint32_t)(needswap_upto + 1)) {
+        XMSS_TRACE_BEGIN(XMSS_TRACE_BDS, idx);
         bds_round(params, &states[i], idx_leaf, sk_seed, pub_seed, addr);
+        XMSS_TRACE_END(XMSS_TRACE_BDS, idx);
       }
+      XMSS_TRACE_BEGIN(XMSS_TRACE_TREEHASH, idx);
       updates = bds_treehash_update(params, &states[i], updates, sk_seed, pub_seed, addr);
+      XMSS_TRACE_END(XMSS_TRACE_TREEHASH, idx);
       set_tree_addr(addr, (idx_tree + 1));
       // if a NEXT-tree exists for this level;
       if ((1 + idx_tree) * (1 << params->tree_height) + idx_leaf < (1ULL << (params->full_height - params->tree_height * i))) {
         if (i > 0 && updates > 0 && states[params->d + i].next_leaf < (1ULL << params->full_height)) {
+          XMSS_TRACE_BEGIN(XMSS_TRACE_NEXT_TREE, idx);
           bds_state_update(params, &states[params->d + i], sk_seed, pub_seed, addr);
+          XMSS_TRACE_END(XMSS_TRACE_NEXT_TREE, idx);
           updates--;
         }
       }
     }
     else if (idx < (1ULL << params->full_height) - 1) {
-      deep_state_swap(params, states + params->d + i, states + i);
+      XMSS_TRACE_BEGIN(XMSS_TRACE_SWITCH, idx);
+      state_swap(params, states, state_slots(params, sk), i);
 
       set_layer_addr(ots_addr, (i + 1));
       set_tree_addr(ots_addr, ((idx + 1) >> ((i + 2) * params->tree_height)));
       set_ots_addr(ots_addr, (((idx >> ((i + 1) * params->tree_height)) + 1) & ((1 << params->tree_height) - 1)));
 
-      get_seed(params, ots_seed, sk + params->index_bytes, ots_addr);
+      get_seed(params, ots_seed, sk_seed, ots_addr);
       wots_sign(params, wots_sigs + i * params->wots_sig_bytes, states[i].stack, ots_seed, pub_seed, ots_addr);
 
       states[params->d + i].stackoffset = 0;
@@ -1201,15 +1423,1195 @@ int xmssmt_core_sign(const xmss_params *params,
       updates--; // WOTS-signing counts as one update
       needswap_upto = i;
       for (j = 0; j < params->tree_height - params->bds_k; j++) {
-        states[i].treehash[j].completed = 1;
+        states[i].treehash.completed[j] = 1;
+        states[i].treehash.low[j] = params->tree_height;
       }
+      XMSS_TRACE_END(XMSS_TRACE_SWITCH, idx);
     }
   }
+  HASH_STATS_LEAVE();
+}
+
+/**
+* Signs a message.
+* Returns
+* 1. an array containing the signature followed by the message AND
+* 2. an updated secret key!
+*
+*/
+int xmssmt_core_sign(const xmss_params *params,
+                     uint8_t *sk,
+                     uint8_t *sm,
+                     uint64_t *smlen,
+                     const uint8_t *m,
+                     uint64_t mlen)
+{
+  if (xmssmt_core_sign_detached(params, sk, sm, m, mlen)) {
+    return -1;
+  }
+  memcpy(sm + params->sig_bytes, m, mlen);
+  *smlen = params->sig_bytes + mlen;
+
+  return 0;
+}
+
+/**
+* Signs the message that has been absorbed into h, with randomness R, and
+* advances the BDS states in sk.
+*/
+static int xmssmt_sign_hashed(const xmss_params *params,
+                              uint8_t *sk,
+                              uint8_t *sig,
+                              const uint8_t *R,
+                              const hash_message_ctx *h)
+{
+  uint64_t idx;
+  uint8_t *wots_sigs;
 
-  memcpy(sm, m, mlen);
-  *smlen += mlen;
+  bds_state states[2 * params->d - 1];
+  uint32_t next_idx[(2 * params->d - 1) * (params->tree_height - params->bds_k)];
+  uint8_t low[(2 * params->d - 1) * (params->tree_height - params->bds_k)];
+  treehash_attach(params, states, 2 * params->d - 1, next_idx, low);
+
+  xmssmt_deserialize_state(params, states, &wots_sigs, sk);
+
+  if (xmssmt_sign_leaf_hashed(params, sk, states, wots_sigs, &idx, sig, R, h)) {
+    return -1;
+  }
+  xmssmt_advance(params, states, wots_sigs, idx, sk);
 
   xmssmt_serialize_state(params, sk, states);
 
   return 0;
 }
+
+/**
+* Signs a message without copying it. The signature of params->sig_bytes
+* bytes is written to sig, and sk is updated.
+*/
+int xmssmt_core_sign_detached(const xmss_params *params,
+                              uint8_t *sk,
+                              uint8_t *sig,
+                              const uint8_t *m,
+                              uint64_t mlen)
+{
+  hash_message_ctx h;
+  uint8_t R[params->n];
+
+  if (sign_hash_init(params, sk, &h, R)) {
+    return -1;
+  }
+  hash_message_update(&h, m, mlen);
+
+  return xmssmt_sign_hashed(params, sk, sig, R, &h);
+}
+
+/* State of a signature over a streamed message; see xmss_core_sign_init. */
+struct xmss_sign_ctx {
+  xmss_params params;
+  uint8_t *sk;
+  uint64_t idx;         /* the index that the message hash is bound to */
+  hash_message_ctx hash;
+  uint8_t *R;
+};
+
+int xmss_core_sign_init(const xmss_params *params,
+                        xmss_sign_ctx **ctx,
+                        uint8_t *sk)
+{
+  xmss_sign_ctx *c;
+  uint64_t idx = bytes_to_ull(sk, params->index_bytes);
+
+  if (idx >= bytes_to_ull(index_limit(params, sk), params->index_bytes)) {
+    return -1;
+  }
+  c = malloc(sizeof(xmss_sign_ctx) + params->n);
+  if (c == NULL) {
+    return -1;
+  }
+  c->params = *params;
+  c->sk = sk;
+  c->idx = idx;
+  c->R = (uint8_t *)(c + 1);
+  if (sign_hash_init(params, sk, &c->hash, c->R)) {
+    free(c);
+    return -1;
+  }
+
+  *ctx = c;
+  return 0;
+}
+
+int xmss_core_sign_update(xmss_sign_ctx *ctx,
+                          const uint8_t *m,
+                          uint64_t mlen)
+{
+  hash_message_update(&ctx->hash, m, mlen);
+  return 0;
+}
+
+int xmss_core_sign_final(xmss_sign_ctx *ctx, uint8_t *sig)
+{
+  const xmss_params *params = &ctx->params;
+  int ret = -1;
+
+  /* The hash is bound to the index at init; sk must not have moved on. */
+  if (bytes_to_ull(ctx->sk, params->index_bytes) == ctx->idx) {
+    if (params->d == 1) {
+      ret = xmss_sign_hashed(params, ctx->sk, sig, ctx->R, &ctx->hash);
+    }
+    else {
+      ret = xmssmt_sign_hashed(params, ctx->sk, sig, ctx->R, &ctx->hash);
+    }
+  }
+  free(ctx);
+  return ret;
+}
+
+/**
+* Rebuilds the BDS states and WOTS signatures in sk for index start from the
+* seeds, and sets the index of sk to start. The current tree of every layer is
+* generated and its state is moved forward to the leaf that start uses, and
+* every NEXT tree that is reached before the index limit is prepared as
+* signing would have. A start that is a multiple of 2^tree_height saves the
+* bottom-layer part. Returns -1 if the states do not reproduce the root.
+*/
+static int xmssmt_build_state(const xmss_params *params,
+                              uint8_t *sk,
+                              uint64_t start)
+{
+  const uint8_t *sk_seed = sk + params->index_bytes;
+  const uint8_t *pub_seed = sk + params->index_bytes + 3 * params->n;
+  uint64_t limit = bytes_to_ull(index_limit(params, sk), params->index_bytes);
+  uint64_t tree, leaf, l, leaves;
+  uint8_t root[params->n];
+  uint8_t ots_seed[params->n];
+  uint32_t addr[8] = { 0 };
+  uint32_t ots_addr[8] = { 0 };
+  uint32_t i;
+  uint8_t *wots_sigs;
+
+  bds_state states[2 * params->d - 1];
+  uint32_t next_idx[(2 * params->d - 1) * (params->tree_height - params->bds_k)];
+  uint8_t low[(2 * params->d - 1) * (params->tree_height - params->bds_k)];
+  treehash_attach(params, states, 2 * params->d - 1, next_idx, low);
+
+  /* Keep SK_SEED, SK_PRF, root, PUB_SEED and the limit; empty the states. */
+  memset(sk + params->index_bytes + 4 * params->n, 0, params->sk_bytes - params->index_bytes - 4 * params->n);
+  ull_to_bytes(index_limit(params, sk), params->index_bytes, limit);
+  xmssmt_deserialize_state(params, states, &wots_sigs, sk);
+
+  for (i = 0; i < params->d; i++) {
+    tree = start >> ((i + 1) * params->tree_height);
+    leaf = (start >> (i * params->tree_height)) & ((1 << params->tree_height) - 1);
+
+    if (i > 0) {
+      // sign the root of the tree below with the leaf that start uses here
+      set_layer_addr(ots_addr, i);
+      set_tree_addr(ots_addr, tree);
+      set_ots_addr(ots_addr, leaf);
+      get_seed(params, ots_seed, sk_seed, ots_addr);
+      wots_sign(params, wots_sigs + (i - 1) * params->wots_sig_bytes, root, ots_seed, pub_seed, ots_addr);
+    }
+
+    set_layer_addr(addr, i);
+    set_tree_addr(addr, tree);
+    treehash_init(params, root, params->tree_height, 0, &states[i], sk_seed, pub_seed, addr);
+    for (l = 0; l < leaf; l++) {
+      bds_round(params, &states[i], l, sk_seed, pub_seed, addr);
+      bds_treehash_update(params, &states[i], (params->tree_height - params->bds_k) >> 1, sk_seed, pub_seed, addr);
+    }
+
+    // NEXT_0 has seen one leaf per signature; the others are completed
+    if (i < params->d - 1 && ((tree + 1) << ((i + 1) * params->tree_height)) < limit) {
+      leaves = (i == 0) ? leaf : (1ULL << params->tree_height);
+      set_tree_addr(addr, tree + 1);
+      for (l = 0; l < leaves; l++) {
+        bds_state_update(params, &states[params->d + i], sk_seed, pub_seed, addr);
+      }
+    }
+  }
+
+  /* The top tree has to reproduce the root of the key. */
+  if (memcmp(root, sk + params->index_bytes + 2 * params->n, params->n)) {
+    return -1;
+  }
+
+  xmssmt_serialize_state(params, sk, states);
+  ull_to_bytes(sk, params->index_bytes, start);
+
+  return 0;
+}
+
+/**
+* Returns the index limit of sk, the first index it may not sign with.
+*/
+uint64_t xmss_core_index_limit(const xmss_params *params, const uint8_t *sk)
+{
+  return bytes_to_ull(index_limit(params, (uint8_t *)sk), params->index_bytes);
+}
+
+/**
+* Splits the indices [start, limit) off the key in sk into a new secret key
+* shard_sk with its own BDS states, and lowers the index limit of sk to
+* start. Both keys can then sign independently, without ever sharing an
+* index.
+*/
+int xmss_core_split(const xmss_params *params,
+                    uint8_t *shard_sk,
+                    uint8_t *sk,
+                    uint64_t start)
+{
+  uint64_t limit = bytes_to_ull(index_limit(params, sk), params->index_bytes);
+
+  if (start < bytes_to_ull(sk, params->index_bytes) || start >= limit) {
+    return -1;
+  }
+
+  memcpy(shard_sk, sk, params->sk_bytes);
+  if (xmssmt_build_state(params, shard_sk, start)) {
+    return -1;
+  }
+  ull_to_bytes(index_limit(params, sk), params->index_bytes, start);
+
+  return 0;
+}
+
+/* A signer that keeps the BDS states in memory; see xmss_core_signer_init. */
+struct xmss_signer {
+  xmss_params params;
+  uint8_t *sk;          /* the caller's secret key, updated on checkpoints */
+  uint8_t *work;        /* private copy of sk that the states point into */
+  bds_state *states;
+  uint32_t *next_idx;   /* native-form treehash fields of all states */
+  uint8_t *low;
+  uint8_t *wots_sigs;
+};
+
+/* State of an asynchronous signer; see xmss_core_async_start. */
+struct xmss_async_signer {
+  xmss_signer *signer;
+  pthread_t worker;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int pending;          /* the BDS state still has to be advanced past pending_idx */
+  int stop;
+  uint64_t pending_idx;
+};
+
+/**
+* Signs with the in-memory states of a signer and copies the bumped index into
+* the caller's sk right away, so that an index is never handed out twice.
+* Returns -1 if the index limit of the key has been reached.
+*/
+static int signer_sign_leaf(xmss_signer *signer,
+                            uint64_t *idx,
+                            uint8_t *sm,
+                            uint64_t *smlen,
+                            const uint8_t *m,
+                            uint64_t mlen)
+{
+  const xmss_params *params = &signer->params;
+
+  if (params->d == 1) {
+    unsigned long leaf;
+
+    if (xmss_sign_leaf(params, signer->work, signer->states, &leaf, sm, smlen, m, mlen)) {
+      return -1;
+    }
+    *idx = leaf;
+  }
+  else if (xmssmt_sign_leaf(params, signer->work, signer->states, signer->wots_sigs, idx, sm, smlen, m, mlen)) {
+    return -1;
+  }
+  memcpy(signer->sk, signer->work, params->index_bytes);
+  return 0;
+}
+
+static void signer_advance(xmss_signer *signer, uint64_t idx)
+{
+  const xmss_params *params = &signer->params;
+
+  if (params->d == 1) {
+    xmss_advance(params, signer->states, idx, signer->work);
+  }
+  else {
+    xmssmt_advance(params, signer->states, signer->wots_sigs, idx, signer->work);
+  }
+}
+
+/**
+* Creates a signer for an XMSS or XMSSMT secret key. The BDS states are
+* deserialized once and kept in memory across signatures.
+*/
+int xmss_core_signer_init(const xmss_params *params,
+                          xmss_signer **signer,
+                          uint8_t *sk)
+{
+  uint32_t instances = params->tree_height - params->bds_k;
+  xmss_signer *s = malloc(sizeof(xmss_signer));
+
+  if (s == NULL) {
+    return -1;
+  }
+  s->params = *params;
+  s->sk = sk;
+  s->work = malloc(params->sk_bytes);
+  s->states = malloc((2 * params->d - 1) * sizeof(bds_state));
+  s->next_idx = malloc(((2 * params->d - 1) * instances + 1) * sizeof(uint32_t));
+  s->low = malloc((2 * params->d - 1) * instances + 1);
+  if (s->work == NULL || s->states == NULL || s->next_idx == NULL || s->low == NULL) {
+    free(s->work);
+    free(s->states);
+    free(s->next_idx);
+    free(s->low);
+    free(s);
+    return -1;
+  }
+
+  memcpy(s->work, sk, params->sk_bytes);
+  treehash_attach(params, s->states, 2 * params->d - 1, s->next_idx, s->low);
+  s->wots_sigs = NULL;
+  xmssmt_deserialize_state(params, s->states, &s->wots_sigs, s->work);
+
+  *signer = s;
+  return 0;
+}
+
+/**
+* Signs a message with a signer, without (de)serializing the BDS states.
+*/
+int xmss_core_signer_sign(xmss_signer *signer,
+                          uint8_t *sm,
+                          uint64_t *smlen,
+                          const uint8_t *m,
+                          uint64_t mlen)
+{
+  uint64_t idx;
+
+  if (signer_sign_leaf(signer, &idx, sm, smlen, m, mlen)) {
+    return -1;
+  }
+  signer_advance(signer, idx);
+
+  return 0;
+}
+
+/* The number of auth path snapshots that a batch keeps in flight. */
+#define BATCH_SLOTS 16
+
+/* A batch of signatures in progress; see xmss_core_signer_sign_batch. */
+typedef struct {
+  xmss_signer *signer;
+  uint64_t idx;           /* the first index of the batch */
+  uint32_t count;
+  uint8_t *slots;         /* snapshots of the auth paths and WOTS signatures */
+  size_t slot_bytes;
+  uint32_t produced;      /* snapshots taken so far */
+  uint32_t consumed;      /* signatures completed so far */
+  int stop;               /* a signature failed; take no more snapshots */
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+} sign_batch;
+
+/**
+* BDS side of a batch. For every index, it takes a snapshot of the auth paths
+* (and WOTS signatures) that the signature needs, and advances the BDS states
+* to the next index while the signing thread works on the snapshot.
+*/
+static void *batch_worker(void *arg)
+{
+  sign_batch *b = arg;
+  const xmss_params *params = &b->signer->params;
+  uint8_t *slot;
+  uint32_t i, j;
+
+  for (j = 0; j < b->count; j++) {
+    pthread_mutex_lock(&b->lock);
+    while (j - b->consumed >= BATCH_SLOTS && !b->stop) {
+      pthread_cond_wait(&b->cond, &b->lock);
+    }
+    if (b->stop) {
+      pthread_mutex_unlock(&b->lock);
+      break;
+    }
+    pthread_mutex_unlock(&b->lock);
+
+    slot = b->slots + (j % BATCH_SLOTS) * b->slot_bytes;
+    for (i = 0; i < params->d; i++) {
+      memcpy(slot + i * params->tree_height * params->n, b->signer->states[i].auth, params->tree_height * params->n);
+    }
+    if (params->d > 1) {
+      memcpy(slot + params->d * params->tree_height * params->n, b->signer->wots_sigs, (params->d - 1) * params->wots_sig_bytes);
+    }
+    signer_advance(b->signer, b->idx + j);
+
+    pthread_mutex_lock(&b->lock);
+    b->produced = j + 1;
+    pthread_cond_broadcast(&b->cond);
+    pthread_mutex_unlock(&b->lock);
+  }
+  return NULL;
+}
+
+/**
+* Returns whether a message of mlen bytes can be signed. With COUNTER, XMSS
+* signing puts its counter into the last 8 bytes of the message.
+*/
+static int message_signable(const xmss_params *params, uint64_t mlen)
+{
+#if COUNTER
+  return params->d > 1 || mlen >= 8;
+#else
+  (void)params;
+  (void)mlen;
+  return 1;
+#endif
+}
+
+/**
+* Signs count messages with consecutive indices. All messages are checked and
+* the whole range is reserved in the caller's sk up front. A second thread
+* runs the BDS updates of the batch, so that they overlap with message hashing
+* and WOTS signing. Should a signature still fail, the batch stops there, and
+* the signer continues after the last index whose auth path the BDS thread
+* has already passed; the messages that were not signed get an smlen of 0.
+*/
+int xmss_core_signer_sign_batch(xmss_signer *signer,
+                                uint8_t **sm,
+                                uint64_t *smlen,
+                                const uint8_t **m,
+                                const uint64_t *mlen,
+                                uint32_t count)
+{
+  const xmss_params *params = &signer->params;
+  uint64_t limit = bytes_to_ull(index_limit(params, signer->work), params->index_bytes);
+  bds_state states[params->d];
+  pthread_t worker;
+  sign_batch b;
+  uint8_t *slot;
+  uint64_t idx;
+  unsigned long leaf;
+  uint32_t i, j;
+  int ret = 0;
+
+  b.signer = signer;
+  b.idx = bytes_to_ull(signer->work, params->index_bytes);
+  b.count = count;
+  b.slot_bytes = params->d * params->tree_height * params->n + (params->d - 1) * params->wots_sig_bytes;
+  b.produced = 0;
+  b.consumed = 0;
+  b.stop = 0;
+
+  if (count == 0) {
+    return 0;
+  }
+  if (count > limit - b.idx) {
+    return -1;
+  }
+  for (j = 0; j < count; j++) {
+    if (!message_signable(params, mlen[j])) {
+      return -1;
+    }
+  }
+  b.slots = malloc(BATCH_SLOTS * b.slot_bytes);
+  if (b.slots == NULL) {
+    return -1;
+  }
+  pthread_mutex_init(&b.lock, NULL);
+  pthread_cond_init(&b.cond, NULL);
+  if (pthread_create(&worker, NULL, batch_worker, &b)) {
+    pthread_cond_destroy(&b.cond);
+    pthread_mutex_destroy(&b.lock);
+    free(b.slots);
+    return -1;
+  }
+
+  /* Reserve the whole range before the first signature leaves. */
+  ull_to_bytes(signer->sk, params->index_bytes, b.idx + count);
+
+  for (j = 0; j < count; j++) {
+    pthread_mutex_lock(&b.lock);
+    while (b.produced <= j) {
+      pthread_cond_wait(&b.cond, &b.lock);
+    }
+    pthread_mutex_unlock(&b.lock);
+
+    slot = b.slots + (j % BATCH_SLOTS) * b.slot_bytes;
+    for (i = 0; i < params->d; i++) {
+      states[i].auth = slot + i * params->tree_height * params->n;
+    }
+    if (params->d == 1) {
+      ret = xmss_sign_leaf(params, signer->work, states, &leaf, sm[j], &smlen[j], m[j], mlen[j]);
+    }
+    else {
+      ret = xmssmt_sign_leaf(params, signer->work, states, slot + params->d * params->tree_height * params->n, &idx, sm[j], &smlen[j], m[j], mlen[j]);
+    }
+
+    pthread_mutex_lock(&b.lock);
+    b.consumed = j + 1;
+    b.stop = ret != 0;
+    pthread_cond_broadcast(&b.cond);
+    pthread_mutex_unlock(&b.lock);
+    if (ret) {
+      break;
+    }
+  }
+
+  pthread_join(worker, NULL);
+  if (ret) {
+    /* The BDS states have been advanced past the auth paths of all
+    snapshots; the indices before that are given up. */
+    for (; j < count; j++) {
+      smlen[j] = 0;
+    }
+    ull_to_bytes(signer->work, params->index_bytes, b.idx + b.produced);
+    memcpy(signer->sk, signer->work, params->index_bytes);
+  }
+  pthread_cond_destroy(&b.cond);
+  pthread_mutex_destroy(&b.lock);
+  free(b.slots);
+
+  return ret;
+}
+
+/**
+* Moves a signer forward to index idx without signing, i.e. the indices up to
+* idx are given up. The BDS states are advanced as if they had been used.
+*/
+int xmss_core_signer_skip(xmss_signer *signer, uint64_t idx)
+{
+  const xmss_params *params = &signer->params;
+  uint64_t i = bytes_to_ull(signer->work, params->index_bytes);
+
+  if (idx < i || idx > bytes_to_ull(index_limit(params, signer->work), params->index_bytes)) {
+    return -1;
+  }
+  for (; i < idx; i++) {
+    signer_advance(signer, i);
+  }
+  ull_to_bytes(signer->work, params->index_bytes, idx);
+  memcpy(signer->sk, signer->work, params->index_bytes);
+
+  return 0;
+}
+
+/**
+* Writes the complete in-memory state of a signer into its secret key.
+*/
+void xmss_core_signer_checkpoint(xmss_signer *signer)
+{
+  xmssmt_serialize_state(&signer->params, signer->work, signer->states);
+  memcpy(signer->sk, signer->work, signer->params.sk_bytes);
+}
+
+/**
+* Checkpoints and releases a signer.
+*/
+void xmss_core_signer_free(xmss_signer *signer)
+{
+  xmss_core_signer_checkpoint(signer);
+  free(signer->work);
+  free(signer->states);
+  free(signer->next_idx);
+  free(signer->low);
+  free(signer);
+}
+
+/**
+* Worker thread of an asynchronous signer. Whenever a signature has been
+* handed out, it advances the in-memory BDS state(s) to the next index so that
+* the following sign call finds its auth path ready.
+*/
+static void *xmss_async_worker(void *arg)
+{
+  xmss_async_signer *async = arg;
+  uint64_t idx;
+
+  pthread_mutex_lock(&async->lock);
+  for (;;) {
+    while (!async->pending && !async->stop) {
+      pthread_cond_wait(&async->cond, &async->lock);
+    }
+    if (!async->pending) {
+      break;
+    }
+    idx = async->pending_idx;
+    pthread_mutex_unlock(&async->lock);
+
+    signer_advance(async->signer, idx);
+
+    pthread_mutex_lock(&async->lock);
+    async->pending = 0;
+    pthread_cond_broadcast(&async->cond);
+  }
+  pthread_mutex_unlock(&async->lock);
+
+  return NULL;
+}
+
+/**
+* Starts an asynchronous signer on sk, which is used for both XMSS and XMSSMT
+* parameter sets. The signer takes ownership of sk until it is stopped.
+*/
+int xmss_core_async_start(const xmss_params *params,
+                          xmss_async_signer **async,
+                          uint8_t *sk)
+{
+  xmss_async_signer *s = malloc(sizeof(xmss_async_signer));
+
+  if (s == NULL) {
+    return -1;
+  }
+  if (xmss_core_signer_init(params, &s->signer, sk)) {
+    free(s);
+    return -1;
+  }
+  s->pending = 0;
+  s->stop = 0;
+  s->pending_idx = 0;
+  pthread_mutex_init(&s->lock, NULL);
+  pthread_cond_init(&s->cond, NULL);
+
+  if (pthread_create(&s->worker, NULL, xmss_async_worker, s)) {
+    pthread_cond_destroy(&s->cond);
+    pthread_mutex_destroy(&s->lock);
+    xmss_core_signer_free(s->signer);
+    free(s);
+    return -1;
+  }
+  *async = s;
+  return 0;
+}
+
+/**
+* Signs a message using the auth path that the worker prepared in the
+* background, and hands the BDS update for the next index back to the worker.
+* Blocks only if the worker has not yet finished the previous update.
+*/
+int xmss_core_async_sign(xmss_async_signer *async,
+                         uint8_t *sm,
+                         uint64_t *smlen,
+                         const uint8_t *m,
+                         uint64_t mlen)
+{
+  pthread_mutex_lock(&async->lock);
+  while (async->pending) {
+    pthread_cond_wait(&async->cond, &async->lock);
+  }
+
+  if (signer_sign_leaf(async->signer, &async->pending_idx, sm, smlen, m, mlen)) {
+    pthread_mutex_unlock(&async->lock);
+    return -1;
+  }
+
+  async->pending = 1;
+  pthread_cond_broadcast(&async->cond);
+  pthread_mutex_unlock(&async->lock);
+
+  return 0;
+}
+
+/**
+* Waits for the outstanding BDS update, stops the worker and releases the
+* signer. Afterwards sk holds a fully up-to-date secret key again.
+*/
+void xmss_core_async_stop(xmss_async_signer *async)
+{
+  pthread_mutex_lock(&async->lock);
+  async->stop = 1;
+  pthread_cond_broadcast(&async->cond);
+  pthread_mutex_unlock(&async->lock);
+
+  pthread_join(async->worker, NULL);
+  pthread_cond_destroy(&async->cond);
+  pthread_mutex_destroy(&async->lock);
+  xmss_core_signer_free(async->signer);
+  free(async);
+}
+
+/* Shared state of a concurrent signer; see xmss_core_concurrent_init. */
+struct xmss_concurrent_signer {
+  xmss_params params;
+  uint8_t *sk;              /* the caller's key; its index marks the claimed indices */
+  uint64_t first;           /* the index of sk when the signer was created */
+  uint64_t limit;
+  _Atomic uint64_t next_tree;  /* the next bottom tree to claim */
+  pthread_mutex_t lock;     /* protects the index in sk and the upper-layer cache */
+  uint64_t *cache_key;      /* per layer from 2 onwards: the tree and leaf cached */
+  uint8_t *cache;           /* per layer: auth path, WOTS signature and root */
+  uint64_t nodes_key;       /* the layer-1 tree whose nodes are cached */
+  uint8_t *nodes;           /* all nodes of that tree, see tree_nodes */
+  xmss_signer *serial;      /* XMSS only: the signer all threads share */
+};
+
+/* Per-thread state of a concurrent signer; see xmss_core_concurrent_attach. */
+struct xmss_thread_signer {
+  xmss_concurrent_signer *shared;
+  uint8_t *sk;              /* private key for the indices of the claimed tree, or
+                               for XMSS, of the claimed index */
+  bds_state *states;        /* layer 0 runs BDS; upper layers only hold auth */
+  uint32_t *next_idx;
+  uint8_t *low;
+  uint8_t *wots_sigs;
+  uint8_t *auth;            /* XMSS: the auth path of the claimed index */
+  uint8_t *nodes;           /* XMSSMT: a layer-1 tree on its way to the cache */
+  uint64_t tree;
+  int claimed;
+};
+
+/**
+* Computes the root of the tree at addr and the auth path of one of its
+* leaves, by generating the whole tree.
+*/
+static void tree_auth_path(const xmss_params *params,
+                           uint8_t *root,
+                           uint8_t *auth,
+                           uint32_t leaf,
+                           const uint8_t *sk_seed,
+                           const uint8_t *pub_seed,
+                           const uint32_t addr[8])
+{
+  uint32_t ots_addr[8] = { 0 };
+  uint32_t ltree_addr[8] = { 0 };
+  uint32_t node_addr[8] = { 0 };
+  uint8_t stack[(params->tree_height + 1) * params->n];
+  uint32_t stacklevels[params->tree_height + 1];
+  uint32_t stackoffset = 0;
+  uint32_t idx, nodeh;
+  HASH_STATS_ENTER(HASH_STATS_AUTH);
+
+  copy_subtree_addr(ots_addr, addr);
+  set_type(ots_addr, 0);
+  copy_subtree_addr(ltree_addr, addr);
+  set_type(ltree_addr, 1);
+  copy_subtree_addr(node_addr, addr);
+  set_type(node_addr, 2);
+
+  for (idx = 0; idx < 1U << params->tree_height; idx++) {
+    set_ltree_addr(ltree_addr, idx);
+    set_ots_addr(ots_addr, idx);
+    gen_leaf_wots(params, stack + stackoffset * params->n, sk_seed, pub_seed, ltree_addr, ots_addr);
+    if (idx == (leaf ^ 1)) {
+      memcpy(auth, stack + stackoffset * params->n, params->n);
+    }
+    stacklevels[stackoffset] = 0;
+    stackoffset++;
+    while (stackoffset > 1 && stacklevels[stackoffset - 1] == stacklevels[stackoffset - 2]) {
+      nodeh = stacklevels[stackoffset - 1];
+      set_tree_height(node_addr, nodeh);
+      set_tree_index(node_addr, idx >> (nodeh + 1));
+      thash_h(params, stack + (stackoffset - 2) * params->n, stack + (stackoffset - 2) * params->n, pub_seed, node_addr);
+      stacklevels[stackoffset - 2]++;
+      stackoffset--;
+      nodeh++;
+      if (nodeh < params->tree_height && (idx >> nodeh) == ((leaf >> nodeh) ^ 1)) {
+        memcpy(auth + nodeh * params->n, stack + (stackoffset - 1) * params->n, params->n);
+      }
+    }
+  }
+  memcpy(root, stack, params->n);
+  HASH_STATS_LEAVE();
+}
+
+/* The number of nodes of a tree, which tree_nodes computes. */
+#define TREE_NODES(params) ((2ULL << (params)->tree_height) - 1)
+
+/**
+* Computes all nodes of the tree at addr by generating the whole tree. Level
+* l holds 2^(h - l) nodes and starts at node 2^(h + 1) - 2^(h + 1 - l); the
+* root is the last node.
+*/
+static void tree_nodes(const xmss_params *params,
+                       uint8_t *nodes,
+                       const uint8_t *sk_seed,
+                       const uint8_t *pub_seed,
+                       const uint32_t addr[8])
+{
+  uint32_t ots_addr[8] = { 0 };
+  uint32_t ltree_addr[8] = { 0 };
+  uint32_t node_addr[8] = { 0 };
+  uint8_t *level = nodes;
+  uint32_t idx, h;
+  HASH_STATS_ENTER(HASH_STATS_AUTH);
+
+  copy_subtree_addr(ots_addr, addr);
+  set_type(ots_addr, 0);
+  copy_subtree_addr(ltree_addr, addr);
+  set_type(ltree_addr, 1);
+  copy_subtree_addr(node_addr, addr);
+  set_type(node_addr, 2);
+
+  for (idx = 0; idx < 1U << params->tree_height; idx++) {
+    set_ltree_addr(ltree_addr, idx);
+    set_ots_addr(ots_addr, idx);
+    gen_leaf_wots(params, level + idx * params->n, sk_seed, pub_seed, ltree_addr, ots_addr);
+  }
+  for (h = 0; h < params->tree_height; h++) {
+    uint8_t *parents = level + (1U << (params->tree_height - h)) * params->n;
+
+    set_tree_height(node_addr, h);
+    for (idx = 0; idx < 1U << (params->tree_height - h - 1); idx++) {
+      set_tree_index(node_addr, idx);
+      thash_h(params, parents + idx * params->n, level + 2 * idx * params->n, pub_seed, node_addr);
+    }
+    level = parents;
+  }
+  HASH_STATS_LEAVE();
+}
+
+/**
+* Reads the root and the auth path of a leaf from the nodes of a tree.
+*/
+static void nodes_auth_path(const xmss_params *params,
+                            uint8_t *root,
+                            uint8_t *auth,
+                            const uint8_t *nodes,
+                            uint32_t leaf)
+{
+  const uint8_t *level = nodes;
+  uint32_t h;
+
+  for (h = 0; h < params->tree_height; h++) {
+    memcpy(auth + h * params->n, level + ((leaf >> h) ^ 1) * params->n, params->n);
+    level += (1U << (params->tree_height - h)) * params->n;
+  }
+  memcpy(root, level, params->n);
+}
+
+/**
+* Claims the next bottom tree for a thread and prepares everything its
+* signatures need: the BDS state of the bottom tree, the auth path in the
+* tree above, and the parts of the upper layers, which threads share.
+* Returns -1 if no indices are left.
+*/
+static int thread_claim(xmss_thread_signer *t)
+{
+  xmss_concurrent_signer *c = t->shared;
+  const xmss_params *params = &c->params;
+  const uint8_t *sk_seed = t->sk + params->index_bytes;
+  const uint8_t *pub_seed = t->sk + params->index_bytes + 3 * params->n;
+  uint32_t mask = (1 << params->tree_height) - 1;
+  uint64_t start, end, l;
+  uint8_t root[params->n];
+  uint8_t ots_seed[params->n];
+  uint32_t addr[8] = { 0 };
+  uint32_t ots_addr[8] = { 0 };
+  uint32_t i;
+  uint8_t *entry;
+  size_t entry_bytes = params->tree_height * params->n + params->wots_sig_bytes + params->n;
+
+  t->claimed = 0;
+  t->tree = atomic_fetch_add(&c->next_tree, 1);
+  start = t->tree << params->tree_height;
+  end = start + (1ULL << params->tree_height);
+  if (start >= c->limit) {
+    return -1;
+  }
+  if (start < c->first) {
+    start = c->first;
+  }
+  if (end > c->limit) {
+    end = c->limit;
+  }
+
+  /* Mark the tree as used in the caller's key before signing with it. */
+  pthread_mutex_lock(&c->lock);
+  if (bytes_to_ull(c->sk, params->index_bytes) < end) {
+    ull_to_bytes(c->sk, params->index_bytes, end);
+  }
+  pthread_mutex_unlock(&c->lock);
+
+  ull_to_bytes(t->sk, params->index_bytes, start);
+  ull_to_bytes(index_limit(params, t->sk), params->index_bytes, end);
+
+  t->states[0].stackoffset = 0;
+  set_layer_addr(addr, 0);
+  set_tree_addr(addr, t->tree);
+  treehash_init(params, root, params->tree_height, 0, &t->states[0], sk_seed, pub_seed, addr);
+  for (l = 0; l < (start & mask); l++) {
+    bds_round(params, &t->states[0], l, sk_seed, pub_seed, addr);
+    bds_treehash_update(params, &t->states[0], (params->tree_height - params->bds_k) >> 1, sk_seed, pub_seed, addr);
+  }
+
+  for (i = 1; i < params->d; i++) {
+    uint64_t key = t->tree >> ((i - 1) * params->tree_height);
+
+    if (i > 1) {
+      entry = c->cache + (i - 2) * entry_bytes;
+      pthread_mutex_lock(&c->lock);
+      if (c->cache_key[i - 2] == key) {
+        memcpy(t->states[i].auth, entry, params->tree_height * params->n);
+        memcpy(t->wots_sigs + (i - 1) * params->wots_sig_bytes, entry + params->tree_height * params->n, params->wots_sig_bytes);
+        memcpy(root, entry + params->tree_height * params->n + params->wots_sig_bytes, params->n);
+        pthread_mutex_unlock(&c->lock);
+        continue;
+      }
+      pthread_mutex_unlock(&c->lock);
+    }
+
+    /* On a miss, the thread computes the layer into its own buffers without
+    the lock and publishes it afterwards; threads that miss on the same tree
+    at once each compute it. */
+    // the tree above holds the root computed so far at leaf key & mask
+    set_layer_addr(ots_addr, i);
+    set_tree_addr(ots_addr, key >> params->tree_height);
+    set_ots_addr(ots_addr, key & mask);
+    get_seed(params, ots_seed, sk_seed, ots_addr);
+    wots_sign(params, t->wots_sigs + (i - 1) * params->wots_sig_bytes, root, ots_seed, pub_seed, ots_addr);
+
+    set_layer_addr(addr, i);
+    set_tree_addr(addr, key >> params->tree_height);
+
+    /* Consecutive bottom trees hang off the same layer-1 tree, whose nodes
+    are kept; a claim in that tree only reads its auth path. On a miss,
+    the tree is computed into the buffer of the thread, which is swapped
+    with the cached one. */
+    if (i == 1) {
+      int hit;
+
+      pthread_mutex_lock(&c->lock);
+      hit = c->nodes_key == key >> params->tree_height;
+      if (hit) {
+        nodes_auth_path(params, root, t->states[1].auth, c->nodes, key & mask);
+      }
+      pthread_mutex_unlock(&c->lock);
+      if (!hit) {
+        tree_nodes(params, t->nodes, sk_seed, pub_seed, addr);
+        nodes_auth_path(params, root, t->states[1].auth, t->nodes, key & mask);
+
+        pthread_mutex_lock(&c->lock);
+        if (c->nodes_key != key >> params->tree_height) {
+          uint8_t *nodes = c->nodes;
+
+          c->nodes = t->nodes;
+          t->nodes = nodes;
+          c->nodes_key = key >> params->tree_height;
+        }
+        pthread_mutex_unlock(&c->lock);
+      }
+      continue;
+    }
+    tree_auth_path(params, root, t->states[i].auth, key & mask, sk_seed, pub_seed, addr);
+
+    if (i > 1) {
+      pthread_mutex_lock(&c->lock);
+      memcpy(entry, t->states[i].auth, params->tree_height * params->n);
+      memcpy(entry + params->tree_height * params->n, t->wots_sigs + (i - 1) * params->wots_sig_bytes, params->wots_sig_bytes);
+      memcpy(entry + params->tree_height * params->n + params->wots_sig_bytes, root, params->n);
+      c->cache_key[i - 2] = key;
+      pthread_mutex_unlock(&c->lock);
+    }
+  }
+
+  t->claimed = 1;
+  return 0;
+}
+
+/**
+* Creates a signer that several threads can use at the same time. For XMSSMT,
+* every thread claims whole bottom trees with an atomic counter and signs
+* with their indices on its own, so threads only synchronize once per tree.
+* The nodes of the layer-1 tree that the bottom trees hang off are shared,
+* which takes 2^(h/d + 1) - 1 nodes in the signer and in every thread.
+* Indices in a claimed tree that a thread does not use are given up. For
+* XMSS, which has a single tree, the threads share one signer, but only take
+* turns to claim an index and advance its BDS state; message hashing,
+* grinding and WOTS signing run in parallel on a copy of the auth path.
+*/
+int xmss_core_concurrent_init(const xmss_params *params,
+                              xmss_concurrent_signer **signer,
+                              uint8_t *sk)
+{
+  xmss_concurrent_signer *c = malloc(sizeof(xmss_concurrent_signer));
+  size_t entry_bytes = params->tree_height * params->n + params->wots_sig_bytes + params->n;
+  uint32_t i;
+
+  if (c == NULL) {
+    return -1;
+  }
+  c->params = *params;
+  c->sk = sk;
+  c->first = bytes_to_ull(sk, params->index_bytes);
+  c->limit = bytes_to_ull(index_limit(params, sk), params->index_bytes);
+  atomic_init(&c->next_tree, c->first >> params->tree_height);
+  c->cache_key = NULL;
+  c->cache = NULL;
+  c->nodes_key = UINT64_MAX;
+  c->nodes = NULL;
+  c->serial = NULL;
+  pthread_mutex_init(&c->lock, NULL);
+
+  if (params->d == 1) {
+    if (xmss_core_signer_init(params, &c->serial, sk)) {
+      goto fail;
+    }
+  }
+  else if ((c->nodes = malloc(TREE_NODES(params) * params->n)) == NULL) {
+    goto fail;
+  }
+  if (params->d > 2) {
+    c->cache_key = malloc((params->d - 2) * sizeof(uint64_t));
+    c->cache = malloc((params->d - 2) * entry_bytes);
+    if (c->cache_key == NULL || c->cache == NULL) {
+      goto fail;
+    }
+    for (i = 0; i < params->d - 2; i++) {
+      c->cache_key[i] = UINT64_MAX;
+    }
+  }
+
+  *signer = c;
+  return 0;
+
+fail:
+  free(c->cache_key);
+  free(c->cache);
+  free(c->nodes);
+  pthread_mutex_destroy(&c->lock);
+  free(c);
+  return -1;
+}
+
+/**
+* Creates the handle through which one thread signs with a concurrent signer.
+*/
+int xmss_core_concurrent_attach(xmss_concurrent_signer *signer,
+                                xmss_thread_signer **thread)
+{
+  const xmss_params *params = &signer->params;
+  uint32_t instances = params->tree_height - params->bds_k;
+  xmss_thread_signer *t = calloc(1, sizeof(xmss_thread_signer));
+
+  if (t == NULL) {
+    return -1;
+  }
+  t->shared = signer;
+  if (params->d == 1) {
+    t->sk = malloc(params->sk_bytes);
+    t->auth = malloc(params->tree_height * params->n);
+    if (t->sk == NULL || t->auth == NULL) {
+      xmss_core_concurrent_detach(t);
+      return -1;
+    }
+    /* The seeds, root and limit of the key; the index is set per signature. */
+    memset(t->sk, 0, params->index_bytes);
+    memcpy(t->sk + params->index_bytes, signer->sk + params->index_bytes, params->sk_bytes - params->index_bytes);
+  }
+  else {
+    t->sk = malloc(params->sk_bytes);
+    t->states = malloc((2 * params->d - 1) * sizeof(bds_state));
+    t->next_idx = malloc(((2 * params->d - 1) * instances + 1) * sizeof(uint32_t));
+    t->low = malloc((2 * params->d - 1) * instances + 1);
+    t->nodes = malloc(TREE_NODES(params) * params->n);
+    if (t->sk == NULL || t->states == NULL || t->next_idx == NULL || t->low == NULL || t->nodes == NULL) {
+      xmss_core_concurrent_detach(t);
+      return -1;
+    }
+    /* Only the seeds of the key are needed; the states are built per tree. */
+    memset(t->sk, 0, params->sk_bytes);
+    memcpy(t->sk + params->index_bytes, signer->sk + params->index_bytes, 4 * params->n);
+    treehash_attach(params, t->states, 2 * params->d - 1, t->next_idx, t->low);
+    xmssmt_deserialize_state(params, t->states, &t->wots_sigs, t->sk);
+  }
+
+  *thread = t;
+  return 0;
+}
+
+/**
+* Signs a message with the handle of the calling thread. Returns -1 once all
+* indices of the key have been handed out.
+*/
+int xmss_core_concurrent_sign(xmss_thread_signer *t,
+                              uint8_t *sm,
+                              uint64_t *smlen,
+                              const uint8_t *m,
+                              uint64_t mlen)
+{
+  xmss_concurrent_signer *c = t->shared;
+  const xmss_params *params = &c->params;
+  uint32_t addr[8] = { 0 };
+  uint64_t idx;
+  uint32_t leaf;
+
+  if (params->d == 1) {
+    xmss_signer *s = c->serial;
+    bds_state state;
+    unsigned long used;
+
+    if (!message_signable(params, mlen)) {
+      return -1;
+    }
+    pthread_mutex_lock(&c->lock);
+    idx = bytes_to_ull(s->work, params->index_bytes);
+    if (idx >= c->limit) {
+      pthread_mutex_unlock(&c->lock);
+      return -1;
+    }
+    memcpy(t->auth, s->states[0].auth, params->tree_height * params->n);
+    ull_to_bytes(s->work, params->index_bytes, idx + 1);
+    memcpy(c->sk, s->work, params->index_bytes);
+    signer_advance(s, idx);
+    pthread_mutex_unlock(&c->lock);
+
+    ull_to_bytes(t->sk, params->index_bytes, idx);
+    state.auth = t->auth;
+    return xmss_sign_leaf(params, t->sk, &state, &used, sm, smlen, m, mlen);
+  }
+
+  /* Signing fails at the end of the claimed tree; then claim the next one. */
+  while (!t->claimed || xmssmt_sign_leaf(params, t->sk, t->states, t->wots_sigs, &idx, sm, smlen, m, mlen)) {
+    if (thread_claim(t)) {
+      return -1;
+    }
+  }
+
+  leaf = idx & ((1 << params->tree_height) - 1);
+  if (leaf < (1U << params->tree_height) - 1) {
+    set_tree_addr(addr, t->tree);
+    bds_round(params, &t->states[0], leaf, t->sk + params->index_bytes, t->sk + params->index_bytes + 3 * params->n, addr);
+    bds_treehash_update(params, &t->states[0], (params->tree_height - params->bds_k) >> 1, t->sk + params->index_bytes, t->sk + params->index_bytes + 3 * params->n, addr);
+  }
+
+  return 0;
+}
+
+/**
+* Releases the handle of a thread. The rest of its claimed tree is given up.
+*/
+void xmss_core_concurrent_detach(xmss_thread_signer *t)
+{
+  free(t->sk);
+  free(t->auth);
+  free(t->states);
+  free(t->next_idx);
+  free(t->low);
+  free(t->nodes);
+  free(t);
+}
+
+/**
+* Releases a concurrent signer once all threads have detached. For XMSSMT,
+* the BDS state in sk is rebuilt for the first index that was not claimed,
+* so that sk can be used as an ordinary secret key again.
+*/
+int xmss_core_concurrent_free(xmss_concurrent_signer *c)
+{
+  const xmss_params *params = &c->params;
+  uint64_t idx = bytes_to_ull(c->sk, params->index_bytes);
+  int ret = 0;
+
+  if (params->d == 1) {
+    xmss_core_signer_free(c->serial);
+  }
+  else if (idx > c->first && idx < c->limit) {
+    ret = xmssmt_build_state(params, c->sk, idx);
+  }
+  free(c->cache_key);
+  free(c->cache);
+  free(c->nodes);
+  pthread_mutex_destroy(&c->lock);
+  free(c);
+  return ret;
+}
@@ -0,0 +1,249 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "params.h"
+#include "utils.h"
+#include "xmss_core.h"
+#include "xmss_file.h"
+
+/* The header holds the 64-bit high-water mark and the active copy of sk. */
+#define XMSS_FILE_HEADER_BYTES 9
+
+struct xmss_file_signer {
+    xmss_params params;
+    int fd;
+    uint8_t *map;
+    size_t maplen;
+    uint64_t hwm;
+    uint32_t reserve;
+    uint8_t *sk;            /* private sk (without OID) used by the signer */
+    xmss_signer *signer;
+};
+
+typedef int (*parse_oid_fn)(xmss_params *params, const uint32_t oid);
+
+static uint32_t sk_oid(const uint8_t *sk)
+{
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= sk[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    return oid;
+}
+
+/**
+ * Flushes the given range of the mapping to disk. msync needs a page-aligned
+ * address, so the range is extended to the start of its first page.
+ */
+static int file_sync(const xmss_file_signer *f, size_t offset, size_t len)
+{
+    size_t start = offset & ~((size_t)sysconf(_SC_PAGESIZE) - 1);
+
+    return msync(f->map + start, offset - start + len, MS_SYNC);
+}
+
+/**
+ * Writes the signer state into the inactive copy of sk and then makes that
+ * copy the active one, together with the given high-water mark.
+ */
+static int file_write_state(xmss_file_signer *f, uint64_t hwm)
+{
+    size_t copy_bytes = XMSS_OID_LEN + f->params.sk_bytes;
+    uint8_t active = f->map[8] & 1;
+    size_t offset = XMSS_FILE_HEADER_BYTES + (active ^ 1) * copy_bytes;
+
+    xmss_core_signer_checkpoint(f->signer);
+    memcpy(f->map + offset + XMSS_OID_LEN, f->sk, f->params.sk_bytes);
+    if (file_sync(f, offset, copy_bytes)) {
+        return -1;
+    }
+    ull_to_bytes(f->map, 8, hwm);
+    f->map[8] = active ^ 1;
+    if (file_sync(f, 0, XMSS_FILE_HEADER_BYTES)) {
+        return -1;
+    }
+    f->hwm = hwm;
+    return 0;
+}
+
+static int file_create(const char *path, const uint8_t *sk, parse_oid_fn parse)
+{
+    xmss_params params;
+    uint8_t header[XMSS_FILE_HEADER_BYTES];
+    int fd, ret = 0;
+
+    if (parse(&params, sk_oid(sk))) {
+        return -1;
+    }
+    ull_to_bytes(header, 8, bytes_to_ull(sk + XMSS_OID_LEN, params.index_bytes));
+    header[8] = 0;
+
+    fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        return -1;
+    }
+    if (write(fd, header, XMSS_FILE_HEADER_BYTES) != XMSS_FILE_HEADER_BYTES
+        || write(fd, sk, XMSS_OID_LEN + params.sk_bytes) != (ssize_t)(XMSS_OID_LEN + params.sk_bytes)
+        || write(fd, sk, XMSS_OID_LEN + params.sk_bytes) != (ssize_t)(XMSS_OID_LEN + params.sk_bytes)
+        || fsync(fd)) {
+        ret = -1;
+    }
+    close(fd);
+    return ret;
+}
+
+static int file_open(xmss_file_signer **signer,
+                     const char *path,
+                     uint32_t reserve,
+                     parse_oid_fn parse)
+{
+    xmss_file_signer *f;
+    struct stat st;
+    const uint8_t *copy;
+    uint64_t idx, limit;
+
+    if (reserve == 0) {
+        return -1;
+    }
+    f = calloc(1, sizeof(xmss_file_signer));
+    if (f == NULL) {
+        return -1;
+    }
+    f->reserve = reserve;
+    f->map = MAP_FAILED;
+    f->fd = open(path, O_RDWR);
+    /* Two signers on one file would hand out the same indices, so the file
+    stays locked until it is closed; a file that is locked already fails. */
+    if (f->fd < 0 || flock(f->fd, LOCK_EX | LOCK_NB)
+        || fstat(f->fd, &st) || st.st_size < XMSS_FILE_HEADER_BYTES + XMSS_OID_LEN) {
+        goto fail;
+    }
+    f->maplen = st.st_size;
+    f->map = mmap(NULL, f->maplen, PROT_READ | PROT_WRITE, MAP_SHARED, f->fd, 0);
+    if (f->map == MAP_FAILED
+        || parse(&f->params, sk_oid(f->map + XMSS_FILE_HEADER_BYTES))
+        || f->maplen != XMSS_FILE_HEADER_BYTES + 2 * (XMSS_OID_LEN + f->params.sk_bytes)) {
+        goto fail;
+    }
+
+    /* Both copies carry the same OID, so the parameters hold for either. */
+    f->hwm = bytes_to_ull(f->map, 8);
+    copy = f->map + XMSS_FILE_HEADER_BYTES
+           + (f->map[8] & 1) * (XMSS_OID_LEN + f->params.sk_bytes) + XMSS_OID_LEN;
+    idx = bytes_to_ull(copy, f->params.index_bytes);
+    limit = xmss_core_index_limit(&f->params, copy);
+    if (idx > f->hwm || idx > limit) {
+        goto fail;
+    }
+    /* A reservation never reaches past the limit, but files written before
+    that was so may hold one that does; the key is exhausted either way. */
+    if (f->hwm > limit) {
+        f->hwm = limit;
+    }
+
+    f->sk = malloc(f->params.sk_bytes);
+    if (f->sk == NULL) {
+        goto fail;
+    }
+    memcpy(f->sk, copy, f->params.sk_bytes);
+    if (xmss_core_signer_init(&f->params, &f->signer, f->sk)) {
+        goto fail;
+    }
+    /* Indices between the stored state and hwm may have been used before a
+    crash; they are skipped, never reused. */
+    if (xmss_core_signer_skip(f->signer, f->hwm)) {
+        goto fail;
+    }
+
+    *signer = f;
+    return 0;
+
+fail:
+    if (f->signer != NULL) {
+        xmss_core_signer_free(f->signer);
+    }
+    free(f->sk);
+    if (f->map != MAP_FAILED) {
+        munmap(f->map, f->maplen);
+    }
+    if (f->fd >= 0) {
+        close(f->fd);
+    }
+    free(f);
+    return -1;
+}
+
+int xmss_file_create(const char *path, const uint8_t *sk)
+{
+    return file_create(path, sk, xmss_parse_oid);
+}
+
+int xmssmt_file_create(const char *path, const uint8_t *sk)
+{
+    return file_create(path, sk, xmssmt_parse_oid);
+}
+
+int xmss_file_open(xmss_file_signer **signer,
+                   const char *path,
+                   uint32_t reserve)
+{
+    return file_open(signer, path, reserve, xmss_parse_oid);
+}
+
+int xmssmt_file_open(xmss_file_signer **signer,
+                     const char *path,
+                     uint32_t reserve)
+{
+    return file_open(signer, path, reserve, xmssmt_parse_oid);
+}
+
+int xmss_file_sign(xmss_file_signer *f,
+                   uint8_t *sm,
+                   uint64_t *smlen,
+                   const uint8_t *m,
+                   uint64_t mlen)
+{
+    uint64_t idx = bytes_to_ull(f->sk, f->params.index_bytes);
+    uint64_t max = xmss_core_index_limit(&f->params, f->sk);
+
+    if (idx >= max) {
+        return -1;
+    }
+    if (idx >= f->hwm) {
+        /* Persist the reservation before any of its indices is used. */
+        uint64_t hwm = (max - idx > f->reserve) ? idx + f->reserve : max;
+
+        ull_to_bytes(f->map, 8, hwm);
+        if (file_sync(f, 0, 8)) {
+            return -1;
+        }
+        f->hwm = hwm;
+    }
+    return xmss_core_signer_sign(f->signer, sm, smlen, m, mlen);
+}
+
+int xmss_file_checkpoint(xmss_file_signer *f)
+{
+    return file_write_state(f, f->hwm);
+}
+
+int xmss_file_close(xmss_file_signer *f)
+{
+    /* The stored state is at the next unused index, so hwm can drop to it. */
+    int ret = file_write_state(f, bytes_to_ull(f->sk, f->params.index_bytes));
+
+    xmss_core_signer_free(f->signer);
+    free(f->sk);
+    munmap(f->map, f->maplen);
+    close(f->fd);
+    free(f);
+    return ret;
+}
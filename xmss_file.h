@@ -0,0 +1,71 @@
+#ifndef XMSS_FILE_H
+#define XMSS_FILE_H
+
+#include <stdint.h>
+
+/* A state file holds a secret key in a form that survives crashes without
+ever reusing an index. Its layout is
+
+    [(64bit) hwm || (8bit) active || OID || sk || OID || sk]
+
+where hwm is the high-water mark: no index at or above it has been used.
+Indices are reserved in ranges by raising hwm, which costs one msync per
+range rather than one per signature. The two copies of sk are written
+alternately; active tells which one is complete. Its index may lag behind
+hwm, in which case the BDS state is moved forward to hwm when opening the
+file, and the indices in between are given up. */
+
+typedef struct xmss_file_signer xmss_file_signer;
+
+/**
+ * Creates a state file at path for an XMSS secret key (including OID).
+ */
+int xmss_file_create(const char *path, const uint8_t *sk);
+
+/**
+ * Creates a state file at path for an XMSSMT secret key (including OID).
+ */
+int xmssmt_file_create(const char *path, const uint8_t *sk);
+
+/**
+ * Opens the state file of an XMSS secret key for signing. Every reservation
+ * hands out reserve indices; the unused part of the last reservation is lost
+ * if the process does not call xmss_file_close. The file is locked until it
+ * is closed; opening a file that is open already fails. Reservations end at
+ * the index limit of the key, e.g. of a shard made by xmss_split; a key that
+ * has reached it opens, but does not sign.
+ */
+int xmss_file_open(xmss_file_signer **signer,
+                   const char *path,
+                   uint32_t reserve);
+
+/**
+ * Opens the state file of an XMSSMT secret key for signing.
+ */
+int xmssmt_file_open(xmss_file_signer **signer,
+                     const char *path,
+                     uint32_t reserve);
+
+/**
+ * Signs a message, reserving a new range of indices first if needed.
+ * Returns an array containing the signature followed by the message, or -1
+ * if the key is exhausted or the reservation could not be persisted.
+ */
+int xmss_file_sign(xmss_file_signer *signer,
+                   uint8_t *sm,
+                   uint64_t *smlen,
+                   const uint8_t *m,
+                   uint64_t mlen);
+
+/**
+ * Writes the current BDS state into the file. This bounds the work that
+ * opening the file has to redo after a crash.
+ */
+int xmss_file_checkpoint(xmss_file_signer *signer);
+
+/**
+ * Checkpoints the file, returns the unused reserved indices and closes it.
+ */
+int xmss_file_close(xmss_file_signer *signer);
+
+#endif
@@ -0,0 +1,273 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "params.h"
+#include "hash.h"
+#include "utils.h"
+#include "wots.h"
+#include "xmss_core.h"
+
+/* Include space for the additional counter. */
+#define XMSS_MLEN (32+8)
+
+#define XMSS_VARIANT "XMSS-SHA2_10_256"
+#define XMSS_SIGNATURES 1024
+#define XMSS_BIN_WIDTH 8
+
+#if !ORIG
+extern _Thread_local uint64_t besti;
+#endif
+
+/* The verification chain steps of the signatures of one budget, with the
+ * counter that signing chose and with counter 0, i.e. without grinding. */
+typedef struct {
+    uint32_t *ground;
+    uint32_t *plain;
+    uint64_t count;
+} steps;
+
+static int json;
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Returns the smallest of the sorted values that at least p percent of them
+ * do not exceed. */
+static uint32_t percentile(const uint32_t *v, uint64_t count, uint32_t p)
+{
+    uint64_t i = (count * p + 99) / 100;
+
+    return v[i > 0 ? i - 1 : 0];
+}
+
+/* The chain steps verification takes for a message hash: the chains that
+ * start at lengths[i] run the remaining w - 1 - lengths[i] steps. */
+static uint32_t verify_steps(const xmss_params *params, const uint8_t *msg_h)
+{
+    return params->wots_len * (params->wots_w - 1)
+           - wots_getlengths2(params, msg_h);
+}
+
+/* Prints the summary and the histogram of one distribution; v is sorted. */
+static void report_dist(const char *name, const uint32_t *v, uint64_t count,
+                        uint32_t max_steps, uint32_t bin_width)
+{
+    uint32_t bins = max_steps / bin_width + 1;
+    uint64_t hist[bins];
+    uint64_t i, sum = 0;
+    uint32_t b, first = bins, last = 0;
+
+    memset(hist, 0, sizeof(hist));
+    for (i = 0; i < count; i++) {
+        sum += v[i];
+        hist[v[i] / bin_width]++;
+    }
+    for (b = 0; b < bins; b++) {
+        if (hist[b] != 0) {
+            first = b < first ? b : first;
+            last = b;
+        }
+    }
+
+    if (json) {
+        printf("\"%s\": {\"mean\": %.2f, \"min\": %u, \"median\": %u, "
+               "\"p99\": %u, \"max\": %u, \"histogram_from\": %u, "
+               "\"histogram\": [",
+               name, (double)sum / count, v[0], percentile(v, count, 50),
+               percentile(v, count, 99), v[count - 1], first * bin_width);
+        for (b = first; b <= last; b++) {
+            printf("%s%llu", b > first ? ", " : "", (unsigned long long)hist[b]);
+        }
+        printf("]}");
+        return;
+    }
+    printf("  %-8s mean %8.2f  min %5u  median %5u  p99 %5u  max %5u\n",
+           name, (double)sum / count, v[0], percentile(v, count, 50),
+           percentile(v, count, 99), v[count - 1]);
+    for (b = first; b <= last; b++) {
+        printf("    %5u-%-5u %8llu\n", b * bin_width, (b + 1) * bin_width - 1,
+               (unsigned long long)hist[b]);
+    }
+}
+
+#if !ORIG
+/*
+ * Signs signatures messages with the given grinding budget and records, for
+ * every signature, the chain steps of verification with the counter that
+ * signing chose and with counter 0. Keys are generated as they run out.
+ */
+static int collect(xmss_params *params, int grind_bits, steps *s,
+                   uint64_t signatures)
+{
+    uint8_t m[XMSS_MLEN];
+    uint8_t *pk = malloc(params->pk_bytes);
+    uint8_t *sk = malloc(params->sk_bytes);
+    uint8_t *sm = malloc(params->sig_bytes + XMSS_MLEN);
+    uint8_t msg_h[XMSS_MAX_N];
+    hash_message_ctx h;
+    uint64_t smlen, idx, i, j;
+    int ret = 0;
+
+    xmss_set_grind_bits(params, grind_bits);
+    s->count = 0;
+    for (i = 0; i < signatures && ret == 0; i++) {
+        if (i % (1ULL << params->full_height) == 0) {
+            xmss_core_keypair(params, pk, sk);
+        }
+        /* The counter takes the place of the last 8 bytes. */
+        for (j = 0; j < XMSS_MLEN - 8; j++) m[j] = (uint8_t)(i + j);
+        for (j = XMSS_MLEN - 8; j < XMSS_MLEN; j++) m[j] = 0;
+
+        if (xmss_core_sign(params, sk, sm, &smlen, m, XMSS_MLEN)) {
+            ret = -1;
+            break;
+        }
+        /* Redo the message hash from R and the index in the signature. */
+        idx = bytes_to_ull(sm, params->index_bytes);
+        if (hash_message_init(params, &h, sm + params->index_bytes, pk, idx)) {
+            ret = -1;
+            break;
+        }
+        hash_message_update(&h, m, XMSS_MLEN);
+
+        hash_message_final_counter(msg_h, &h, besti);
+        s->ground[s->count] = verify_steps(params, msg_h);
+        hash_message_final_counter(msg_h, &h, 0);
+        s->plain[s->count] = verify_steps(params, msg_h);
+        if (s->ground[s->count] > s->plain[s->count]) {
+            fprintf(stderr, "Grinding made signature %llu more expensive\n",
+                    (unsigned long long)i);
+            ret = -1;
+        }
+        s->count++;
+    }
+
+    free(pk);
+    free(sk);
+    free(sm);
+    return ret;
+}
+#endif
+
+/*
+ * Shows how well COUNTER grinding lowers the cost of verification: for every
+ * grinding budget, signs messages and reports the distribution of the WOTS
+ * chain steps that verification hashes (wots_len * (w - 1) minus the sum of
+ * the chain lengths), both with the chosen counter and with counter 0, which
+ * is what the signature would cost without grinding.
+ *
+ * Usage: xmss_grind_stats [-j] [-n signatures] [-b bin width]
+ *                         [-g bits,bits,...] [variant], e.g.
+ *   xmss_grind_stats -n 4096 -g 0,8,12,16 XMSS-SHA2_10_256
+ * -j writes JSON instead of a table. XMSSMT does not grind, so only XMSS
+ * parameter sets are accepted.
+ */
+int main(int argc, char **argv)
+{
+    const char *variant = XMSS_VARIANT;
+    uint64_t signatures = XMSS_SIGNATURES;
+    uint32_t bin_width = XMSS_BIN_WIDTH;
+    int budgets[32] = { 0, 4, 8, 10, 12 };
+    uint32_t nbudgets = 5;
+    xmss_params params;
+    uint32_t oid, max_steps, b;
+    steps s;
+    int argi, ret = 0;
+
+    for (argi = 1; argi < argc && argv[argi][0] == '-'; argi++) {
+        if (!strcmp(argv[argi], "-j")) {
+            json = 1;
+        }
+        else if (!strcmp(argv[argi], "-n") && argi + 1 < argc) {
+            signatures = strtoull(argv[++argi], NULL, 10);
+        }
+        else if (!strcmp(argv[argi], "-b") && argi + 1 < argc) {
+            bin_width = (uint32_t)strtoul(argv[++argi], NULL, 10);
+        }
+        else if (!strcmp(argv[argi], "-g") && argi + 1 < argc) {
+            char *p = argv[++argi];
+
+            for (nbudgets = 0; nbudgets < 32 && *p; nbudgets++) {
+                budgets[nbudgets] = (int)strtoul(p, &p, 10);
+                if (budgets[nbudgets] > 32) {
+                    fprintf(stderr, "Grinding budgets go up to 32 bits\n");
+                    return -1;
+                }
+                if (*p == ',') p++;
+            }
+        }
+        else {
+            fprintf(stderr, "Usage: %s [-j] [-n signatures] [-b bin width] "
+                    "[-g bits,bits,...] [variant]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (argi < argc) {
+        variant = argv[argi];
+    }
+    if (signatures == 0 || bin_width == 0 || nbudgets == 0) {
+        fprintf(stderr, "Nothing to measure\n");
+        return -1;
+    }
+#if ORIG
+    fprintf(stderr, "Grinding needs COUNTER; this build has ORIG set\n");
+    return -1;
+#endif
+    if (strncmp(variant, "XMSSMT", 6) == 0 ||
+        xmss_str_to_oid(&oid, variant) || xmss_parse_oid(&params, oid)) {
+        fprintf(stderr, "Unknown XMSS parameter set %s\n", variant);
+        return -1;
+    }
+    max_steps = params.wots_len * (params.wots_w - 1);
+
+    s.ground = malloc(signatures * sizeof(uint32_t));
+    s.plain = malloc(signatures * sizeof(uint32_t));
+
+    if (json) {
+        printf("{\n  \"variant\": \"%s\", \"signatures\": %llu, "
+               "\"max_steps\": %u, \"bin_width\": %u,\n  \"budgets\": [",
+               variant, (unsigned long long)signatures, max_steps, bin_width);
+    }
+    else {
+        printf("%s, %llu signatures per budget, chain steps of verification "
+               "(at most %u)\n", variant, (unsigned long long)signatures,
+               max_steps);
+    }
+
+    for (b = 0; b < nbudgets && ret == 0; b++) {
+#if !ORIG
+        if (collect(&params, budgets[b], &s, signatures)) {
+            ret = -1;
+            break;
+        }
+#endif
+        qsort(s.ground, s.count, sizeof(uint32_t), cmp_u32);
+        qsort(s.plain, s.count, sizeof(uint32_t), cmp_u32);
+
+        if (json) {
+            printf("%s\n    {\"grind_bits\": %d, ", b ? "," : "", budgets[b]);
+            report_dist("ground", s.ground, s.count, max_steps, bin_width);
+            printf(", ");
+            report_dist("plain", s.plain, s.count, max_steps, bin_width);
+            printf("}");
+        }
+        else {
+            printf("grinding %d bits\n", budgets[b]);
+            report_dist("ground", s.ground, s.count, max_steps, bin_width);
+            report_dist("plain", s.plain, s.count, max_steps, bin_width);
+        }
+    }
+    if (json) {
+        printf("\n  ]\n}\n");
+    }
+
+    free(s.ground);
+    free(s.plain);
+    return ret;
+}
@@ -0,0 +1,345 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+#include "hash_address.h"
+#include "params.h"
+#include "utils.h"
+#include "xmss_core.h"
+#include "xmss_merkle.h"
+
+/* A proof starts with the 32-bit position and the 8-bit tree height. */
+#define XMSS_MERKLE_PROOF_HEADER_BYTES 5
+
+typedef int (*parse_oid_fn)(xmss_params *params, const uint32_t oid);
+
+typedef int (*core_sign_fn)(const xmss_params *params,
+                            uint8_t *sk,
+                            uint8_t *sm,
+                            uint64_t *smlen,
+                            const uint8_t *m,
+                            uint64_t mlen);
+
+typedef int (*core_open_fn)(const xmss_params *params,
+                            uint8_t *m,
+                            uint64_t *mlen,
+                            const uint8_t *sm,
+                            uint64_t smlen,
+                            const uint8_t *pk);
+
+static uint32_t key_oid(const uint8_t *key)
+{
+    uint32_t oid = 0;
+    unsigned int i;
+
+    for (i = 0; i < XMSS_OID_LEN; i++) {
+        oid |= key[XMSS_OID_LEN - i - 1] << (i * 8);
+    }
+    return oid;
+}
+
+static uint32_t merkle_height(uint32_t count)
+{
+    uint32_t height = 0;
+
+    while (height < 32 && (1ULL << height) < count) {
+        height++;
+    }
+    return height;
+}
+
+uint64_t xmss_merkle_proof_bytes(const xmss_params *params, uint32_t count)
+{
+    return XMSS_MERKLE_PROOF_HEADER_BYTES
+           + (uint64_t)merkle_height(count) * params->n;
+}
+
+/**
+ * Computes the tree over the batch of messages and writes its root and the
+ * proofs of all messages. Only the nodes that have a message below them are
+ * hashed; all others are zero.
+ */
+static int merkle_tree(const xmss_params *params,
+                       uint8_t *root,
+                       uint8_t *proofs,
+                       const uint8_t *pub_seed,
+                       uint64_t idx,
+                       const uint8_t **m,
+                       const uint64_t *mlen,
+                       uint32_t count)
+{
+    uint32_t height = merkle_height(count);
+    uint64_t proof_bytes = xmss_merkle_proof_bytes(params, count);
+    uint32_t addr[8] = {0};
+    uint64_t width, last, i;
+    uint32_t h;
+    uint8_t *nodes;
+
+    /* Room for the leaves, plus a zero sibling for an odd last leaf. */
+    nodes = calloc(count + 1, params->n);
+    if (nodes == NULL) {
+        return -1;
+    }
+    for (i = 0; i < count; i++) {
+        if (hash_batch_message(params, nodes + i * params->n, pub_seed,
+                               idx, i, m[i], mlen[i])) {
+            free(nodes);
+            return -1;
+        }
+        ull_to_bytes(proofs + i * proof_bytes, 4, i);
+        proofs[i * proof_bytes + 4] = height;
+    }
+
+    set_type(addr, XMSS_ADDR_TYPE_BATCH);
+    set_tree_addr(addr, idx);
+
+    width = count;
+    for (h = 0; h < height; h++) {
+        for (i = 0; i < count; i++) {
+            memcpy(proofs + i * proof_bytes + XMSS_MERKLE_PROOF_HEADER_BYTES + h * params->n,
+                   nodes + ((i >> h) ^ 1) * params->n, params->n);
+        }
+        set_tree_height(addr, h);
+        last = (width - 1) >> 1;
+        for (i = 0; i <= last; i++) {
+            set_tree_index(addr, i);
+            thash_h(params, nodes + i * params->n, nodes + 2 * i * params->n,
+                    pub_seed, addr);
+        }
+        width = last + 1;
+        memset(nodes + width * params->n, 0, params->n);
+    }
+    memcpy(root, nodes, params->n);
+
+    free(nodes);
+    return 0;
+}
+
+/**
+ * Recomputes the root from a message and its proof, and compares it to the
+ * root that was signed.
+ */
+static int merkle_check(const xmss_params *params,
+                        const uint8_t *root,
+                        const uint8_t *pub_seed,
+                        uint64_t idx,
+                        const uint8_t *proof,
+                        const uint8_t *m,
+                        uint64_t mlen)
+{
+    uint32_t pos = bytes_to_ull(proof, 4);
+    uint32_t height = proof[4];
+    const uint8_t *auth_path = proof + XMSS_MERKLE_PROOF_HEADER_BYTES;
+    uint8_t buffer[2 * params->n];
+    uint8_t node[params->n];
+    uint32_t addr[8] = {0};
+    uint32_t h;
+
+    if (height > 32 || (height < 32 && (pos >> height) != 0)) {
+        return -1;
+    }
+    if (hash_batch_message(params, node, pub_seed, idx, pos, m, mlen)) {
+        return -1;
+    }
+
+    set_type(addr, XMSS_ADDR_TYPE_BATCH);
+    set_tree_addr(addr, idx);
+
+    for (h = 0; h < height; h++) {
+        /* Pick the right or left neighbor, depending on parity of the node. */
+        if ((pos >> h) & 1) {
+            memcpy(buffer, auth_path, params->n);
+            memcpy(buffer + params->n, node, params->n);
+        }
+        else {
+            memcpy(buffer, node, params->n);
+            memcpy(buffer + params->n, auth_path, params->n);
+        }
+        auth_path += params->n;
+
+        set_tree_height(addr, h);
+        set_tree_index(addr, pos >> (h + 1));
+        thash_h(params, node, buffer, pub_seed, addr);
+    }
+    return memcmp(node, root, params->n) ? -1 : 0;
+}
+
+static int merkle_sign(uint8_t *sk,
+                       uint8_t *sm,
+                       uint64_t *smlen,
+                       uint8_t *proofs,
+                       const uint8_t **m,
+                       const uint64_t *mlen,
+                       uint32_t count,
+                       parse_oid_fn parse,
+                       core_sign_fn sign)
+{
+    xmss_params params;
+    uint64_t idx;
+
+    if (count == 0 || parse(&params, key_oid(sk))) {
+        return -1;
+    }
+    uint8_t batch[params.n + 8];
+
+    /* The tree is bound to the index that is about to sign its root. */
+    idx = bytes_to_ull(sk + XMSS_OID_LEN, params.index_bytes);
+    if (merkle_tree(&params, batch, proofs, sk + XMSS_OID_LEN + params.index_bytes + 3 * params.n,
+                    idx, m, mlen, count)) {
+        return -1;
+    }
+    memset(batch + params.n, 0, 8);
+    return sign(&params, sk + XMSS_OID_LEN, sm, smlen, batch, params.n + 8);
+}
+
+/**
+ * Verifies the signature over the batch, and returns the signed root and
+ * the index of the signature.
+ */
+static int merkle_open(const xmss_params *params,
+                       uint8_t *root,
+                       uint64_t *idx,
+                       const uint8_t *sm,
+                       uint64_t smlen,
+                       const uint8_t *pk,
+                       core_open_fn open)
+{
+    uint64_t mlen;
+    uint8_t *m;
+    int ret;
+
+    if (smlen != params->sig_bytes + params->n + 8) {
+        return -1;
+    }
+    m = malloc(smlen);
+    if (m == NULL) {
+        return -1;
+    }
+    ret = open(params, m, &mlen, sm, smlen, pk + XMSS_OID_LEN);
+    memcpy(root, sm + params->sig_bytes, params->n);
+    *idx = bytes_to_ull(sm, params->index_bytes);
+    free(m);
+    return ret;
+}
+
+static int merkle_verify(const uint8_t **m,
+                         const uint64_t *mlen,
+                         const uint8_t *proofs,
+                         uint32_t count,
+                         const uint8_t *sm,
+                         uint64_t smlen,
+                         const uint8_t *pk,
+                         parse_oid_fn parse,
+                         core_open_fn open)
+{
+    xmss_params params;
+    uint64_t proof_bytes;
+    uint64_t idx;
+    uint32_t i;
+
+    if (count == 0 || parse(&params, key_oid(pk))) {
+        return -1;
+    }
+    uint8_t root[params.n];
+
+    if (merkle_open(&params, root, &idx, sm, smlen, pk, open)) {
+        return -1;
+    }
+    /* All proofs of a batch have the height of the first one. */
+    proof_bytes = XMSS_MERKLE_PROOF_HEADER_BYTES + (uint64_t)proofs[4] * params.n;
+    for (i = 0; i < count; i++) {
+        if (proofs[i * proof_bytes + 4] != proofs[4]
+            || merkle_check(&params, root, pk + XMSS_OID_LEN + params.n, idx,
+                            proofs + i * proof_bytes, m[i], mlen[i])) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int xmss_merkle_sign(uint8_t *sk,
+                     uint8_t *sm,
+                     uint64_t *smlen,
+                     uint8_t *proofs,
+                     const uint8_t **m,
+                     const uint64_t *mlen,
+                     uint32_t count)
+{
+    return merkle_sign(sk, sm, smlen, proofs, m, mlen, count,
+                       xmss_parse_oid, xmss_core_sign);
+}
+
+int xmssmt_merkle_sign(uint8_t *sk,
+                       uint8_t *sm,
+                       uint64_t *smlen,
+                       uint8_t *proofs,
+                       const uint8_t **m,
+                       const uint64_t *mlen,
+                       uint32_t count)
+{
+    return merkle_sign(sk, sm, smlen, proofs, m, mlen, count,
+                       xmssmt_parse_oid, xmssmt_core_sign);
+}
+
+int xmss_merkle_sign_open(const uint8_t *m,
+                          uint64_t mlen,
+                          const uint8_t *proof,
+                          uint64_t prooflen,
+                          const uint8_t *sm,
+                          uint64_t smlen,
+                          const uint8_t *pk)
+{
+    xmss_params params;
+
+    if (xmss_parse_oid(&params, key_oid(pk))
+        || prooflen < XMSS_MERKLE_PROOF_HEADER_BYTES
+        || prooflen != XMSS_MERKLE_PROOF_HEADER_BYTES + (uint64_t)proof[4] * params.n) {
+        return -1;
+    }
+    return merkle_verify(&m, &mlen, proof, 1, sm, smlen, pk,
+                         xmss_parse_oid, xmss_core_sign_open);
+}
+
+int xmssmt_merkle_sign_open(const uint8_t *m,
+                            uint64_t mlen,
+                            const uint8_t *proof,
+                            uint64_t prooflen,
+                            const uint8_t *sm,
+                            uint64_t smlen,
+                            const uint8_t *pk)
+{
+    xmss_params params;
+
+    if (xmssmt_parse_oid(&params, key_oid(pk))
+        || prooflen < XMSS_MERKLE_PROOF_HEADER_BYTES
+        || prooflen != XMSS_MERKLE_PROOF_HEADER_BYTES + (uint64_t)proof[4] * params.n) {
+        return -1;
+    }
+    return merkle_verify(&m, &mlen, proof, 1, sm, smlen, pk,
+                         xmssmt_parse_oid, xmssmt_core_sign_open);
+}
+
+int xmss_merkle_verify(const uint8_t **m,
+                       const uint64_t *mlen,
+                       const uint8_t *proofs,
+                       uint32_t count,
+                       const uint8_t *sm,
+                       uint64_t smlen,
+                       const uint8_t *pk)
+{
+    return merkle_verify(m, mlen, proofs, count, sm, smlen, pk,
+                         xmss_parse_oid, xmss_core_sign_open);
+}
+
+int xmssmt_merkle_verify(const uint8_t **m,
+                         const uint64_t *mlen,
+                         const uint8_t *proofs,
+                         uint32_t count,
+                         const uint8_t *sm,
+                         uint64_t smlen,
+                         const uint8_t *pk)
+{
+    return merkle_verify(m, mlen, proofs, count, sm, smlen, pk,
+                         xmssmt_parse_oid, xmssmt_core_sign_open);
+}
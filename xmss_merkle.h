@@ -0,0 +1,100 @@
+#ifndef XMSS_MERKLE_H
+#define XMSS_MERKLE_H
+
+#include <stdint.h>
+#include "params.h"
+
+/* Merkle batch signing spends a single index on a whole batch of messages.
+Every message is hashed into a leaf of a binary tree, and only the root of
+that tree is signed. The signature over the batch has the form
+
+    [signature || root || (64bit) 0]
+
+i.e. it is a regular signed message of n + 8 bytes, and every message gets a
+proof of inclusion of the form
+
+    [(32bit) position || (8bit) height || auth path]
+
+The leaves and inner nodes are bound to PUB_SEED and to the index of the
+signature, so trees of different signatures cannot be mixed. When the batch
+does not fill the tree, the missing nodes are all-zero. */
+
+/**
+ * Returns the number of bytes of each proof in a batch of count messages.
+ */
+uint64_t xmss_merkle_proof_bytes(const xmss_params *params, uint32_t count);
+
+/**
+ * Signs a batch of count messages using an XMSS secret key (including OID).
+ * Returns the signature over the batch in sm, of params->sig_bytes + n + 8
+ * bytes, and writes the proofs one after the other into proofs, each of
+ * xmss_merkle_proof_bytes bytes.
+ */
+int xmss_merkle_sign(uint8_t *sk,
+                     uint8_t *sm,
+                     uint64_t *smlen,
+                     uint8_t *proofs,
+                     const uint8_t **m,
+                     const uint64_t *mlen,
+                     uint32_t count);
+
+/**
+ * Signs a batch of count messages using an XMSSMT secret key.
+ */
+int xmssmt_merkle_sign(uint8_t *sk,
+                       uint8_t *sm,
+                       uint64_t *smlen,
+                       uint8_t *proofs,
+                       const uint8_t **m,
+                       const uint64_t *mlen,
+                       uint32_t count);
+
+/**
+ * Verifies a single message of a batch, given the signature over the batch
+ * and the proof of the message, using an XMSS public key (including OID).
+ */
+int xmss_merkle_sign_open(const uint8_t *m,
+                          uint64_t mlen,
+                          const uint8_t *proof,
+                          uint64_t prooflen,
+                          const uint8_t *sm,
+                          uint64_t smlen,
+                          const uint8_t *pk);
+
+/**
+ * Verifies a single message of a batch using an XMSSMT public key.
+ */
+int xmssmt_merkle_sign_open(const uint8_t *m,
+                            uint64_t mlen,
+                            const uint8_t *proof,
+                            uint64_t prooflen,
+                            const uint8_t *sm,
+                            uint64_t smlen,
+                            const uint8_t *pk);
+
+/**
+ * Verifies count messages of a batch at once, with their proofs laid out as
+ * returned by xmss_merkle_sign. The signature over the batch is verified only
+ * once; every message then costs its leaf hash and height calls to thash_h.
+ * Returns -1 if any of the messages does not verify.
+ */
+int xmss_merkle_verify(const uint8_t **m,
+                       const uint64_t *mlen,
+                       const uint8_t *proofs,
+                       uint32_t count,
+                       const uint8_t *sm,
+                       uint64_t smlen,
+                       const uint8_t *pk);
+
+/**
+ * Verifies count messages of a batch at once using an XMSSMT public key.
+ */
+int xmssmt_merkle_verify(const uint8_t **m,
+                         const uint64_t *mlen,
+                         const uint8_t *proofs,
+                         uint32_t count,
+                         const uint8_t *sm,
+                         uint64_t smlen,
+                         const uint8_t *pk);
+
+#endif
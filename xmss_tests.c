@@ -2,9 +2,18 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
 
 #include "xmss.h"
+#include "xmss_file.h"
+#include "xmss_merkle.h"
+#include "xmss_trace.h"
 #include "params.h"
+#include "hash_backend.h"
+#include "xmss_core.h"
+#include "hash.h"
 #include "randombytes.h"
 
 /* Include space for the additional counter. */
@@ -20,9 +29,1262 @@
 #define XMSS_VARIANT "XMSS-SHA2_10_256"
 
 #if COUNTER
-extern uint64_t besti;
+extern _Thread_local uint64_t besti;
 #endif
 
+/* Prints the outcome of one check of the tests below. */
+static int check(int failed, const char *what)
+{
+    if (failed) {
+        printf("  X %s: FAILED!\n", what);
+        return -1;
+    }
+    printf("    %s.\n", what);
+    return 0;
+}
+
+/* Generates a key pair (including OID) of a parameter set into new buffers. */
+static int test_keypair(const char *variant, xmss_params *params,
+                        uint8_t **pk, uint8_t **sk)
+{
+    uint32_t oid;
+    int mt = strncmp(variant, "XMSSMT", 6) == 0;
+
+    if (mt ? xmssmt_str_to_oid(&oid, variant) || xmssmt_parse_oid(params, oid)
+           : xmss_str_to_oid(&oid, variant) || xmss_parse_oid(params, oid)) {
+        return -1;
+    }
+    *pk = malloc(XMSS_OID_LEN + params->pk_bytes);
+    *sk = malloc(XMSS_OID_LEN + params->sk_bytes);
+    return mt ? xmssmt_keypair(*pk, *sk, oid) : xmss_keypair(*pk, *sk, oid);
+}
+
+/* Returns the index that the next signature of sk (including OID) uses. */
+static uint64_t test_index(const xmss_params *params, const uint8_t *sk)
+{
+    uint64_t idx = 0;
+    uint32_t i;
+
+    for (i = 0; i < params->index_bytes; i++) {
+        idx = (idx << 8) | sk[XMSS_OID_LEN + i];
+    }
+    return idx;
+}
+
+/*
+ * Verifies a signed message right after it was made, which COUNTER needs for
+ * XMSS; XMSSMT does not grind. Returns the index of the signature, or -1 if
+ * it does not verify.
+ */
+static int64_t test_open(const xmss_params *params,
+                         const uint8_t *sm,
+                         uint64_t smlen,
+                         const uint8_t *pk)
+{
+    uint8_t *mout = malloc(smlen);
+    uint64_t mlen;
+    int64_t idx = 0;
+    uint32_t i;
+    int bad;
+
+    if (params->d > 1) {
+        bad = xmssmt_sign_open(mout, &mlen, sm, smlen, pk);
+    }
+    else {
+        bad = xmss_sign_open(mout, &mlen, sm, smlen, pk);
+    }
+    free(mout);
+    for (i = 0; i < params->index_bytes; i++) {
+        idx = (idx << 8) | sm[i];
+    }
+    return bad ? -1 : idx;
+}
+
+/*
+ * Batch signing on an in-memory signer. Signing is deterministic, so every
+ * signature of a batch has to equal the one xmss_sign makes with a copy of
+ * the key; those are verified as they are made, since COUNTER verification
+ * needs the counter of the last signature. A batch with a message that is too
+ * short to sign must be refused as a whole and leave the signer usable.
+ */
+static int test_signer_batch(const char *variant)
+{
+    xmss_params params;
+    xmss_signer *signer;
+    uint8_t *pk, *sk, *ref;
+    uint8_t m[4][XMSS_MLEN];
+    uint8_t *sm[4], *refsm, *mout;
+    const uint8_t *mp[4];
+    uint64_t mlen[4], smlen[4], refsmlen, outlen;
+    int mt = strncmp(variant, "XMSSMT", 6) == 0;
+    int ret = 0, differ = 0, bad = 0;
+    int i, j;
+
+    if (test_keypair(variant, &params, &pk, &sk)) {
+        return check(1, "key generation for batch signing");
+    }
+    ref = malloc(XMSS_OID_LEN + params.sk_bytes);
+    memcpy(ref, sk, XMSS_OID_LEN + params.sk_bytes);
+    refsm = malloc(params.sig_bytes + XMSS_MLEN);
+    mout = malloc(params.sig_bytes + XMSS_MLEN);
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < XMSS_MLEN - 8; j++) m[i][j] = i + j;
+        for (j = XMSS_MLEN - 8; j < XMSS_MLEN; j++) m[i][j] = 0;
+        sm[i] = malloc(params.sig_bytes + XMSS_MLEN);
+        mp[i] = m[i];
+        mlen[i] = XMSS_MLEN;
+    }
+
+    if (mt ? xmssmt_signer_init(&signer, sk) : xmss_signer_init(&signer, sk)) {
+        return check(1, "creating a signer for batch signing");
+    }
+
+    /* COUNTER needs 8 bytes to grind on; XMSSMT does not grind. */
+    mlen[1] = 4;
+    if (!mt) {
+        ret |= check(!xmss_signer_sign_batch(signer, sm, smlen, mp, mlen, 4) ||
+                     test_index(&params, sk) != 0,
+                     "a batch with a short message is refused");
+    }
+    mlen[1] = XMSS_MLEN;
+
+    ret |= check(xmss_signer_sign_batch(signer, sm, smlen, mp, mlen, 4) ||
+                 test_index(&params, sk) != 4, "a batch of 4 is signed");
+    for (i = 0; i < 4; i++) {
+        if (mt) {
+            xmssmt_sign(ref, refsm, &refsmlen, m[i], XMSS_MLEN);
+            bad |= xmssmt_sign_open(mout, &outlen, refsm, refsmlen, pk);
+        }
+        else {
+            xmss_sign(ref, refsm, &refsmlen, m[i], XMSS_MLEN);
+            bad |= xmss_sign_open(mout, &outlen, refsm, refsmlen, pk);
+        }
+        differ |= refsmlen != smlen[i] || memcmp(refsm, sm[i], refsmlen);
+    }
+    ret |= check(bad, "signatures of the reference key verify");
+    ret |= check(differ, "batch signatures equal single signatures");
+
+    /* The signer goes on after the batch. */
+    bad = xmss_signer_sign(signer, sm[0], &smlen[0], m[0], XMSS_MLEN) ||
+          (mt ? xmssmt_sign_open(mout, &outlen, sm[0], smlen[0], pk)
+              : xmss_sign_open(mout, &outlen, sm[0], smlen[0], pk));
+    ret |= check(bad || test_index(&params, sk) != 5,
+                 "signing after a batch verifies");
+
+    xmss_signer_free(signer);
+    for (i = 0; i < 4; i++) {
+        free(sm[i]);
+    }
+    free(pk);
+    free(sk);
+    free(ref);
+    free(refsm);
+    free(mout);
+    return ret;
+}
+
+/*
+ * The state file signer: signatures verify and use consecutive indices, a
+ * second open of a file that is in use fails, and after a crash the indices
+ * that the crashed signer had reserved are skipped.
+ */
+static int test_file_signer(const char *variant)
+{
+    const char *path = "xmss_test.state";
+    xmss_params params;
+    xmss_file_signer *f, *g;
+    uint8_t *pk, *sk, *sm;
+    uint8_t m[XMSS_MLEN] = { 0 };
+    uint64_t smlen;
+    pid_t pid;
+    int mt = strncmp(variant, "XMSSMT", 6) == 0;
+    int ret = 0, bad = 0, status;
+    int i;
+
+    remove(path);
+    if (test_keypair(variant, &params, &pk, &sk)) {
+        return check(1, "key generation for the state file");
+    }
+    sm = malloc(params.sig_bytes + XMSS_MLEN);
+
+    ret |= check(mt ? xmssmt_file_create(path, sk) : xmss_file_create(path, sk),
+                 "creating a state file");
+    if (mt ? xmssmt_file_open(&f, path, 10) : xmss_file_open(&f, path, 10)) {
+        free(pk);
+        free(sk);
+        free(sm);
+        return check(1, "opening a state file");
+    }
+    ret |= check(!(mt ? xmssmt_file_open(&g, path, 10)
+                      : xmss_file_open(&g, path, 10)),
+                 "a state file cannot be opened twice");
+
+    for (i = 0; i < 3; i++) {
+        bad |= xmss_file_sign(f, sm, &smlen, m, XMSS_MLEN) ||
+               test_open(&params, sm, smlen, pk) != i;
+    }
+    ret |= check(bad, "the state file signer signs indices 0, 1 and 2");
+    ret |= check(xmss_file_close(f), "closing a state file");
+
+    /* A signer that dies after one signature, without closing the file. */
+    pid = fork();
+    if (pid == 0) {
+        if (mt ? xmssmt_file_open(&f, path, 10) : xmss_file_open(&f, path, 10)) {
+            _exit(1);
+        }
+        _exit(xmss_file_sign(f, sm, &smlen, m, XMSS_MLEN) ? 1 : 0);
+    }
+    ret |= check(pid < 0 || waitpid(pid, &status, 0) != pid ||
+                 !WIFEXITED(status) || WEXITSTATUS(status) != 0,
+                 "a signer crashes after signing index 3");
+
+    bad = mt ? xmssmt_file_open(&f, path, 10) : xmss_file_open(&f, path, 10);
+    if (!bad) {
+        /* Index 3 was used and [3, 13) reserved before the crash. */
+        bad = xmss_file_sign(f, sm, &smlen, m, XMSS_MLEN) ||
+              test_open(&params, sm, smlen, pk) != 13;
+        bad |= xmss_file_close(f);
+    }
+    ret |= check(bad, "reopening after a crash continues at index 13");
+
+    remove(path);
+    free(pk);
+    free(sk);
+    free(sm);
+    return ret;
+}
+
+/*
+ * A shard that ends at index 16 in a state file. A crashed signer with a
+ * reservation of 100 must not keep the file from opening again; the shard is
+ * exhausted then. The indices from 16 on sign with the split-off key.
+ */
+static int test_file_shard(const char *variant)
+{
+    const char *path = "xmss_test.state";
+    xmss_params params;
+    xmss_file_signer *f;
+    uint8_t *pk, *sk, *shard, *sm;
+    uint8_t m[XMSS_MLEN] = { 0 };
+    uint64_t smlen;
+    pid_t pid;
+    int mt = strncmp(variant, "XMSSMT", 6) == 0;
+    int ret = 0, bad, status;
+
+    remove(path);
+    if (test_keypair(variant, &params, &pk, &sk)) {
+        return check(1, "key generation for splitting");
+    }
+    shard = malloc(XMSS_OID_LEN + params.sk_bytes);
+    sm = malloc(params.sig_bytes + XMSS_MLEN);
+
+    ret |= check(mt ? xmssmt_split(shard, sk, 16) : xmss_split(shard, sk, 16),
+                 "splitting a key at index 16");
+    bad = mt ? xmssmt_sign(shard, sm, &smlen, m, XMSS_MLEN)
+             : xmss_sign(shard, sm, &smlen, m, XMSS_MLEN);
+    ret |= check(bad || test_open(&params, sm, smlen, pk) != 16,
+                 "the split-off key signs index 16");
+
+    ret |= check(mt ? xmssmt_file_create(path, sk) : xmss_file_create(path, sk),
+                 "creating a state file for the first shard");
+    pid = fork();
+    if (pid == 0) {
+        if (mt ? xmssmt_file_open(&f, path, 100) : xmss_file_open(&f, path, 100)) {
+            _exit(1);
+        }
+        _exit(xmss_file_sign(f, sm, &smlen, m, XMSS_MLEN) ? 1 : 0);
+    }
+    ret |= check(pid < 0 || waitpid(pid, &status, 0) != pid ||
+                 !WIFEXITED(status) || WEXITSTATUS(status) != 0,
+                 "a shard signer crashes after reserving 100 indices");
+
+    bad = mt ? xmssmt_file_open(&f, path, 100) : xmss_file_open(&f, path, 100);
+    ret |= check(bad, "the shard opens again after the crash");
+    if (!bad) {
+        ret |= check(!xmss_file_sign(f, sm, &smlen, m, XMSS_MLEN),
+                     "the shard does not sign beyond index 15");
+        ret |= check(xmss_file_close(f), "closing the exhausted shard");
+    }
+
+    remove(path);
+    free(pk);
+    free(sk);
+    free(shard);
+    free(sm);
+    return ret;
+}
+
+/*
+ * The asynchronous signer, on a key that ends at index 6: signatures verify
+ * with consecutive indices, a short message is refused without using an
+ * index, sk continues after the signer is stopped, and signing fails once
+ * the limit is reached.
+ */
+static int test_async(const char *variant)
+{
+    xmss_params params;
+    xmss_async_signer *signer;
+    uint8_t *pk, *sk, *shard, *sm;
+    uint8_t m[XMSS_MLEN] = { 0 };
+    uint64_t smlen;
+    int mt = strncmp(variant, "XMSSMT", 6) == 0;
+    int ret = 0, bad = 0, i;
+
+    if (test_keypair(variant, &params, &pk, &sk)) {
+        return check(1, "key generation for asynchronous signing");
+    }
+    shard = malloc(XMSS_OID_LEN + params.sk_bytes);
+    sm = malloc(params.sig_bytes + XMSS_MLEN);
+    ret |= check(mt ? xmssmt_split(shard, sk, 6) : xmss_split(shard, sk, 6),
+                 "limiting the key to 6 indices");
+
+    if (check(mt ? xmssmt_async_start(&signer, sk) : xmss_async_start(&signer, sk),
+              "starting an asynchronous signer")) {
+        free(pk);
+        free(sk);
+        free(shard);
+        free(sm);
+        return -1;
+    }
+    if (!mt) {
+        ret |= check(!xmss_async_sign(signer, sm, &smlen, m, 4),
+                     "a short message is refused");
+    }
+    for (i = 0; i < 4; i++) {
+        m[0] = (uint8_t)i;
+        bad |= xmss_async_sign(signer, sm, &smlen, m, XMSS_MLEN) ||
+               test_open(&params, sm, smlen, pk) != i;
+    }
+    ret |= check(bad, "asynchronous signatures verify with indices 0 to 3");
+    xmss_async_stop(signer);
+
+    bad = mt ? xmssmt_sign(sk, sm, &smlen, m, XMSS_MLEN)
+             : xmss_sign(sk, sm, &smlen, m, XMSS_MLEN);
+    ret |= check(bad || test_open(&params, sm, smlen, pk) != 4,
+                 "the key signs index 4 after the signer stopped");
+
+    ret |= check(mt ? xmssmt_async_start(&signer, sk) : xmss_async_start(&signer, sk),
+                 "restarting the asynchronous signer");
+    bad = xmss_async_sign(signer, sm, &smlen, m, XMSS_MLEN) ||
+          test_open(&params, sm, smlen, pk) != 5;
+    ret |= check(bad, "the restarted signer signs index 5");
+    ret |= check(!xmss_async_sign(signer, sm, &smlen, m, XMSS_MLEN),
+                 "signing fails at the index limit");
+    xmss_async_stop(signer);
+    ret |= check(test_index(&params, sk) != 6, "the key ends at its limit");
+
+    free(pk);
+    free(sk);
+    free(shard);
+    free(sm);
+    return ret;
+}
+
+/*
+ * The in-memory signer. Signatures verify with consecutive indices and a
+ * short message is refused without using an index. After a checkpoint, sk
+ * alone has to make the same signature as the signer; after the signer is
+ * freed, sk goes on where it stopped, up to the index limit.
+ */
+static int test_signer(const char *variant)
+{
+    xmss_params params;
+    xmss_signer *signer;
+    uint8_t *pk, *sk, *shard, *copy, *sm, *copysm;
+    uint8_t m[XMSS_MLEN] = { 0 };
+    uint64_t smlen, copysmlen;
+    int mt = strncmp(variant, "XMSSMT", 6) == 0;
+    int ret = 0, bad = 0, i;
+
+    if (test_keypair(variant, &params, &pk, &sk)) {
+        return check(1, "key generation for the in-memory signer");
+    }
+    shard = malloc(XMSS_OID_LEN + params.sk_bytes);
+    copy = malloc(XMSS_OID_LEN + params.sk_bytes);
+    sm = malloc(params.sig_bytes + XMSS_MLEN);
+    copysm = malloc(params.sig_bytes + XMSS_MLEN);
+    ret |= check(mt ? xmssmt_split(shard, sk, 6) : xmss_split(shard, sk, 6),
+                 "limiting the key to 6 indices");
+
+    if (check(mt ? xmssmt_signer_init(&signer, sk) : xmss_signer_init(&signer, sk),
+              "creating an in-memory signer")) {
+        free(pk);
+        free(sk);
+        free(shard);
+        free(copy);
+        free(sm);
+        free(copysm);
+        return -1;
+    }
+    if (!mt) {
+        ret |= check(!xmss_signer_sign(signer, sm, &smlen, m, 4) ||
+                     test_index(&params, sk) != 0,
+                     "a short message is refused");
+    }
+    for (i = 0; i < 3; i++) {
+        m[0] = (uint8_t)i;
+        bad |= xmss_signer_sign(signer, sm, &smlen, m, XMSS_MLEN) ||
+               test_open(&params, sm, smlen, pk) != i ||
+               test_index(&params, sk) != (uint64_t)i + 1;
+    }
+    ret |= check(bad, "signatures verify and sk follows the index");
+
+    xmss_signer_checkpoint(signer);
+    memcpy(copy, sk, XMSS_OID_LEN + params.sk_bytes);
+    bad = mt ? xmssmt_sign(copy, copysm, &copysmlen, m, XMSS_MLEN)
+             : xmss_sign(copy, copysm, &copysmlen, m, XMSS_MLEN);
+    bad |= xmss_signer_sign(signer, sm, &smlen, m, XMSS_MLEN) ||
+           smlen != copysmlen || memcmp(sm, copysm, smlen);
+    ret |= check(bad, "a checkpointed key signs like the signer");
+
+    bad = xmss_signer_sign(signer, sm, &smlen, m, XMSS_MLEN) ||
+          test_open(&params, sm, smlen, pk) != 4;
+    ret |= check(bad, "the signer goes on after a checkpoint");
+    xmss_signer_free(signer);
+
+    bad = mt ? xmssmt_sign(sk, sm, &smlen, m, XMSS_MLEN)
+             : xmss_sign(sk, sm, &smlen, m, XMSS_MLEN);
+    ret |= check(bad || test_open(&params, sm, smlen, pk) != 5,
+                 "the key signs index 5 after the signer is freed");
+    bad = mt ? xmssmt_sign(sk, sm, &smlen, m, XMSS_MLEN)
+             : xmss_sign(sk, sm, &smlen, m, XMSS_MLEN);
+    ret |= check(!bad, "signing fails at the index limit");
+
+    free(pk);
+    free(sk);
+    free(shard);
+    free(copy);
+    free(sm);
+    free(copysm);
+    return ret;
+}
+
+/*
+ * Merkle batch signing: one index signs a batch of messages of any length,
+ * each of which verifies on its own with its proof and all at once. A changed
+ * message, a proof of another message and a changed root are rejected.
+ */
+static int test_merkle(const char *variant)
+{
+    xmss_params params;
+    uint8_t *pk, *sk, *sm, *proofs;
+    uint8_t m[5][XMSS_MLEN];
+    const uint8_t *mp[5];
+    uint64_t mlen[5] = { XMSS_MLEN, 3, 0, XMSS_MLEN, 17 };
+    uint64_t smlen, proof_bytes;
+    int mt = strncmp(variant, "XMSSMT", 6) == 0;
+    int ret = 0, bad = 0, i, j;
+
+    if (test_keypair(variant, &params, &pk, &sk)) {
+        return check(1, "key generation for Merkle batches");
+    }
+    proof_bytes = xmss_merkle_proof_bytes(&params, 5);
+    sm = malloc(params.sig_bytes + params.n + 8);
+    proofs = malloc(5 * proof_bytes);
+    for (i = 0; i < 5; i++) {
+        for (j = 0; j < XMSS_MLEN; j++) m[i][j] = (uint8_t)(i * 7 + j);
+        mp[i] = m[i];
+    }
+
+    bad = mt ? xmssmt_merkle_sign(sk, sm, &smlen, proofs, mp, mlen, 5)
+             : xmss_merkle_sign(sk, sm, &smlen, proofs, mp, mlen, 5);
+    ret |= check(bad || smlen != params.sig_bytes + params.n + 8 ||
+                 test_index(&params, sk) != 1,
+                 "a batch of 5 messages is signed with one index");
+
+    for (i = 0, bad = 0; i < 5; i++) {
+        bad |= mt ? xmssmt_merkle_sign_open(m[i], mlen[i], proofs + i * proof_bytes, proof_bytes, sm, smlen, pk)
+                  : xmss_merkle_sign_open(m[i], mlen[i], proofs + i * proof_bytes, proof_bytes, sm, smlen, pk);
+    }
+    ret |= check(bad, "every message verifies with its proof");
+    bad = mt ? xmssmt_merkle_verify(mp, mlen, proofs, 5, sm, smlen, pk)
+             : xmss_merkle_verify(mp, mlen, proofs, 5, sm, smlen, pk);
+    ret |= check(bad, "the batch verifies at once");
+
+    m[3][0] ^= 1;
+    bad = mt ? xmssmt_merkle_sign_open(m[3], mlen[3], proofs + 3 * proof_bytes, proof_bytes, sm, smlen, pk)
+             : xmss_merkle_sign_open(m[3], mlen[3], proofs + 3 * proof_bytes, proof_bytes, sm, smlen, pk);
+    ret |= check(!bad, "a changed message is rejected");
+    bad = mt ? xmssmt_merkle_verify(mp, mlen, proofs, 5, sm, smlen, pk)
+             : xmss_merkle_verify(mp, mlen, proofs, 5, sm, smlen, pk);
+    ret |= check(!bad, "a batch with a changed message is rejected");
+    m[3][0] ^= 1;
+
+    bad = mt ? xmssmt_merkle_sign_open(m[0], mlen[0], proofs + 3 * proof_bytes, proof_bytes, sm, smlen, pk)
+             : xmss_merkle_sign_open(m[0], mlen[0], proofs + 3 * proof_bytes, proof_bytes, sm, smlen, pk);
+    ret |= check(!bad, "the proof of another message is rejected");
+
+    sm[params.sig_bytes] ^= 1;
+    bad = mt ? xmssmt_merkle_sign_open(m[0], mlen[0], proofs, proof_bytes, sm, smlen, pk)
+             : xmss_merkle_sign_open(m[0], mlen[0], proofs, proof_bytes, sm, smlen, pk);
+    ret |= check(!bad, "a changed root is rejected");
+
+    free(pk);
+    free(sk);
+    free(sm);
+    free(proofs);
+    return ret;
+}
+
+/*
+ * Detached signatures equal the signature part of xmss_sign, verify over the
+ * separate message, and reject a changed message. With COUNTER, a message that
+ * is too short to sign with XMSS is refused without using an index; XMSSMT
+ * does not grind, so it signs such a message, and a change to the last 8 bytes
+ * of a message is rejected.
+ */
+static int test_detached(const char *variant)
+{
+    xmss_params params;
+    uint8_t *pk, *sk, *copy, *sig, *sm;
+    uint8_t m[XMSS_MLEN];
+    uint64_t smlen;
+    int mt = strncmp(variant, "XMSSMT", 6) == 0;
+    int ret = 0, bad, i;
+
+    if (test_keypair(variant, &params, &pk, &sk)) {
+        return check(1, "key generation for detached signatures");
+    }
+    copy = malloc(XMSS_OID_LEN + params.sk_bytes);
+    memcpy(copy, sk, XMSS_OID_LEN + params.sk_bytes);
+    sig = malloc(params.sig_bytes);
+    sm = malloc(params.sig_bytes + XMSS_MLEN);
+    for (i = 0; i < XMSS_MLEN; i++) m[i] = (uint8_t)(i + 1);
+
+    if (!mt) {
+        ret |= check(!xmss_sign_detached(sk, sig, m, 4) ||
+                     test_index(&params, sk) != 0,
+                     "a short message is refused");
+    }
+    bad = mt ? xmssmt_sign_detached(sk, sig, m, XMSS_MLEN)
+             : xmss_sign_detached(sk, sig, m, XMSS_MLEN);
+    bad = bad || (mt ? xmssmt_verify(sig, m, XMSS_MLEN, pk)
+                     : xmss_verify(sig, m, XMSS_MLEN, pk));
+    ret |= check(bad, "a detached signature verifies");
+
+    m[XMSS_MLEN - 9] ^= 1;
+    bad = mt ? xmssmt_verify(sig, m, XMSS_MLEN, pk)
+             : xmss_verify(sig, m, XMSS_MLEN, pk);
+    ret |= check(!bad, "a changed message is rejected");
+    m[XMSS_MLEN - 9] ^= 1;
+
+    bad = mt ? xmssmt_sign(copy, sm, &smlen, m, XMSS_MLEN)
+             : xmss_sign(copy, sm, &smlen, m, XMSS_MLEN);
+    ret |= check(bad || smlen != params.sig_bytes + XMSS_MLEN ||
+                 memcmp(sm, sig, params.sig_bytes) ||
+                 memcmp(sm + params.sig_bytes, m, XMSS_MLEN),
+                 "a detached signature equals the one of xmss_sign");
+
+    if (mt) {
+        m[XMSS_MLEN - 1] ^= 1;
+        ret |= check(!xmssmt_verify(sig, m, XMSS_MLEN, pk),
+                     "a changed last byte is rejected");
+        m[XMSS_MLEN - 1] ^= 1;
+
+        bad = xmssmt_sign_detached(sk, sig, m, 4) ||
+              xmssmt_verify(sig, m, 4, pk);
+        ret |= check(bad, "a short message is signed and verifies");
+        bad = xmssmt_sign_detached(sk, sig, m, 0) ||
+              xmssmt_verify(sig, m, 0, pk);
+        ret |= check(bad, "an empty message is signed and verifies");
+    }
+
+    free(pk);
+    free(sk);
+    free(copy);
+    free(sig);
+    free(sm);
+    return ret;
+}
+
+/*
+ * Streaming: a message passed in pieces that do not line up with hash blocks
+ * is signed as xmss_sign_detached signs it whole, and verifies when passed in
+ * other pieces. A changed piece, a short XMSS message and a key that signed
+ * something else between init and final make it fail. XMSSMT does not grind,
+ * so it signs a short message, and rejects a change to the last 8 bytes.
+ */
+static int test_streaming(const char *variant)
+{
+    xmss_params params;
+    xmss_sign_ctx *sctx;
+    xmss_verify_ctx *vctx;
+    uint8_t *pk, *sk, *copy, *sig, *ref, *sm;
+    uint8_t m[200];
+    uint64_t smlen;
+    int mt = strncmp(variant, "XMSSMT", 6) == 0;
+    int ret = 0, bad, i;
+
+    if (test_keypair(variant, &params, &pk, &sk)) {
+        return check(1, "key generation for streaming");
+    }
+    copy = malloc(XMSS_OID_LEN + params.sk_bytes);
+    memcpy(copy, sk, XMSS_OID_LEN + params.sk_bytes);
+    sig = malloc(params.sig_bytes);
+    ref = malloc(params.sig_bytes);
+    sm = malloc(params.sig_bytes + sizeof(m));
+    for (i = 0; i < (int)sizeof(m); i++) m[i] = (uint8_t)(3 * i + 1);
+
+    bad = mt ? xmssmt_sign_init(&sctx, sk) : xmss_sign_init(&sctx, sk);
+    if (!bad) {
+        xmss_sign_update(sctx, m, 1);
+        xmss_sign_update(sctx, m + 1, 63);
+        xmss_sign_update(sctx, m + 64, 0);
+        xmss_sign_update(sctx, m + 64, 100);
+        xmss_sign_update(sctx, m + 164, 36);
+        bad = xmss_sign_final(sctx, sig);
+    }
+    ret |= check(bad || test_index(&params, sk) != 1,
+                 "a message passed in pieces is signed");
+    bad = mt ? xmssmt_verify_init(&vctx, sig, pk) : xmss_verify_init(&vctx, sig, pk);
+    if (!bad) {
+        xmss_verify_update(vctx, m, 150);
+        xmss_verify_update(vctx, m + 150, 50);
+        bad = xmss_verify_final(vctx);
+    }
+    ret |= check(bad, "the signature verifies from other pieces");
+
+    bad = mt ? xmssmt_verify_init(&vctx, sig, pk) : xmss_verify_init(&vctx, sig, pk);
+    if (!bad) {
+        xmss_verify_update(vctx, m, 150);
+        m[170] ^= 1;
+        xmss_verify_update(vctx, m + 150, 50);
+        m[170] ^= 1;
+        bad = xmss_verify_final(vctx);
+    }
+    ret |= check(!bad, "a changed piece is rejected");
+
+    bad = mt ? xmssmt_sign_detached(copy, ref, m, sizeof(m))
+             : xmss_sign_detached(copy, ref, m, sizeof(m));
+    ret |= check(bad || memcmp(sig, ref, params.sig_bytes),
+                 "streaming signs as xmss_sign_detached does");
+
+    if (!mt) {
+        bad = xmss_sign_init(&sctx, sk);
+        if (!bad) {
+            xmss_sign_update(sctx, m, 2);
+            xmss_sign_update(sctx, m + 2, 2);
+            bad = xmss_sign_final(sctx, sig);
+        }
+        ret |= check(!bad || test_index(&params, sk) != 1,
+                     "a short message in pieces is refused");
+    }
+    else {
+        bad = xmssmt_verify_init(&vctx, sig, pk);
+        if (!bad) {
+            m[sizeof(m) - 1] ^= 1;
+            xmss_verify_update(vctx, m, sizeof(m));
+            m[sizeof(m) - 1] ^= 1;
+            bad = xmss_verify_final(vctx);
+        }
+        ret |= check(!bad, "a changed last byte is rejected");
+
+        bad = xmssmt_sign_init(&sctx, sk);
+        if (!bad) {
+            xmss_sign_update(sctx, m, 2);
+            xmss_sign_update(sctx, m + 2, 3);
+            bad = xmss_sign_final(sctx, sig);
+        }
+        if (!bad) {
+            bad = xmssmt_verify_init(&vctx, sig, pk);
+        }
+        if (!bad) {
+            xmss_verify_update(vctx, m, 5);
+            bad = xmss_verify_final(vctx);
+        }
+        ret |= check(bad, "a short message in pieces is signed and verifies");
+    }
+
+    bad = mt ? xmssmt_sign_init(&sctx, sk) : xmss_sign_init(&sctx, sk);
+    if (!bad) {
+        xmss_sign_update(sctx, m, sizeof(m));
+        bad = mt ? xmssmt_sign(sk, sm, &smlen, m, sizeof(m))
+                 : xmss_sign(sk, sm, &smlen, m, sizeof(m));
+        bad = bad || !xmss_sign_final(sctx, sig);
+    }
+    ret |= check(bad, "a key that moved on since init is refused");
+
+    free(pk);
+    free(sk);
+    free(copy);
+    free(sig);
+    free(ref);
+    free(sm);
+    return ret;
+}
+
+/*
+ * Round trip of a parameter set: signatures verify and a changed signature
+ * is rejected. Signing is deterministic, so every hash backend that the host
+ * supports has to sign the same index of the key with the same bytes.
+ */
+static int test_variant(const char *variant)
+{
+    xmss_params params, p;
+    const xmss_hash_backend *backend;
+    uint8_t *pk, *sk, *copy, *sm, *ref, *mout;
+    uint8_t m[XMSS_MLEN] = { 0 };
+    uint64_t smlen, refsmlen = 0, mlen;
+    int mt = strncmp(variant, "XMSSMT", 6) == 0;
+    int ret = 0, bad = 0, i;
+    char what[96];
+
+    if (test_keypair(variant, &params, &pk, &sk)) {
+        snprintf(what, sizeof(what), "key generation for %s", variant);
+        return check(1, what);
+    }
+    copy = malloc(params.sk_bytes);
+    sm = malloc(params.sig_bytes + XMSS_MLEN);
+    ref = malloc(params.sig_bytes + XMSS_MLEN);
+    mout = malloc(params.sig_bytes + XMSS_MLEN);
+
+    /* The first signature is made by every backend from a copy of sk. */
+    for (i = 0; (backend = xmss_hash_backend_get(i)) != NULL; i++) {
+        p = params;
+        memcpy(copy, sk + XMSS_OID_LEN, params.sk_bytes);
+        if (xmss_set_hash_backend(&p, backend->name) ||
+            (mt ? xmssmt_core_sign(&p, copy, sm, &smlen, m, XMSS_MLEN)
+                : xmss_core_sign(&p, copy, sm, &smlen, m, XMSS_MLEN))) {
+            bad = 1;
+            continue;
+        }
+        bad |= mt ? xmssmt_core_sign_open(&p, mout, &mlen, sm, smlen, pk + XMSS_OID_LEN)
+                  : xmss_core_sign_open(&p, mout, &mlen, sm, smlen, pk + XMSS_OID_LEN);
+        if (i == 0) {
+            memcpy(ref, sm, smlen);
+            refsmlen = smlen;
+        }
+        bad |= smlen != refsmlen || memcmp(sm, ref, smlen);
+    }
+    snprintf(what, sizeof(what), "%s signs alike with %d backends", variant, i);
+    ret |= check(bad, what);
+
+    for (i = 0, bad = 0; i < 3; i++) {
+        m[0] = (uint8_t)i;
+        bad |= (mt ? xmssmt_sign(sk, sm, &smlen, m, XMSS_MLEN)
+                   : xmss_sign(sk, sm, &smlen, m, XMSS_MLEN)) ||
+               test_open(&params, sm, smlen, pk) != i;
+    }
+    snprintf(what, sizeof(what), "%s signatures verify", variant);
+    ret |= check(bad, what);
+
+    sm[params.index_bytes + params.n + 1] ^= 1;
+    snprintf(what, sizeof(what), "%s rejects a changed signature", variant);
+    ret |= check(test_open(&params, sm, smlen, pk) >= 0, what);
+
+    free(pk);
+    free(sk);
+    free(copy);
+    free(sm);
+    free(ref);
+    free(mout);
+    return ret;
+}
+
+/*
+ * Signs signatures messages with sk and checks each with a verifier right
+ * away, as COUNTER needs for XMSS: the signature has to verify, also in the
+ * form of xmss_verifier_open, and changing a byte of its WOTS signature, of
+ * the first auth node or its last byte (the top auth node) must reject it.
+ * The signature is verified again afterwards, so rejections must not leave
+ * anything wrong in the caches of the verifier. The messages do not end in
+ * zero bytes, and for XMSSMT, which does not grind, every other one is only
+ * 5 bytes long.
+ */
+static int test_verifier_run(xmss_verifier *verifier,
+                             const xmss_params *params,
+                             uint8_t *sk,
+                             int signatures,
+                             const char *mode)
+{
+    uint32_t wots = params->index_bytes + params->n;
+    uint64_t tampered[3] = { wots + 5, wots + params->wots_sig_bytes,
+                             params->sig_bytes - 1 };
+    uint8_t *sm = malloc(params->sig_bytes + XMSS_MLEN);
+    uint8_t *mout = malloc(params->sig_bytes + XMSS_MLEN);
+    uint8_t m[XMSS_MLEN];
+    uint64_t smlen, mlen, len;
+    int mt = params->d > 1;
+    int ret = 0, bad = 0, rejected = 1, i, j;
+    char what[96];
+
+    for (j = 0; j < XMSS_MLEN; j++) m[j] = (uint8_t)(j + 1);
+    for (i = 0; i < signatures; i++) {
+        m[0] = (uint8_t)i;
+        len = mt && i % 2 ? 5 : XMSS_MLEN;
+        if (mt ? xmssmt_sign(sk, sm, &smlen, m, len)
+               : xmss_sign(sk, sm, &smlen, m, len)) {
+            bad = 1;
+            break;
+        }
+        bad |= xmss_verifier_verify(verifier, sm, m, len);
+        bad |= xmss_verifier_open(verifier, mout, &mlen, sm, smlen) ||
+               mlen != len || memcmp(mout, m, len);
+        for (j = 0; j < 3; j++) {
+            sm[tampered[j]] ^= 0x10;
+            rejected &= xmss_verifier_verify(verifier, sm, m, len) != 0;
+            rejected &= xmss_verifier_open(verifier, mout, &mlen, sm, smlen) != 0;
+            sm[tampered[j]] ^= 0x10;
+        }
+        bad |= xmss_verifier_verify(verifier, sm, m, len);
+    }
+    snprintf(what, sizeof(what), "a verifier with %s accepts valid signatures", mode);
+    ret |= check(bad, what);
+    snprintf(what, sizeof(what), "a verifier with %s rejects changed WOTS and auth bytes", mode);
+    ret |= check(!rejected, what);
+
+    free(sm);
+    free(mout);
+    return ret;
+}
+
+/*
+ * Verifiers without and with a PRF cache, one that is too small to hold the
+ * top levels and one that holds many more.
+ */
+static int test_verifier_cache(const char *variant)
+{
+    xmss_params params;
+    xmss_verifier *verifier;
+    uint8_t *pk, *sk;
+    uint32_t entries[3] = { 0, 6, 3 << 8 };
+    int mt = strncmp(variant, "XMSSMT", 6) == 0;
+    int ret = 0, i;
+    char mode[64];
+
+    if (test_keypair(variant, &params, &pk, &sk)) {
+        return check(1, "key generation for verifiers");
+    }
+    for (i = 0; i < 3; i++) {
+        snprintf(mode, sizeof(mode), "%u PRF cache entries", entries[i]);
+        if (mt ? xmssmt_verifier_init(&verifier, pk, entries[i])
+               : xmss_verifier_init(&verifier, pk, entries[i])) {
+            ret |= check(1, mode);
+            continue;
+        }
+        ret |= test_verifier_run(verifier, &params, sk, 6, mode);
+        xmss_verifier_free(verifier);
+    }
+
+    free(pk);
+    free(sk);
+    return ret;
+}
+
+/*
+ * Verifiers that keep the upper nodes of the (top) tree. Consecutive
+ * signatures share those nodes, so later signatures stop at known ones.
+ * Keeping as many levels as the tree has is refused.
+ */
+static int test_verifier_nodes(const char *variant)
+{
+    xmss_params params;
+    xmss_verifier *verifier;
+    uint8_t *pk, *sk;
+    int mt = strncmp(variant, "XMSSMT", 6) == 0;
+    int ret = 0;
+
+    if (test_keypair(variant, &params, &pk, &sk)) {
+        return check(1, "key generation for verifiers");
+    }
+    if (mt ? xmssmt_verifier_init(&verifier, pk, 3 << 4)
+           : xmss_verifier_init(&verifier, pk, 3 << 4)) {
+        free(pk);
+        free(sk);
+        return check(1, "creating a verifier that keeps nodes");
+    }
+    ret |= check(!xmss_verifier_keep_nodes(verifier, params.tree_height),
+                 "keeping all levels of the tree is refused");
+    ret |= check(xmss_verifier_keep_nodes(verifier, params.tree_height - 1),
+                 "keeping all levels below the root");
+    ret |= test_verifier_run(verifier, &params, sk, 8, "kept nodes");
+    ret |= check(xmss_verifier_keep_nodes(verifier, 2), "keeping 2 levels");
+    ret |= test_verifier_run(verifier, &params, sk, 4, "2 kept levels");
+    ret |= check(xmss_verifier_keep_nodes(verifier, 0), "forgetting the nodes");
+    ret |= test_verifier_run(verifier, &params, sk, 2, "forgotten nodes");
+    xmss_verifier_free(verifier);
+
+    free(pk);
+    free(sk);
+    return ret;
+}
+
+/*
+ * An XMSS verifier that checks signatures against a table of the WOTS public
+ * keys of all leaves. A table with a changed key does not load, and leaves
+ * the verifier as it was; XMSSMT verifiers take no table.
+ */
+static int test_verifier_wots(const char *variant, const char *mt_variant)
+{
+    xmss_params params, mt_params;
+    xmss_verifier *verifier;
+    uint8_t *pk, *sk, *mt_pk, *mt_sk, *wots_pks;
+    uint64_t table_bytes;
+    int ret = 0;
+
+    if (test_keypair(variant, &params, &pk, &sk) ||
+        test_keypair(mt_variant, &mt_params, &mt_pk, &mt_sk)) {
+        return check(1, "key generation for WOTS tables");
+    }
+    table_bytes = ((uint64_t)1 << params.tree_height) * params.wots_len * params.n;
+    wots_pks = malloc(table_bytes);
+    ret |= check(xmss_wots_pks(wots_pks, sk), "computing the WOTS public keys");
+
+    if (xmss_verifier_init(&verifier, pk, 0) == 0) {
+        wots_pks[table_bytes / 2] ^= 1;
+        ret |= check(!xmss_verifier_load_wots(verifier, wots_pks),
+                     "a changed table is rejected");
+        ret |= test_verifier_run(verifier, &params, sk, 2, "a rejected table");
+        wots_pks[table_bytes / 2] ^= 1;
+        ret |= check(xmss_verifier_load_wots(verifier, wots_pks),
+                     "loading the table");
+        ret |= test_verifier_run(verifier, &params, sk, 6, "a WOTS table");
+        xmss_verifier_free(verifier);
+    }
+    else {
+        ret |= check(1, "creating a verifier for a WOTS table");
+    }
+
+    if (xmssmt_verifier_init(&verifier, mt_pk, 0) == 0) {
+        ret |= check(!xmss_verifier_load_wots(verifier, wots_pks),
+                     "an XMSSMT verifier takes no table");
+        xmss_verifier_free(verifier);
+    }
+
+    free(pk);
+    free(sk);
+    free(mt_pk);
+    free(mt_sk);
+    free(wots_pks);
+    return ret;
+}
+
+/*
+ * Verifiers that reject at the first node that contradicts what they know,
+ * with kept nodes and, for XMSS, with a table of WOTS public keys.
+ */
+static int test_verifier_fast(const char *variant)
+{
+    xmss_params params;
+    xmss_verifier *verifier;
+    uint8_t *pk, *sk, *wots_pks = NULL;
+    int mt = strncmp(variant, "XMSSMT", 6) == 0;
+    int ret = 0;
+
+    if (test_keypair(variant, &params, &pk, &sk)) {
+        return check(1, "key generation for verifiers");
+    }
+    if (mt ? xmssmt_verifier_init(&verifier, pk, 0)
+           : xmss_verifier_init(&verifier, pk, 0)) {
+        free(pk);
+        free(sk);
+        return check(1, "creating a verifier that rejects early");
+    }
+    xmss_verifier_fast_reject(verifier, 1);
+    ret |= test_verifier_run(verifier, &params, sk, 2, "early rejection alone");
+    ret |= check(xmss_verifier_keep_nodes(verifier, params.tree_height - 1),
+                 "keeping all levels below the root");
+    ret |= test_verifier_run(verifier, &params, sk, 6, "early rejection and kept nodes");
+    if (!mt) {
+        wots_pks = malloc(((uint64_t)1 << params.tree_height) * params.wots_len * params.n);
+        ret |= check(xmss_wots_pks(wots_pks, sk) ||
+                     xmss_verifier_load_wots(verifier, wots_pks),
+                     "loading the WOTS public keys");
+        ret |= test_verifier_run(verifier, &params, sk, 6, "early rejection and a WOTS table");
+    }
+    xmss_verifier_fast_reject(verifier, 0);
+    ret |= test_verifier_run(verifier, &params, sk, 2, "early rejection turned off");
+    xmss_verifier_free(verifier);
+
+    free(pk);
+    free(sk);
+    free(wots_pks);
+    return ret;
+}
+
+/* What test_trace learns from the trace callback. Every event is checked as
+ * it arrives: it must carry the index of the signature being made or
+ * verified, its time must not go back, and every phase has to end before the
+ * phase that began before it, i.e. phases pair up and nest. */
+typedef struct {
+    uint64_t idx;
+    uint64_t ns;
+    uint32_t open[XMSS_TRACE_PHASES];
+    uint32_t depth;
+    uint32_t ended[XMSS_TRACE_PHASES];
+    uint64_t events;
+    int bad;
+} test_trace_log;
+
+static void test_trace_event(void *arg, uint32_t phase, int end,
+                             uint64_t idx, uint64_t ns)
+{
+    test_trace_log *log = arg;
+
+    log->events++;
+    if (phase >= XMSS_TRACE_PHASES || idx != log->idx || ns < log->ns) {
+        log->bad = 1;
+        return;
+    }
+    log->ns = ns;
+    if (!end) {
+        if (log->depth == XMSS_TRACE_PHASES) {
+            log->bad = 1;
+            return;
+        }
+        log->open[log->depth++] = phase;
+    }
+    else if (log->depth == 0 || log->open[--log->depth] != phase) {
+        log->bad = 1;
+    }
+    else {
+        log->ended[phase]++;
+    }
+}
+
+/*
+ * The trace hooks: one XMSS signature and its verification, and XMSSMT
+ * signatures across the switch to the next bottom tree. After the callback
+ * is removed, signing reports nothing.
+ */
+static int test_trace(void)
+{
+    xmss_params params, mt_params;
+    test_trace_log log;
+    uint8_t *pk, *sk, *mt_pk, *mt_sk, *sm;
+    uint8_t m[XMSS_MLEN] = { 0 };
+    uint64_t smlen, events;
+    int ret = 0, bad = 0, i;
+
+    if (test_keypair("XMSS-SHA2_10_256", &params, &pk, &sk) ||
+        test_keypair("XMSSMT-SHA2_20/4_256", &mt_params, &mt_pk, &mt_sk)) {
+        return check(1, "key generation for tracing");
+    }
+    sm = malloc(mt_params.sig_bytes > params.sig_bytes
+                ? mt_params.sig_bytes + XMSS_MLEN : params.sig_bytes + XMSS_MLEN);
+    memset(&log, 0, sizeof(log));
+    xmss_set_trace(test_trace_event, &log);
+
+    bad = xmss_sign(sk, sm, &smlen, m, XMSS_MLEN) ||
+          test_open(&params, sm, smlen, pk) != 0;
+    ret |= check(bad || log.bad || log.depth != 0,
+                 "XMSS trace events pair up and carry the index");
+    bad = !log.ended[XMSS_TRACE_MESSAGE] || !log.ended[XMSS_TRACE_WOTS] ||
+          !log.ended[XMSS_TRACE_BDS] || !log.ended[XMSS_TRACE_TREEHASH] ||
+          !log.ended[XMSS_TRACE_LTREE] || !log.ended[XMSS_TRACE_ROOT];
+#if COUNTER
+    bad |= !log.ended[XMSS_TRACE_GRIND];
+#endif
+    ret |= check(bad, "XMSS signing and verification report their phases");
+
+    memset(&log, 0, sizeof(log));
+    for (i = 0, bad = 0; i <= 1 << mt_params.tree_height; i++) {
+        log.idx = i;
+        bad |= xmssmt_sign(mt_sk, sm, &smlen, m, XMSS_MLEN) ||
+               test_open(&mt_params, sm, smlen, mt_pk) != i;
+    }
+    ret |= check(bad || log.bad || log.depth != 0,
+                 "XMSSMT trace events pair up and carry the index");
+    ret |= check(!log.ended[XMSS_TRACE_SWITCH] || !log.ended[XMSS_TRACE_NEXT_TREE],
+                 "XMSSMT reports the switch to the next tree");
+
+    xmss_set_trace(NULL, NULL);
+    events = log.events;
+    bad = xmssmt_sign(mt_sk, sm, &smlen, m, XMSS_MLEN);
+    ret |= check(bad || log.events != events, "a removed callback is not called");
+
+    free(pk);
+    free(sk);
+    free(mt_pk);
+    free(mt_sk);
+    free(sm);
+    return ret;
+}
+
+#if HASH_STATS
+/* Checks that the counters of phase hold exactly the given counts of calls,
+core_hash calls, PRFs, thash_f, thash_h and compressions, and that no other
+phase counted anything. */
+static int test_hash_stats_cells(uint32_t phase, const uint64_t counts[HASH_STATS_TYPES])
+{
+    uint32_t type;
+    int bad = 0;
+
+    for (type = 0; type < HASH_STATS_TYPES; type++) {
+        bad |= hash_stats_get(type, phase) != counts[type];
+        bad |= hash_stats_get(type, HASH_STATS_PHASES) != counts[type];
+    }
+    return bad;
+}
+
+/*
+ * The hash call counters against known counts, for n = 32 and SHA-256: a PRF
+ * hashes 3n = 96 bytes, which with the padding takes two compressions; a
+ * thash_f takes two PRFs and one 96-byte hash, and a thash_h three PRFs and
+ * one 128-byte hash, which takes three. With PRECOMP, the PRFs of thash_f and
+ * thash_h finish the cached midstate of their key in one compression rather
+ * than calling core_hash, so the key is hashed once before counting.
+ */
+static int test_hash_stats(void)
+{
+    xmss_params params;
+    uint32_t oid, prev, inner;
+    uint32_t addr[8] = { 0 };
+    uint8_t in[2 * 32] = { 0 }, key[32] = { 1 }, out[32];
+    int ret = 0;
+
+    xmss_str_to_oid(&oid, "XMSS-SHA2_10_256");
+    xmss_parse_oid(&params, oid);
+
+    hash_stats_reset();
+    prf(&params, out, in, key);
+    ret |= check(test_hash_stats_cells(HASH_STATS_OTHER,
+                                       (const uint64_t[]){ 1, 1, 1, 0, 0, 2 }),
+                 "one PRF counts as one call and two compressions");
+
+    thash_f(&params, out, in, key, addr);
+    hash_stats_reset();
+    prev = hash_stats_enter(HASH_STATS_WOTS);
+    thash_f(&params, out, in, key, addr);
+    hash_stats_leave(prev);
+    ret |= check(test_hash_stats_cells(HASH_STATS_WOTS,
+                                       (const uint64_t[]){ 3, PRECOMP ? 1 : 3, 2,
+                                                           1, 0, PRECOMP ? 4 : 6 }),
+                 "one thash_f counts in its phase");
+
+    hash_stats_reset();
+    prev = hash_stats_enter(HASH_STATS_AUTH);
+    thash_h(&params, out, in, key, addr);
+    hash_stats_leave(prev);
+    ret |= check(test_hash_stats_cells(HASH_STATS_AUTH,
+                                       (const uint64_t[]){ 4, PRECOMP ? 1 : 4, 3,
+                                                           0, 1, PRECOMP ? 6 : 9 }),
+                 "one thash_h counts in its phase");
+
+    hash_stats_reset();
+    prev = hash_stats_enter(HASH_STATS_BDS);
+    inner = hash_stats_enter(HASH_STATS_WOTS);
+    prf(&params, out, in, key);
+    hash_stats_leave(inner);
+    hash_stats_leave(prev);
+    ret |= check(test_hash_stats_cells(HASH_STATS_BDS,
+                                       (const uint64_t[]){ 1, 1, 1, 0, 0, 2 }),
+                 "a phase inside another counts towards the outer one");
+    return ret;
+}
+#endif
+
+#define TEST_THREADS 4
+#define TEST_THREAD_SIGS 8
+
+/* One thread of test_concurrent and the indices of its signatures. */
+typedef struct {
+    xmss_concurrent_signer *signer;
+    const xmss_params *params;
+    const uint8_t *pk;
+    int64_t idx[TEST_THREAD_SIGS];
+} test_thread;
+
+/* Signs with a handle of its own and verifies every signature right away;
+ * the counter of COUNTER grinding is kept per thread. */
+static void *test_thread_sign(void *arg)
+{
+    test_thread *t = arg;
+    xmss_thread_signer *thread;
+    uint8_t *sm = malloc(t->params->sig_bytes + XMSS_MLEN);
+    uint8_t m[XMSS_MLEN] = { 0 };
+    uint64_t smlen;
+    int i;
+
+    for (i = 0; i < TEST_THREAD_SIGS; i++) {
+        t->idx[i] = -1;
+    }
+    if (xmss_concurrent_attach(t->signer, &thread) == 0) {
+        for (i = 0; i < TEST_THREAD_SIGS; i++) {
+            m[0] = (uint8_t)i;
+            if (xmss_concurrent_sign(thread, sm, &smlen, m, XMSS_MLEN) == 0) {
+                t->idx[i] = test_open(t->params, sm, smlen, t->pk);
+            }
+        }
+        xmss_concurrent_detach(thread);
+    }
+    free(sm);
+    return NULL;
+}
+
+static int cmp_index(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ * Several threads sign with one concurrent signer. Every signature has to
+ * verify with an index of its own, and afterwards sk has to go on signing
+ * after the indices that were handed out.
+ */
+static int test_concurrent(const char *variant)
+{
+    xmss_params params;
+    xmss_concurrent_signer *signer;
+    test_thread threads[TEST_THREADS];
+    pthread_t ids[TEST_THREADS];
+    int64_t idx[TEST_THREADS * TEST_THREAD_SIGS];
+    uint8_t *pk, *sk, *sm;
+    uint8_t m[XMSS_MLEN] = { 0 };
+    uint64_t smlen, next;
+    int mt = strncmp(variant, "XMSSMT", 6) == 0;
+    int ret = 0, bad = 0, i, j;
+
+    if (test_keypair(variant, &params, &pk, &sk)) {
+        return check(1, "key generation for concurrent signing");
+    }
+    sm = malloc(params.sig_bytes + XMSS_MLEN);
+
+    if (check(mt ? xmssmt_concurrent_init(&signer, sk)
+                 : xmss_concurrent_init(&signer, sk),
+              "creating a concurrent signer")) {
+        free(pk);
+        free(sk);
+        free(sm);
+        return -1;
+    }
+    for (i = 0; i < TEST_THREADS; i++) {
+        threads[i].signer = signer;
+        threads[i].params = &params;
+        threads[i].pk = pk;
+        pthread_create(&ids[i], NULL, test_thread_sign, &threads[i]);
+    }
+    for (i = 0; i < TEST_THREADS; i++) {
+        pthread_join(ids[i], NULL);
+        for (j = 0; j < TEST_THREAD_SIGS; j++) {
+            idx[i * TEST_THREAD_SIGS + j] = threads[i].idx[j];
+            bad |= threads[i].idx[j] < 0;
+        }
+    }
+    ret |= check(bad, "signatures of several threads verify");
+    qsort(idx, TEST_THREADS * TEST_THREAD_SIGS, sizeof(int64_t), cmp_index);
+    for (i = 1, bad = 0; i < TEST_THREADS * TEST_THREAD_SIGS; i++) {
+        bad |= idx[i] == idx[i - 1];
+    }
+    ret |= check(bad, "every signature has an index of its own");
+
+    ret |= check(xmss_concurrent_free(signer), "releasing the concurrent signer");
+    next = test_index(&params, sk);
+    ret |= check(next <= (uint64_t)idx[TEST_THREADS * TEST_THREAD_SIGS - 1],
+                 "the key continues after the indices handed out");
+    bad = mt ? xmssmt_sign(sk, sm, &smlen, m, XMSS_MLEN)
+             : xmss_sign(sk, sm, &smlen, m, XMSS_MLEN);
+    ret |= check(bad || test_open(&params, sm, smlen, pk) != (int64_t)next,
+                 "the key signs after a concurrent signer");
+
+    free(pk);
+    free(sk);
+    free(sm);
+    return ret;
+}
+
 int main()
 {
     xmss_params params;
@@ -180,6 +1442,42 @@ int main()
     fprintf(stderr, "}; \n");
 #endif
 
+    ret |= test_signer_batch("XMSS-SHA2_10_256");
+    ret |= test_signer_batch("XMSSMT-SHA2_20/4_256");
+    ret |= test_file_signer("XMSS-SHA2_10_256");
+    ret |= test_file_shard("XMSSMT-SHA2_20/4_256");
+    ret |= test_concurrent("XMSS-SHA2_10_256");
+    ret |= test_concurrent("XMSSMT-SHA2_20/4_256");
+    ret |= test_async("XMSS-SHA2_10_256");
+    ret |= test_async("XMSSMT-SHA2_20/4_256");
+    ret |= test_signer("XMSS-SHA2_10_256");
+    ret |= test_signer("XMSSMT-SHA2_20/4_256");
+    ret |= test_merkle("XMSS-SHA2_10_256");
+    ret |= test_merkle("XMSSMT-SHA2_20/4_256");
+    ret |= test_detached("XMSS-SHA2_10_256");
+    ret |= test_detached("XMSSMT-SHA2_20/4_256");
+    ret |= test_streaming("XMSS-SHA2_10_256");
+    ret |= test_streaming("XMSSMT-SHA2_20/4_256");
+    ret |= test_variant("XMSS-SHA2_10_256");
+    ret |= test_variant("XMSSMT-SHA2_20/4_256");
+    ret |= test_variant("XMSS-SHAKE_10_256");
+    ret |= test_variant("XMSSMT-SHAKE_20/4_256");
+    ret |= test_variant("XMSS-SHA2_10_512");
+    ret |= test_variant("XMSS-SHAKE_10_512");
+    ret |= test_variant("XMSSMT-SHA2_20/4_512");
+    ret |= test_variant("XMSSMT-SHAKE_20/4_512");
+    ret |= test_verifier_cache("XMSS-SHA2_10_256");
+    ret |= test_verifier_cache("XMSSMT-SHA2_20/4_256");
+    ret |= test_verifier_nodes("XMSS-SHA2_10_256");
+    ret |= test_verifier_nodes("XMSSMT-SHA2_20/4_256");
+    ret |= test_verifier_wots("XMSS-SHA2_10_256", "XMSSMT-SHA2_20/4_256");
+    ret |= test_verifier_fast("XMSS-SHA2_10_256");
+    ret |= test_verifier_fast("XMSSMT-SHA2_20/4_256");
+    ret |= test_trace();
+#if HASH_STATS
+    ret |= test_hash_stats();
+#endif
+
 
     free(m);
     free(sm);
@@ -0,0 +1,39 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "xmss_trace.h"
+
+xmss_trace_fn xmss_trace_hook = NULL;
+static void *xmss_trace_arg = NULL;
+
+static const char *const phase_names[XMSS_TRACE_PHASES] = {
+  "message", "grind", "wots", "ltree", "root", "bds", "treehash",
+  "next_tree", "switch"
+};
+
+void xmss_set_trace(xmss_trace_fn fn, void *arg)
+{
+  xmss_trace_arg = arg;
+  xmss_trace_hook = fn;
+}
+
+const char *xmss_trace_phase_name(uint32_t phase)
+{
+  return phase < XMSS_TRACE_PHASES ? phase_names[phase] : NULL;
+}
+
+void xmss_trace_emit(uint32_t phase, int end, uint64_t idx)
+{
+  xmss_trace_fn fn = xmss_trace_hook;
+  struct timespec t;
+
+  if (fn == NULL) {
+    return;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  fn(xmss_trace_arg, phase, end, idx,
+     (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec);
+}
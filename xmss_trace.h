@@ -0,0 +1,48 @@
+#ifndef XMSS_TRACE_H
+#define XMSS_TRACE_H
+
+#include <stdint.h>
+
+/* The phases of signing and verification that are reported to the trace
+callback. Every phase is reported once when it begins and once when it ends,
+with the index of the signature. */
+#define XMSS_TRACE_MESSAGE 0    /* R and the message hash */
+#define XMSS_TRACE_GRIND 1      /* COUNTER: the search for a better counter */
+#define XMSS_TRACE_WOTS 2       /* WOTS signature, or public key from one */
+#define XMSS_TRACE_LTREE 3      /* verification: leaf from a WOTS public key */
+#define XMSS_TRACE_ROOT 4       /* verification: root from a leaf and its auth path */
+#define XMSS_TRACE_BDS 5        /* BDS round: the auth path of the next leaf */
+#define XMSS_TRACE_TREEHASH 6   /* BDS treehash updates */
+#define XMSS_TRACE_NEXT_TREE 7  /* XMSSMT: leaves of the NEXT subtrees */
+#define XMSS_TRACE_SWITCH 8     /* XMSSMT: moving to the next subtree of a layer */
+#define XMSS_TRACE_PHASES 9
+
+/* Called with the argument given to xmss_set_trace, the phase, whether it
+ends (1) or begins (0), the index of the signature, and the time of the
+monotonic clock in nanoseconds. */
+typedef void (*xmss_trace_fn)(void *arg,
+                              uint32_t phase,
+                              int end,
+                              uint64_t idx,
+                              uint64_t ns);
+
+/**
+ * Sets the trace callback of the process, or removes it if fn is NULL. It is
+ * called from every thread that signs or verifies, and should be set before
+ * any of them starts. Without a callback, every phase costs one test.
+ */
+void xmss_set_trace(xmss_trace_fn fn, void *arg);
+
+/* Returns a short name of a phase, for reports, or NULL. */
+const char *xmss_trace_phase_name(uint32_t phase);
+
+extern xmss_trace_fn xmss_trace_hook;
+
+void xmss_trace_emit(uint32_t phase, int end, uint64_t idx);
+
+#define XMSS_TRACE_BEGIN(phase, idx) \
+  do { if (xmss_trace_hook != NULL) xmss_trace_emit(phase, 0, idx); } while (0)
+#define XMSS_TRACE_END(phase, idx) \
+  do { if (xmss_trace_hook != NULL) xmss_trace_emit(phase, 1, idx); } while (0)
+
+#endif